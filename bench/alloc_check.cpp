@@ -0,0 +1,230 @@
+/**
+* @file alloc_check.cpp
+* @brief fails if the sender or receiver pipeline allocates per message in steady state
+* @details Built with FORWARD_ALLOC_COUNT, see common/alloc_counter.h. The sender side is the
+*  sending path of RuntimeSender without the producer rings: serialize a StructA and a StructB
+*  into reused buffers, enqueue them on a latency channel with retransmission and FEC and on a coalescing bulk channel, dispatch. The
+*  senders get a DatagramTransport that copies every datagram into a fixed receive ring. The
+*  ring is then handed to an XUdpReceiver subclass that only sets up the pipeline, the way the receive
+*  loop does: begin_batch(), handle_recv_msg() per datagram, end_batch(). With workers 0 the
+*  frames are decoded inline and stored by the CSV storagers, so one step covers
+*  serialize -> schedule -> send -> gap detection / FEC -> decode -> storage -> CSV flush on
+*  this thread.
+*
+*  After the warmup steps the allocations of this thread are counted over the measured steps.
+*  Any allocation, or a record dropped for an exhausted record pool, fails the check with exit
+*  code 1. The allocations of the whole process, the
+*  calibration thread of TimeSync included, are printed for information only.
+*  Build with -DFORWARD_BUILD_BENCH=ON, run as
+*  alloc_check [measured steps] [warmup steps] [csv dir]
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+#include "common/alloc_counter.h"
+#include "common/time_sync.h"
+#include "classes/sender_mgr.h"
+#include "classes/storager_mgr.h"
+#include "classes/xudp_receiver.h"
+#include "structs/cmd_def.h"
+#include "structs/pack_helper.h"
+#include "structs/receiver_channel.h"
+#include "iguana/iguana.hpp"
+#include "nlohmann/json.hpp"
+
+using namespace forward::classes;
+using namespace forward::structs;
+using forward::common::AllocCounter;
+using forward::common::AllocStats;
+
+/**
+ * \brief loopback transport: datagrams sent in one dispatch() wait here for the receiver.
+ */
+struct Loopback : public DatagramTransport {
+    static constexpr uint32_t kSlots = 256;
+
+    xudp_msg msgs[kSlots];
+    char frames[kSlots][RetransmitRing::kMaxFrameSize];
+    uint32_t used{0};
+    uint64_t datagrams{0};
+    uint64_t dropped{0};        // 接收环满或报文过长
+
+    bool send(const uint8_t *data, uint32_t size, const struct sockaddr *) override {
+        if (used == kSlots || size > RetransmitRing::kMaxFrameSize) {
+            ++dropped;
+            return false;
+        }
+        xudp_msg *m = &msgs[used];
+        memcpy(frames[used], data, size);
+        memset(&m->peer_addr, 0, sizeof(m->peer_addr));
+        auto *peer = reinterpret_cast<struct sockaddr_in *>(&m->peer_addr);
+        peer->sin_family = AF_INET;
+        peer->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        m->p = frames[used];
+        m->size = size;
+        m->usec = 0;
+        ++used;
+        ++datagrams;
+        return true;
+    }
+};
+
+/**
+ * \brief receiver without xudp, the pipeline feeds it the datagrams of Loopback.
+ */
+class LoopbackReceiver : public XUdpReceiver {
+public:
+    using XUdpReceiver::XUdpReceiver;
+
+    void initialize_pipeline() {
+        init_pipeline();
+    }
+};
+
+static const char *kSenderChannels = R"([
+    {"channel_id": 1, "target_ip": "127.0.0.1", "target_port": 8100, "data_type": "StructA",
+     "priority": "latency", "sequence": true, "retransmit_slots": 1024, "fec_k": 8, "fec_m": 2},
+    {"channel_id": 2, "target_ip": "127.0.0.1", "target_port": 8100, "data_type": "StructB",
+     "priority": "bulk", "coalesce_bytes": 1400, "sequence": true}
+])";
+
+static const char *kReceiverChannel = R"(
+    {"local_ip": "127.0.0.1", "local_port": 8100, "data_types": ["StructA", "StructB"],
+     "nack": true, "workers": 0}
+)";
+
+/**
+ * \brief one message per channel through the whole pipeline, as the sending path of RuntimeSender.
+ */
+class Pipeline {
+public:
+    Pipeline(SenderMgr& sender_mgr, XUdpReceiver& receiver, Loopback& loopback)
+            : sender_mgr_(sender_mgr), receiver_(receiver), loopback_(loopback) {
+    }
+
+    void step() {
+        auto& ts = StorageMgr::get_instance();
+        StructACmd data_a;
+        data_a.data.ns = ts.get_ns();
+        data_a.data.num1 = rand() / 10000.0;
+        data_a.data.num2 = rand() / 10000.0;
+        data_a.data.total_id = total_id_;
+        data_a.data.data_id = data_id_++;
+        iguana::to_pb(data_a.data, s_);
+        PackHelper::makeupSerializeDataForCmd(s_, data_a.no, true, data_);
+        (void)sender_mgr_.enqueue(0, data_, ts.get_ns());
+
+        StructBCmd data_b;
+        data_b.data.ns = ts.get_ns();
+        data_b.data.num1 = rand() / 10000.0;
+        data_b.data.num2 = rand() / 10000.0;
+        snprintf(data_b.data.data, sizeof(data_b.data.data), "hello%ld", (long)data_id_);
+        data_b.data.total_id = total_id_;
+        data_b.data.data_id = data_id_++;
+        iguana::to_pb(data_b.data, s_);
+        PackHelper::makeupSerializeDataForCmd(s_, data_b.no, true, data_);
+        (void)sender_mgr_.enqueue(1, data_, ts.get_ns());
+
+        (void)sender_mgr_.dispatch(ts.get_ns());
+        ++total_id_;
+
+        // 与接收循环相同, 一批报文共用一个时间戳
+        (void)receiver_.begin_batch(Loopback::kSlots);
+        const int64_t rx_ns = ts.get_ns();
+        for (uint32_t i = 0; i < loopback_.used; ++i) {
+            receiver_.handle_recv_msg(&loopback_.msgs[i], rx_ns);
+        }
+        receiver_.end_batch();
+        loopback_.used = 0;
+    }
+
+    static constexpr uint32_t kMessagesPerStep = 2;
+
+private:
+    SenderMgr& sender_mgr_;
+    XUdpReceiver& receiver_;
+    Loopback& loopback_;
+    std::string s_;
+    std::vector<uint8_t> data_;
+    int64_t total_id_{1};
+    int64_t data_id_{1};
+};
+
+int main(int argc, char *argv[]) {
+    const uint64_t steps = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 100000U;
+    const uint64_t warmup = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 10000U;
+    const std::string dir = (argc > 3) ? argv[3] : "/tmp/forward_alloc_check";
+
+    if (!AllocCounter::enabled()) {
+        std::cout << "alloc_check built without FORWARD_ALLOC_COUNT, nothing is counted" << std::endl;
+        return 2;
+    }
+
+    auto& storage = StorageMgr::get_instance();
+    storage.initialize();
+    auto storager_a = std::make_shared<StructAStorager>(dir, "csv");
+    auto storager_b = std::make_shared<StructBStorager>(dir, "csv");
+    storage.add_storager("StructA", storager_a);
+    storage.add_storager("StructB", storager_b);
+
+    ReceiverChannel receiver_channel;
+    if (!receiver_channel.initialize(nlohmann::json::parse(kReceiverChannel))) {
+        return 2;
+    }
+    LoopbackReceiver receiver(receiver_channel);
+    receiver.initialize_pipeline();
+
+    const nlohmann::json sender_channels = nlohmann::json::parse(kSenderChannels);
+    auto loopback = std::make_unique<Loopback>();
+    SenderMgr sender_mgr(sender_channels, loopback.get());
+    sender_mgr.initialize();
+
+    Pipeline pipeline(sender_mgr, receiver, *loopback);
+    for (uint64_t i = 0; i < warmup; ++i) {
+        pipeline.step();
+    }
+
+    const AllocStats thread_begin = AllocCounter::thread_stats();
+    const AllocStats process_begin = AllocCounter::process_stats();
+    for (uint64_t i = 0; i < steps; ++i) {
+        pipeline.step();
+    }
+    const AllocStats thread_allocs = AllocCounter::thread_stats() - thread_begin;
+    const AllocStats process_allocs = AllocCounter::process_stats() - process_begin;
+
+    const uint64_t messages = steps * Pipeline::kMessagesPerStep;
+    std::cout << "messages: " << messages << " datagrams: " << loopback->datagrams
+              << " loopback dropped: " << loopback->dropped << std::endl;
+    for (const auto& stream : receiver.get_stream_stats()) {
+        std::cout << "channel " << stream.channel_id << " received: " << stream.counters.received
+                  << " lost: " << stream.counters.lost << " fec_parity: " << stream.fec.parity_received << std::endl;
+    }
+    std::cout << "pipeline thread allocs: " << thread_allocs.allocs << " frees: " << thread_allocs.frees
+              << " bytes: " << thread_allocs.bytes << " per message: "
+              << static_cast<double>(thread_allocs.allocs) / static_cast<double>(messages) << std::endl;
+    std::cout << "process allocs (background threads included): " << process_allocs.allocs
+              << " frees: " << process_allocs.frees << std::endl;
+    for (const auto& storager : {std::static_pointer_cast<DataStorager>(storager_a),
+                                 std::static_pointer_cast<DataStorager>(storager_b)}) {
+        const forward::common::PoolStats pool = storager->getPoolStats();
+        std::cout << "record pool capacity: " << pool.capacity << " high water: " << pool.high_water
+                  << " exhausted: " << pool.exhausted << std::endl;
+    }
+
+    if (loopback->dropped != 0U || thread_allocs.allocs != 0U
+        || storager_a->getPoolStats().exhausted != 0U || storager_b->getPoolStats().exhausted != 0U) {
+        std::cout << "FAIL: the steady state must not allocate or drop" << std::endl;
+        return 1;
+    }
+    std::cout << "OK: no allocation in steady state" << std::endl;
+    return 0;
+}
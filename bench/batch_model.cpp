@@ -0,0 +1,125 @@
+/**
+* @file batch_model.cpp
+* @brief model of the BatchSizer policy: how fixed and adaptive batch sizes trade loss for latency
+* @details This is a model of the policy, not a measurement of the receiver. The receive loop is
+*  replayed on a simulated clock with a cost model given on the command line: every receive call
+*  costs call_ns plus packet_ns per packet taken and takes at most the batch size chosen by
+*  BatchSizer. Packets arrive in bursts of kBurst at line rate, the bursts are spaced to give the
+*  offered average rate. The rx ring holds kRingSize packets, a packet that finds it full is lost,
+*  like on an exhausted fill ring. Latency runs from the arrival to the point the packet is handed
+*  on. The numbers only hold for the cost model given; the real per call and per packet costs
+*  depend on the NIC, the driver and the decode work and have to be measured on the target host.
+*  Build with -DFORWARD_BUILD_BENCH=ON, run as batch_model [packets per case] [call_ns] [packet_ns].
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "classes/batch_sizer.h"
+
+using forward::classes::BatchSizer;
+
+static constexpr uint32_t kRingSize = 4096;
+static constexpr uint32_t kBurst = 64;          // 每个突发的报文数
+static constexpr double kLineRatePps = 14.88e6; // 10G线速小包
+
+// 成本模型: 每次接收调用的固定开销(唤醒, 回收, 提交)和每个报文的处理开销
+struct Cost {
+    int64_t call_ns;
+    int64_t packet_ns;
+};
+
+struct Result {
+    double pps;
+    double lost_ratio;
+    double avg_batch;
+    int64_t p50_ns;
+    int64_t p99_ns;
+};
+
+static Result run(const Cost& cost, double offered_pps, uint32_t min_size, uint32_t max_size, uint64_t packets) {
+    const double burst_gap_ns = 1e9 * kBurst / offered_pps;
+    const double packet_gap_ns = 1e9 / kLineRatePps;
+    auto arrival = [&](uint64_t i) {
+        return static_cast<int64_t>(static_cast<double>(i / kBurst) * burst_gap_ns
+                                    + static_cast<double>(i % kBurst) * packet_gap_ns);
+    };
+
+    BatchSizer sizer(min_size, max_size);
+    std::deque<int64_t> ring;
+    std::vector<int64_t> latencies;
+    latencies.reserve(packets);
+    uint64_t next = 0;      // 下一个到达的报文
+    uint64_t lost = 0;
+    int64_t now = 0;
+    while (next < packets || !ring.empty()) {
+        // 到达时间不晚于now的报文进入接收环, 环满则丢弃
+        for (; next < packets && arrival(next) <= now; ++next) {
+            if (ring.size() >= kRingSize) {
+                ++lost;
+                continue;
+            }
+            ring.push_back(arrival(next));
+        }
+        if (ring.empty()) {
+            now = arrival(next);    // 空闲, 等待下一个报文
+            continue;
+        }
+        const uint32_t used = std::min<uint32_t>(sizer.size(), static_cast<uint32_t>(ring.size()));
+        now += cost.call_ns;
+        for (uint32_t i = 0; i < used; ++i) {
+            now += cost.packet_ns;
+            latencies.push_back(now - ring.front());
+            ring.pop_front();
+        }
+        sizer.on_fill(used);
+    }
+
+    Result r{};
+    r.pps = static_cast<double>(latencies.size()) * 1e9 / static_cast<double>(now);
+    r.lost_ratio = static_cast<double>(lost) / static_cast<double>(packets);
+    const auto& c = sizer.get_counters();
+    r.avg_batch = (c.calls == 0U) ? 0.0 : static_cast<double>(c.messages) / static_cast<double>(c.calls);
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        r.p50_ns = latencies[latencies.size() / 2U];
+        r.p99_ns = latencies[latencies.size() * 99U / 100U];
+    }
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    const uint64_t packets = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 2000000ULL;
+    const Cost cost{(argc > 2) ? strtoll(argv[2], nullptr, 10) : 1500, (argc > 3) ? strtoll(argv[3], nullptr, 10) : 50};
+    if (packets == 0U || cost.call_ns < 0 || cost.packet_ns <= 0) {
+        fprintf(stderr, "usage: %s [packets per case] [call_ns] [packet_ns]\n", argv[0]);
+        return 1;
+    }
+    const double loads[] = {1e5, 1e6, 3e6, 6e6, 9e6, 12e6};
+    struct Mode {
+        const char *name;
+        uint32_t min_size;
+        uint32_t max_size;
+    };
+    const Mode modes[] = {{"fixed 16", 16, 16}, {"fixed 100", 100, 100}, {"fixed 256", 256, 256},
+                          {"adaptive 16-256", 16, 256}};
+
+    printf("policy model, not a measurement: call %ld ns, packet %ld ns, burst %u, ring %u, %lu packets per case\n",
+           (long)cost.call_ns, (long)cost.packet_ns, kBurst, kRingSize, (unsigned long)packets);
+    printf("%12s %-16s %12s %8s %10s %10s %10s\n", "offered pps", "batch", "model pps", "lost %",
+           "avg batch", "p50 us", "p99 us");
+    for (const double load : loads) {
+        for (const Mode& mode : modes) {
+            const Result r = run(cost, load, mode.min_size, mode.max_size, packets);
+            printf("%12.0f %-16s %12.0f %8.2f %10.1f %10.2f %10.2f\n", load, mode.name, r.pps,
+                   r.lost_ratio * 100.0, r.avg_batch, static_cast<double>(r.p50_ns) / 1e3,
+                   static_cast<double>(r.p99_ns) / 1e3);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+/**
+* @file fec_bench.cpp
+* @brief encode / decode cost per packet of the FEC parity kernels
+* @details For each (k, m, frame size) the benchmark encodes blocks, then drops min(m, k) data
+*  symbols per block and rebuilds them. Costs are reported per data packet.
+*  Build with -DFORWARD_BUILD_BENCH=ON, add -DFORWARD_NATIVE_ARCH=ON to enable the SIMD kernels.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "classes/fec_codec.h"
+
+using forward::classes::FecCodec;
+using Clock = std::chrono::steady_clock;
+
+struct Case {
+    uint32_t k;
+    uint32_t m;
+    size_t len;
+};
+
+static double ns_since(Clock::time_point begin) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+}
+
+static void run(const Case& c, uint32_t blocks) {
+    std::vector<std::vector<uint8_t>> data(c.k, std::vector<uint8_t>(c.len));
+    std::vector<std::vector<uint8_t>> parity(c.m, std::vector<uint8_t>(c.len));
+    for (auto& d : data) {
+        for (auto& b : d) {
+            b = static_cast<uint8_t>(rand());
+        }
+    }
+    const uint8_t* in[FecCodec::kMaxData];
+    uint8_t* rw[FecCodec::kMaxData];
+    uint8_t* out[FecCodec::kMaxParity];
+    const uint8_t* pin[FecCodec::kMaxParity];
+    for (uint32_t i = 0; i < c.k; ++i) {
+        in[i] = data[i].data();
+        rw[i] = data[i].data();
+    }
+    for (uint32_t j = 0; j < c.m; ++j) {
+        out[j] = parity[j].data();
+        pin[j] = parity[j].data();
+    }
+
+    auto begin = Clock::now();
+    for (uint32_t b = 0; b < blocks; ++b) {
+        FecCodec::encode(c.k, c.m, in, out, c.len);
+    }
+    const double encode_ns = ns_since(begin) / (static_cast<double>(blocks) * c.k);
+
+    const uint32_t losses = std::min(c.k, c.m);
+    bool data_present[FecCodec::kMaxData];
+    bool parity_present[FecCodec::kMaxParity];
+    for (uint32_t j = 0; j < c.m; ++j) {
+        parity_present[j] = true;
+    }
+    const auto reference = data;
+    bool ok = true;
+    begin = Clock::now();
+    for (uint32_t b = 0; b < blocks; ++b) {
+        for (uint32_t i = 0; i < c.k; ++i) {
+            data_present[i] = (i < b % c.k) || (i >= b % c.k + losses);
+        }
+        ok &= FecCodec::decode(c.k, c.m, rw, data_present, pin, parity_present, c.len);
+    }
+    const double decode_ns = ns_since(begin) / (static_cast<double>(blocks) * c.k);
+    ok &= (data == reference);
+
+    printf("k=%-3u m=%-2u len=%-5zu encode %8.1f ns/pkt  decode(%u lost) %8.1f ns/pkt  %.2f GB/s encode  %s\n",
+           c.k, c.m, c.len, encode_ns, losses, decode_ns,
+           static_cast<double>(c.len) / encode_ns, ok ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+    const uint32_t blocks = (argc > 1) ? static_cast<uint32_t>(atoi(argv[1])) : 200000U;
+#if defined(__AVX2__)
+    printf("kernel: avx2\n");
+#elif defined(__SSSE3__)
+    printf("kernel: ssse3\n");
+#else
+    printf("kernel: scalar\n");
+#endif
+    const Case cases[] = {
+        {8, 1, 64}, {8, 1, 256}, {8, 1, 1400},
+        {8, 2, 64}, {8, 2, 256}, {8, 2, 1400},
+        {16, 4, 64}, {16, 4, 256}, {16, 4, 1400},
+        {32, 8, 256},
+    };
+    for (const auto& c : cases) {
+        run(c, c.len > 512U ? blocks / 8U : blocks);
+    }
+    return 0;
+}
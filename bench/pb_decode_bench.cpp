@@ -0,0 +1,117 @@
+/**
+* @file pb_decode_bench.cpp
+* @brief decode cost of iguana::from_pb vs the bounds checked PbDecoder
+* @details Encodes StructA and StructB with iguana::to_pb and decodes them in a loop with both
+*  decoders. The malformed case cuts every payload at each length shorter than the full one, iguana
+*  reports those with exceptions, PbDecoder with an error code.
+*  Build with -DFORWARD_BUILD_BENCH=ON, run as pb_decode_bench [iterations].
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "structs/structs.h"
+#include "iguana/iguana.hpp"
+#include "tools/pb_decode.h"
+
+using forward::structs::StructA;
+using forward::structs::StructB;
+using forward::tool::PbDecoder;
+using Clock = std::chrono::steady_clock;
+
+static double ns_since(Clock::time_point begin) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+}
+
+static volatile uint64_t g_sink;    // 防止解码结果被优化掉
+
+template <typename T>
+static void bench_valid(const char *name, const std::string& pb, uint32_t iterations) {
+    T record{};
+    auto begin = Clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        iguana::from_pb(record, pb);
+        g_sink = g_sink + record.total_id;
+    }
+    const double iguana_ns = ns_since(begin) / iterations;
+
+    begin = Clock::now();
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < iterations; ++i) {
+        errors += PbDecoder::decode(record, pb) ? 1U : 0U;
+        g_sink = g_sink + record.total_id;
+    }
+    const double checked_ns = ns_since(begin) / iterations;
+    printf("%-8s valid      %4zu bytes  iguana %7.1f ns  checked %7.1f ns  errors %u\n", name, pb.size(),
+           iguana_ns, checked_ns, errors);
+}
+
+template <typename T>
+static void bench_malformed(const char *name, const std::string& pb, uint32_t iterations) {
+    // 每个截断长度各解码一次
+    const uint32_t rounds = iterations / static_cast<uint32_t>(pb.size()) + 1U;
+    uint64_t calls = 0;
+    uint64_t failures = 0;
+    T record{};
+    auto begin = Clock::now();
+    for (uint32_t r = 0; r < rounds; ++r) {
+        for (size_t len = 1; len < pb.size(); ++len) {
+            try {
+                iguana::from_pb(record, std::string_view(pb.data(), len));
+            } catch (const std::exception&) {
+                ++failures;
+            }
+            ++calls;
+        }
+    }
+    const double iguana_ns = ns_since(begin) / static_cast<double>(calls);
+    const uint64_t iguana_failures = failures;
+
+    failures = 0;
+    begin = Clock::now();
+    for (uint32_t r = 0; r < rounds; ++r) {
+        for (size_t len = 1; len < pb.size(); ++len) {
+            failures += PbDecoder::decode(record, std::string_view(pb.data(), len)) ? 1U : 0U;
+        }
+    }
+    const double checked_ns = ns_since(begin) / static_cast<double>(calls);
+    printf("%-8s truncated  %4zu cuts   iguana %7.1f ns  checked %7.1f ns  rejected %lu / %lu\n", name,
+           pb.size() - 1U, iguana_ns, checked_ns, (unsigned long)(failures / rounds),
+           (unsigned long)(iguana_failures / rounds));
+}
+
+int main(int argc, char *argv[]) {
+    const uint32_t iterations = (argc > 1) ? static_cast<uint32_t>(atoi(argv[1])) : 2000000U;
+
+    StructA a{};
+    a.ns = 1760000000123456789ULL;
+    a.num1 = 12345.678;
+    a.num2 = 0.001;
+    a.total_id = 123456789;
+    a.data_id = 42;
+    std::string pb_a;
+    iguana::to_pb(a, pb_a);
+
+    StructB b{};
+    b.ns = 1760000000123456789ULL;
+    b.num1 = 12345.678;
+    b.num2 = 0.001;
+    strncpy(b.data, "hello123456", sizeof(b.data) - 1U);
+    b.total_id = 123456789;
+    b.data_id = 42;
+    std::string pb_b;
+    iguana::to_pb(b, pb_b);
+
+    printf("%u iterations, per decode, rejected counts are checked / iguana\n", iterations);
+    bench_valid<StructA>("StructA", pb_a, iterations);
+    bench_valid<StructB>("StructB", pb_b, iterations);
+    bench_malformed<StructA>("StructA", pb_a, iterations / 10U);
+    bench_malformed<StructB>("StructB", pb_b, iterations / 10U);
+    return 0;
+}
@@ -0,0 +1,223 @@
+/**
+* @file time_sync_bench.cpp
+* @brief cost, seqlock retries and long-run error of TimeSync::get_ns / tsc2ns
+* @details The benchmark stops the calibration thread of TimeSync and takes its role, so the
+*  writer rate is under control. For 1, 2, 4 .. max readers it runs each case twice: once with
+*  no writer and once with a writer republishing the parameters through saveParam() every
+*  kWritePeriodUs. That is far more often than the calibrate_interval used in production, which
+*  makes it the worst case for the seqlock. Each reader first times get_ns(), then tsc2ns() with
+*  the retry counting overload. The drift phase then calls calibrate() once a second, as the
+*  calibration thread does, and samples get_ns() against CLOCK_REALTIME.
+*  The JSON report goes to stdout and a table to stderr. Diff the JSON across hosts and builds.
+*  Build with -DFORWARD_BUILD_BENCH=ON, run as
+*  time_sync_bench [seconds per case] [max readers] [drift seconds] > report.json
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "common/time_sync.h"
+#include "nlohmann/json.hpp"
+
+using forward::common::ClockSource;
+using forward::common::TimeSync;
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint32_t kWritePeriodUs = 100;     // 写者重新发布参数的周期
+static constexpr uint32_t kChunk = 1024;            // 读者每批调用次数, 批间检查停止标志
+static constexpr size_t kMaxSeries = 600;           // 报告中误差序列的最多点数
+
+static volatile int64_t g_sink;     // 防止读取结果被优化掉
+
+struct ReaderResult {
+    uint64_t get_ns_calls{0};
+    double get_ns_seconds{0.0};
+    uint64_t tsc2ns_calls{0};
+    double tsc2ns_seconds{0.0};
+    uint64_t retries{0};
+};
+
+static double seconds_since(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+static void reader(const TimeSync& ts, const std::atomic<int>& phase, ReaderResult& r) {
+    int64_t sum = 0;
+    while (phase.load(std::memory_order_acquire) == 0) {
+    }
+    auto begin = Clock::now();
+    while (phase.load(std::memory_order_relaxed) == 1) {
+        for (uint32_t i = 0; i < kChunk; ++i) {
+            sum += ts.get_ns();
+        }
+        r.get_ns_calls += kChunk;
+    }
+    r.get_ns_seconds = seconds_since(begin);
+    begin = Clock::now();
+    while (phase.load(std::memory_order_relaxed) == 2) {
+        const int64_t tsc = TimeSync::rdtsc();
+        for (uint32_t i = 0; i < kChunk; ++i) {
+            sum += ts.tsc2ns(tsc + i, r.retries);
+        }
+        r.tsc2ns_calls += kChunk;
+    }
+    r.tsc2ns_seconds = seconds_since(begin);
+    g_sink = sum;
+}
+
+// 与校准线程相同的方式重新发布当前参数, 时间保持连续
+static void writer(TimeSync& ts, const std::atomic<int>& phase, uint64_t& writes) {
+    while (phase.load(std::memory_order_acquire) < 3) {
+        int64_t tsc, ns;
+        TimeSync::syncTime(tsc, ns);
+        ts.saveParam(tsc, ts.tsc2ns(tsc), ns, 1.0 / ts.getTscGhz());
+        ++writes;
+        std::this_thread::sleep_for(std::chrono::microseconds(kWritePeriodUs));
+    }
+}
+
+static nlohmann::json run_case(TimeSync& ts, uint32_t readers, bool with_writer, double seconds) {
+    std::atomic<int> phase{0};
+    std::vector<ReaderResult> results(readers);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < readers; ++i) {
+        threads.emplace_back(reader, std::cref(ts), std::cref(phase), std::ref(results[i]));
+    }
+    uint64_t writes = 0;
+    std::thread write_thread;
+    if (with_writer) {
+        write_thread = std::thread(writer, std::ref(ts), std::cref(phase), std::ref(writes));
+    }
+    const auto half = std::chrono::duration<double>(seconds / 2.0);
+    phase.store(1, std::memory_order_release);
+    std::this_thread::sleep_for(half);
+    phase.store(2, std::memory_order_release);
+    std::this_thread::sleep_for(half);
+    phase.store(3, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (write_thread.joinable()) {
+        write_thread.join();
+    }
+
+    ReaderResult total;
+    double get_ns_per_call_sum = 0.0, tsc2ns_per_call_sum = 0.0;
+    for (const auto& r : results) {
+        total.get_ns_calls += r.get_ns_calls;
+        total.tsc2ns_calls += r.tsc2ns_calls;
+        total.retries += r.retries;
+        get_ns_per_call_sum += r.get_ns_seconds * 1e9 / static_cast<double>(std::max<uint64_t>(r.get_ns_calls, 1U));
+        tsc2ns_per_call_sum += r.tsc2ns_seconds * 1e9 / static_cast<double>(std::max<uint64_t>(r.tsc2ns_calls, 1U));
+    }
+    nlohmann::json c;
+    c["readers"] = readers;
+    c["writer"] = with_writer;
+    c["writes"] = writes;
+    c["get_ns_calls_per_sec_per_thread"] = static_cast<double>(total.get_ns_calls) / (seconds / 2.0) / readers;
+    c["get_ns_ns_per_call"] = get_ns_per_call_sum / readers;
+    c["tsc2ns_calls_per_sec_per_thread"] = static_cast<double>(total.tsc2ns_calls) / (seconds / 2.0) / readers;
+    c["tsc2ns_ns_per_call"] = tsc2ns_per_call_sum / readers;
+    c["seqlock_retries"] = total.retries;
+    c["retries_per_million_calls"] =
+            static_cast<double>(total.retries) * 1e6 / static_cast<double>(std::max<uint64_t>(total.tsc2ns_calls, 1U));
+    fprintf(stderr, "%7u %6s %10lu %12.1f %12.1f %14lu %12.3f\n", readers, with_writer ? "yes" : "no",
+            (unsigned long)writes, c["get_ns_ns_per_call"].get<double>(), c["tsc2ns_ns_per_call"].get<double>(),
+            (unsigned long)total.retries, c["retries_per_million_calls"].get<double>());
+    return c;
+}
+
+static nlohmann::json run_drift(TimeSync& ts, uint32_t seconds) {
+    std::vector<int64_t> errors;
+    errors.reserve(seconds);
+    for (uint32_t s = 0; s < seconds; ++s) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        (void)ts.calibrate();
+        // syncTime取窗口最短的一对读数, 误差为get_ns相对CLOCK_REALTIME的偏差
+        int64_t tsc, ns;
+        TimeSync::syncTime(tsc, ns);
+        errors.push_back(ts.tsc2ns(tsc) - ns);
+    }
+
+    nlohmann::json d;
+    d["seconds"] = seconds;
+    if (errors.empty()) {
+        return d;
+    }
+    double sum = 0.0;
+    int64_t max_abs = 0;
+    std::vector<int64_t> abs_errors;
+    for (const int64_t e : errors) {
+        sum += static_cast<double>(e);
+        max_abs = std::max<int64_t>(max_abs, std::llabs(e));
+        abs_errors.push_back(std::llabs(e));
+    }
+    std::sort(abs_errors.begin(), abs_errors.end());
+    d["mean_err_ns"] = sum / static_cast<double>(errors.size());
+    d["p50_abs_err_ns"] = abs_errors[abs_errors.size() / 2U];
+    d["p99_abs_err_ns"] = abs_errors[abs_errors.size() * 99U / 100U];
+    d["max_abs_err_ns"] = max_abs;
+    d["final_err_ns"] = errors.back();
+    // 长时间运行时抽样, 报告大小不随时长增长
+    const size_t step = (errors.size() + kMaxSeries - 1U) / kMaxSeries;
+    d["series_step_s"] = step;
+    d["series_err_ns"] = nlohmann::json::array();
+    for (size_t i = 0; i < errors.size(); i += step) {
+        d["series_err_ns"].push_back(errors[i]);
+    }
+    fprintf(stderr, "drift %u s: mean %.1f ns, p99 |err| %ld ns, max |err| %ld ns\n", seconds,
+            d["mean_err_ns"].get<double>(), (long)d["p99_abs_err_ns"].get<int64_t>(), (long)max_abs);
+    return d;
+}
+
+int main(int argc, char *argv[]) {
+    const double case_seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    const uint32_t hw = std::max(1U, std::thread::hardware_concurrency());
+    const uint32_t max_readers = (argc > 2) ? static_cast<uint32_t>(atoi(argv[2])) : hw;
+    const uint32_t drift_seconds = (argc > 3) ? static_cast<uint32_t>(atoi(argv[3])) : 60U;
+
+    TimeSync& ts = TimeSync::get_instance();
+    ts.init();
+    // 由本程序代替校准线程, 控制参数发布的频率
+    ts.stop_calibration_thread();
+
+    char host[256] = {0};
+    (void)gethostname(host, sizeof(host) - 1U);
+    nlohmann::json report;
+    report["bench"] = "time_sync";
+    report["host"] = host;
+    report["hardware_concurrency"] = hw;
+    report["clock_source"] = (TimeSync::get_clock_source() == ClockSource::kTsc) ? "tsc" : "monotonic_raw";
+    report["invariant_tsc"] = TimeSync::has_invariant_tsc();
+    report["tsc_ghz"] = ts.getTscGhz();
+    report["tsc_skew_ns"] = ts.measure_tsc_skew();
+    report["write_period_us"] = kWritePeriodUs;
+    report["seconds_per_case"] = case_seconds;
+
+    fprintf(stderr, "%7s %6s %10s %12s %12s %14s %12s\n", "readers", "writer", "writes", "get_ns ns",
+            "tsc2ns ns", "retries", "retries/1M");
+    report["cases"] = nlohmann::json::array();
+    // 1, 2, 4 .. 以及max_readers本身
+    std::vector<uint32_t> reader_counts;
+    for (uint32_t readers = 1; readers < max_readers; readers *= 2U) {
+        reader_counts.push_back(readers);
+    }
+    reader_counts.push_back(std::max(1U, max_readers));
+    for (const uint32_t readers : reader_counts) {
+        report["cases"].push_back(run_case(ts, readers, false, case_seconds));
+        report["cases"].push_back(run_case(ts, readers, true, case_seconds));
+    }
+    report["drift"] = run_drift(ts, drift_seconds);
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+}
@@ -0,0 +1,87 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file batch_sizer.h
+* @brief receive batch size that follows the load
+* @details The size starts at min. A call that fills the whole batch means more packets are
+*  waiting, so the size doubles, up to max, and the next call amortizes more of the burst. After
+*  kShrinkAfter calls in a row that used at most a quarter of the batch the size halves again, so
+*  at low rates the first packets of a burst are handed on without waiting for a large batch.
+*  min == max gives a fixed batch.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace forward{
+namespace classes{
+class BatchSizer {
+public:
+    static constexpr uint32_t kShrinkAfter = 8;     // 连续多少次轻载后减半
+
+    struct Counters {
+        uint64_t calls{0};
+        uint64_t messages{0};
+        uint64_t grows{0};
+        uint64_t shrinks{0};
+    };
+
+    BatchSizer(uint32_t min_size, uint32_t max_size)
+            : min_(std::max(min_size, 1U)), max_(std::max(max_size, std::max(min_size, 1U))), size_(min_) {}
+
+    uint32_t size() const {
+        return size_;
+    }
+
+    uint32_t max_size() const {
+        return max_;
+    }
+
+    /**
+     * \brief account one receive call that returned used messages.
+     */
+    void on_fill(uint32_t used) {
+        ++counters_.calls;
+        counters_.messages += used;
+        if (used >= size_) {
+            light_ = 0;
+            if (size_ < max_) {
+                size_ = std::min(size_ * 2U, max_);
+                ++counters_.grows;
+            }
+            return;
+        }
+        if (used * 4U > size_) {
+            light_ = 0;
+            return;
+        }
+        if (++light_ >= kShrinkAfter) {
+            light_ = 0;
+            if (size_ > min_) {
+                size_ = std::max(size_ / 2U, min_);
+                ++counters_.shrinks;
+            }
+        }
+    }
+
+    const Counters& get_counters() const {
+        return counters_;
+    }
+
+private:
+    uint32_t min_;
+    uint32_t max_;
+    uint32_t size_;
+    uint32_t light_{0};
+    Counters counters_;
+};
+}
+}
+/** @}*/    // end of group forward
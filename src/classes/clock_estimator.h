@@ -0,0 +1,190 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file clock_estimator.h
+* @brief offset and drift of a remote clock, estimated from ping/pong timestamp exchanges
+* @details Every exchange yields the four PTP timestamps t1 (ping sent, local), t2 (ping received,
+*  remote), t3 (pong sent, remote) and t4 (pong received, local), so
+*      rtt    = (t4 - t1) - (t3 - t2)
+*      offset = ((t2 - t1) + (t3 - t4)) / 2     remote clock minus local clock
+*  The offset error is bounded by the path asymmetry, which grows with queueing, so only the
+*  minimum RTT sample of every kWindow exchanges is kept. The last kHistory window minima whose
+*  RTT is close to the best one are fitted by least squares: offset(t) = offset + drift * (t - ref).
+*
+*  Single writer: only the receive thread calls on_sample(). The estimate is published with a
+*  sequence lock, like TimeSync, so offset_at() may be called from any thread.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace forward{
+namespace classes{
+class ClockEstimator {
+public:
+    static constexpr uint32_t kWindow = 8;          // 每kWindow个样本取RTT最小的一个
+    static constexpr uint32_t kHistory = 16;        // 参与拟合的窗口数
+    static constexpr int64_t kRttSlackNs = 20000;   // 比最小RTT大出此值以上的窗口不参与拟合
+
+    /**
+     * \brief snapshot of the estimate and counters.
+     */
+    struct Counters {
+        bool valid{false};
+        uint64_t samples{0};
+        uint64_t rejected{0};       // RTT为负, 时间戳不可信
+        int64_t min_rtt_ns{0};
+        int64_t offset_ns{0};       // 对端时钟减本地时钟, 在最近一次拟合时刻
+        double drift_ppb{0.0};      // 对端时钟相对本地时钟的频率偏差
+    };
+
+    ClockEstimator() = default;
+    ClockEstimator(const ClockEstimator&) = delete;
+    ClockEstimator& operator=(const ClockEstimator&) = delete;
+
+    void on_sample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+        const int64_t rtt = (t4 - t1) - (t3 - t2);
+        if (rtt < 0) {
+            bump(rejected_);
+            return;
+        }
+        bump(samples_);
+        if (rtt < window_best_.rtt) {
+            window_best_.rtt = rtt;
+            window_best_.local_ns = t1 + (t4 - t1) / 2;
+            window_best_.offset = ((t2 - t1) + (t3 - t4)) / 2;
+        }
+        if (++window_count_ < kWindow) {
+            return;
+        }
+        history_[history_next_ % kHistory] = window_best_;
+        ++history_next_;
+        window_best_ = Sample{};
+        window_count_ = 0;
+        refit();
+    }
+
+    /**
+     * \return remote clock minus local clock at local time local_ns, 0 before the first estimate.
+     */
+    int64_t offset_at(int64_t local_ns) const {
+        while (true) {
+            const uint32_t before_seq = seq_.load(std::memory_order_acquire) & ~1U;
+            std::atomic_signal_fence(std::memory_order_acq_rel);
+            const int64_t offset = offset_ + static_cast<int64_t>(drift_ * static_cast<double>(local_ns - ref_ns_));
+            std::atomic_signal_fence(std::memory_order_acq_rel);
+            if (before_seq == seq_.load(std::memory_order_acquire)) {
+                return offset;
+            }
+        }
+    }
+
+    bool valid() const {
+        return valid_.load(std::memory_order_acquire);
+    }
+
+    Counters get_counters() const {
+        Counters c;
+        c.valid = valid();
+        c.samples = samples_.load(std::memory_order_relaxed);
+        c.rejected = rejected_.load(std::memory_order_relaxed);
+        c.min_rtt_ns = min_rtt_ns_.load(std::memory_order_relaxed);
+        while (true) {
+            const uint32_t before_seq = seq_.load(std::memory_order_acquire) & ~1U;
+            std::atomic_signal_fence(std::memory_order_acq_rel);
+            c.offset_ns = offset_;
+            c.drift_ppb = drift_ * 1e9;
+            std::atomic_signal_fence(std::memory_order_acq_rel);
+            if (before_seq == seq_.load(std::memory_order_acquire)) {
+                return c;
+            }
+        }
+    }
+
+private:
+    struct Sample {
+        int64_t rtt{std::numeric_limits<int64_t>::max()};
+        int64_t local_ns{0};    // 本地时钟下的交换中点
+        int64_t offset{0};
+    };
+
+    void refit() {
+        const uint32_t count = (history_next_ < kHistory) ? history_next_ : kHistory;
+        int64_t min_rtt = std::numeric_limits<int64_t>::max();
+        for (uint32_t i = 0; i < count; ++i) {
+            if (history_[i].rtt < min_rtt) {
+                min_rtt = history_[i].rtt;
+            }
+        }
+        min_rtt_ns_.store(min_rtt, std::memory_order_relaxed);
+
+        // 以最新样本为原点做最小二乘, 避免大数相减丢失精度
+        const Sample& latest = history_[(history_next_ - 1U) % kHistory];
+        const int64_t limit = min_rtt + min_rtt / 2 + kRttSlackNs;
+        double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (history_[i].rtt > limit) {
+                continue;
+            }
+            const double x = static_cast<double>(history_[i].local_ns - latest.local_ns);
+            const double y = static_cast<double>(history_[i].offset - latest.offset);
+            n += 1.0;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+        if (n == 0.0) {
+            return;
+        }
+        double drift = 0.0;
+        const double denominator = n * sxx - sx * sx;
+        if (n >= 2.0 && denominator > 0.0) {
+            drift = (n * sxy - sx * sy) / denominator;
+        }
+        const double intercept = (sy - drift * sx) / n;
+
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(++seq, std::memory_order_release);
+        std::atomic_signal_fence(std::memory_order_acq_rel);
+        ref_ns_ = latest.local_ns;
+        offset_ = latest.offset + static_cast<int64_t>(intercept);
+        drift_ = drift;
+        std::atomic_signal_fence(std::memory_order_acq_rel);
+        seq_.store(++seq, std::memory_order_release);
+        valid_.store(true, std::memory_order_release);
+    }
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1U) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // 仅接收线程访问
+    Sample window_best_{};
+    uint32_t window_count_{0};
+    std::array<Sample, kHistory> history_{};
+    uint32_t history_next_{0};
+
+    // 由seq_保护的估计值
+    alignas(64) std::atomic<uint32_t> seq_{0};
+    int64_t ref_ns_{0};
+    int64_t offset_{0};
+    double drift_{0.0};
+
+    std::atomic<bool> valid_{false};
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<int64_t> min_rtt_ns_{0};
+};
+}
+}
+/** @}*/    // end of group forward
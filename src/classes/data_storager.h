@@ -59,25 +59,61 @@ struct alignas(64) TradesData {
 #include <map>
 #include <mutex>
 #include <boost/any.hpp>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 
 #include "structs/structs.h"
+#include "common/tracer.h"
+#include "common/logger.h"
+#include "common/metrics.h"
+#include "common/memory_hardening.h"
+#include "record_buffer.h"
 
 using namespace forward::structs;
 
 class DataStorager {
 public:
     DataStorager(const std::string& dir, const std::string& file_type)
-        : dir_(dir), file_type_(file_type) {}
+        : dir_(dir), file_type_(file_type) {
+        csv_buffer_.reserve(MAX_BUFFER_SIZE * kCsvLineMax);
+    }
 
     virtual void asyncWrite(const boost::any& data) = 0;
+
+    /**
+     * \brief append count records of this storager's type, stored contiguously at records.
+     *
+     * Takes mutex_ once for the whole batch and appends it to the buffer in one copy.
+     */
+    virtual void asyncWriteBatch(const void *records, size_t count) = 0;
+
+    /**
+     * \brief an empty RecordBlock of this storager's type from its pool, nullptr if exhausted.
+     */
+    virtual void* acquireBlock() = 0;
+
+    /**
+     * \brief hand over a block from acquireBlock(), the records are not copied.
+     *
+     * The storager owns the block from now on and releases it to the pool after the flush, an
+     * empty block is released right away.
+     */
+    virtual void asyncWriteBlock(void *block) = 0;
+
+    virtual forward::common::PoolStats getPoolStats() const = 0;
 protected:
     virtual void flushBuffer() = 0;
 
+    // ts为纳秒, 日期不超过15个字符, 返回的字符串不在堆上分配; 多个工作线程并发调用, 用localtime_r
     std::string getDateFromTimestamp(int64_t ts) {
-        std::time_t time = static_cast<std::time_t>(ts / 1000);
-        std::tm* tm = std::localtime(&time);
-        char date[11];
-        std::strftime(date, sizeof(date), "%Y-%m-%d", tm);
+        std::time_t time = static_cast<std::time_t>(ts / 1000000000);
+        std::tm tm{};
+        char date[11] = {0};
+        if (localtime_r(&time, &tm) != nullptr) {
+            (void)std::strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+        }
         return std::string(date);
     }
 
@@ -88,11 +124,50 @@ protected:
         return p;
     }
 
+    // 在派生类设置data_type_之后调用
+    void registerMetrics() {
+        auto& metrics = forward::common::MetricsRegistry::get_instance();
+        const std::string labels = "type=\"" + data_type_ + "\"";
+        records_ = metrics.counter("forward_sink_records_total", labels);
+        flushes_ = metrics.counter("forward_sink_flushes_total", labels);
+        flush_ns_total_ = metrics.counter("forward_sink_flush_ns_total", labels);
+        buffer_occupancy_ = metrics.gauge("forward_sink_buffer_occupancy", labels);
+        flush_ns_last_ = metrics.gauge("forward_sink_flush_ns_last", labels);
+        flush_ns_max_ = metrics.gauge("forward_sink_flush_ns_max", labels);
+    }
+
+    void recordFlush(std::chrono::steady_clock::time_point start) {
+        const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        flushes_.add();
+        flush_ns_total_.add(ns);
+        flush_ns_last_.set(ns);
+        flush_ns_max_.set_max(ns);
+        buffer_occupancy_.set(0);
+    }
+
+    // 当天文件的句柄缓存在csv_file_, 只有换日后的第一次flush才生成路径和查表
+    std::ofstream& csvFile(const std::string& date) {
+        if (csv_file_ == nullptr || csv_date_ != date) {
+            const std::filesystem::path p = generatePath(date);
+            FORWARD_LOG(forward::common::LogLevel::kDebug, "generatePath %s", p.string());
+            auto it = csv_open_files_.find(p.string());
+            if (it == csv_open_files_.end()) {
+                std::filesystem::create_directories(p.parent_path());
+                it = csv_open_files_.emplace(p.string(), std::ofstream(p, std::ios::app)).first;
+            }
+            csv_file_ = &it->second;
+            csv_date_ = date;
+        }
+        return *csv_file_;
+    }
+
     void closeFile(const std::string& path, const std::string& file_type) {
         if (file_type == "csv") {
             if (csv_open_files_.find(path) != csv_open_files_.end()) {
                 csv_open_files_[path].close();
                 csv_open_files_.erase(path);
+                csv_file_ = nullptr;
             }
         } else if (file_type == "h5" || file_type == "hdf5") {
             // 如果未来有其他文件类型的处理逻辑，请在这里添加
@@ -103,10 +178,22 @@ protected:
     std::string file_type_;
     std::string data_type_;
     std::map<std::string, std::ofstream> csv_open_files_;
+    std::ofstream* csv_file_{nullptr};  // csv_date_当天的文件
+    std::string csv_date_;
 
     static constexpr size_t MAX_BUFFER_SIZE = 600;
+    static constexpr size_t kCsvLineMax = 384;      // 一条记录的CSV行长度上限
+    std::string csv_buffer_;                        // 一次flush的全部CSV行, 预留后复用
     std::string last_date_;
     std::mutex mutex_;
+
+    // 在mutex_内更新, 同一时刻只有一个写者
+    forward::common::Counter records_;
+    forward::common::Counter flushes_;
+    forward::common::Counter flush_ns_total_;
+    forward::common::Gauge buffer_occupancy_;
+    forward::common::Gauge flush_ns_last_;
+    forward::common::Gauge flush_ns_max_;
 };
 
 class StructAStorager : public DataStorager {
@@ -114,6 +201,7 @@ public:
     StructAStorager(const std::string& dir, const std::string& file_type)
         : DataStorager(dir, file_type) {
             data_type_ = "StructA";
+            registerMetrics();
         }
 
     ~StructAStorager() {
@@ -137,8 +225,76 @@ public:
         }
 
     }
+    void asyncWriteBatch(const void *records, size_t count) override {
+        if (count == 0U) {
+            return;
+        }
+        const auto *data = static_cast<const StructA *>(records);
+        // 一批数据通常在同一天内, 只有跨天时才逐条处理
+        std::string date = getDateFromTimestamp(data[0].ns);
+        if (count > 1U && getDateFromTimestamp(data[count - 1U].ns) != date) {
+            for (size_t i = 0; i < count; ++i) {
+                asyncWrite(data[i]);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (last_date_ != "" && last_date_ != date) {
+            flushBuffer();
+            last_date_ = date;
+        }
+
+        appendRecords(data, count);
+
+        if (strucA_buffer_.size() >= MAX_BUFFER_SIZE) {
+            flushBuffer();
+        }
+    }
+
+    void* acquireBlock() override {
+        return strucA_buffer_.acquire();
+    }
+
+    void asyncWriteBlock(void *block) override {
+        auto *records = static_cast<forward::classes::RecordBlock<StructA> *>(block);
+        if (records->count == 0U) {
+            strucA_buffer_.release(records);
+            return;
+        }
+        std::string date = getDateFromTimestamp(records->records[0].ns);
+        if (records->count > 1U && getDateFromTimestamp(records->records[records->count - 1U].ns) != date) {
+            for (uint32_t i = 0; i < records->count; ++i) {
+                asyncWrite(records->records[i]);
+            }
+            strucA_buffer_.release(records);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (last_date_ != "" && last_date_ != date) {
+            flushBuffer();
+            last_date_ = date;
+        }
+
+        const int64_t count = records->count;
+        strucA_buffer_.adopt(records);
+        records_.add(count);
+        buffer_occupancy_.set(static_cast<int64_t>(strucA_buffer_.size()));
+
+        if (strucA_buffer_.size() >= MAX_BUFFER_SIZE) {
+            flushBuffer();
+        }
+    }
+
+    forward::common::PoolStats getPoolStats() const override {
+        return strucA_buffer_.get_pool_stats();
+    }
 protected:
-    std::vector<StructA> strucA_buffer_;
+    // 记录存放在池中的块里, flush后块归还给池, 运行中不再分配
+    forward::classes::RecordBuffer<StructA> strucA_buffer_{MAX_BUFFER_SIZE, "StructA"};
 
     void asyncWrite(const StructA& data) {
         std::string date = getDateFromTimestamp(data.ns);
@@ -152,10 +308,10 @@ protected:
         }
 
         // 将新数据添加到缓冲区
-        strucA_buffer_.push_back(data);
+        appendRecords(&data, 1U);
 
         // 检查缓冲区是否已达到最大大小
-        if (strucA_buffer_.size() == MAX_BUFFER_SIZE) {
+        if (strucA_buffer_.size() >= MAX_BUFFER_SIZE) {
             flushBuffer();  // 当缓冲区满时，保存缓冲区的数据
         }
     }
@@ -169,35 +325,45 @@ protected:
         return s;
     }
 
-    void writeToCSV(const std::filesystem::path& p, const std::vector<StructA>& data) {
-        if (csv_open_files_.find(p.string()) == csv_open_files_.end()) {
-            std::filesystem::create_directories(p.parent_path());
-            csv_open_files_[p.string()] = std::ofstream(p, std::ios::app);
+    // 在mutex_内调用, 块池耗尽时丢弃放不下的记录
+    void appendRecords(const StructA *data, size_t count) {
+        const size_t copied = strucA_buffer_.append(data, count);
+        records_.add(static_cast<int64_t>(copied));
+        buffer_occupancy_.set(static_cast<int64_t>(strucA_buffer_.size()));
+        if (copied < count) {
+            FORWARD_LOG_RATE_LIMITED(forward::common::LogLevel::kWarn, 1000, "%s record pool exhausted, %zu records dropped",
+                                     data_type_, count - copied);
         }
-        std::ofstream& file = csv_open_files_[p.string()];
-
-        std::stringstream buffer;  // 使用一个字符串流来缓冲数据
-
-        for (const auto& entry : data) {
-            buffer << entry.ns << "," << entry.recv_ns << ","
-                << entry.num1 << "," << entry.num2 << entry.num1 << ","
-                << entry.total_id << "," << entry.data_id;
+    }
 
-            // 移除最后一个逗号
-            //buffer.seekp(-1, std::ios_base::cur);
-            buffer << "\n";
-        }
+    void writeToCSV(const std::string& date, const forward::classes::RecordBuffer<StructA>& data) {
+        std::ofstream& file = csvFile(date);
+
+        // 格式与原先的stringstream输出一致, double按%g, 新增的列只追加在data_id之后, 新增的列只追加在data_id之后
+        csv_buffer_.clear();
+        data.for_each([this](const StructA& entry) {
+            char line[kCsvLineMax];
+            const int n = snprintf(line, sizeof(line),
+                                   "%" PRIu64 ",%" PRIu64 ",%g,%g%g,%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%" PRId64 ",%" PRId64 "\n",
+                                   entry.ns, entry.recv_ns, entry.num1, entry.num2, entry.num1,
+                                   entry.total_id, entry.data_id, entry.owd_ns, entry.nic_ns, entry.rx_ns);
+            if (n > 0) {
+                csv_buffer_.append(line, std::min<size_t>(static_cast<size_t>(n), sizeof(line) - 1U));
+            }
+        });
 
-        file << buffer.str();  // 一次性将所有数据写入文件
+        file.write(csv_buffer_.data(), static_cast<std::streamsize>(csv_buffer_.size()));  // 一次性将所有数据写入文件
         file.flush();          // 确保数据已经写入文件
     }
 
     void flushBuffer() override {
+        if (strucA_buffer_.empty()) {
+            return;     // 析构时缓冲区可能为空
+        }
+        const auto flush_start = std::chrono::steady_clock::now();
         // 确定路径和文件名
-        StructA& first_data = strucA_buffer_[0];
+        const StructA& first_data = strucA_buffer_.front();
         std::string cur_data = getDateFromTimestamp(first_data.ns);
-        std::filesystem::path p = generatePath(cur_data);  // 使用一个函数来生成路径
-        printf("generatePath %s\n", p.string().c_str());
 
         // 如果日期变化，关闭旧的文件句柄
         if (last_date_!= "" && cur_data != last_date_) {
@@ -208,12 +374,16 @@ protected:
 
         // 根据file_type_决定如何写入
         if (file_type_ == "csv") {
-            writeToCSV(p, strucA_buffer_);
+            writeToCSV(cur_data, strucA_buffer_);
         } else if (file_type_ == "h5" || file_type_ == "hdf5") {
             // hdf5的写入逻辑
         }
 
+        // 一批写出一个事件
+        forward::common::Tracer::emit(forward::common::TraceStage::kFlush, 0);
+
         strucA_buffer_.clear();
+        recordFlush(flush_start);
     }
 };
 
@@ -222,6 +392,7 @@ public:
     StructBStorager(const std::string& dir, const std::string& file_type)
             : DataStorager(dir, file_type) {
         data_type_ = "StructB";
+        registerMetrics();
     }
 
     ~StructBStorager() {
@@ -246,8 +417,76 @@ public:
         }
     }
 
+    void asyncWriteBatch(const void *records, size_t count) override {
+        if (count == 0U) {
+            return;
+        }
+        const auto *data = static_cast<const StructB *>(records);
+        // 一批数据通常在同一天内, 只有跨天时才逐条处理
+        std::string date = getDateFromTimestamp(data[0].ns);
+        if (count > 1U && getDateFromTimestamp(data[count - 1U].ns) != date) {
+            for (size_t i = 0; i < count; ++i) {
+                asyncWrite(data[i]);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (last_date_ != "" && last_date_ != date) {
+            flushBuffer();
+            last_date_ = date;
+        }
+
+        appendRecords(data, count);
+
+        if (structB_buffer_.size() >= MAX_BUFFER_SIZE) {
+            flushBuffer();
+        }
+    }
+
+    void* acquireBlock() override {
+        return structB_buffer_.acquire();
+    }
+
+    void asyncWriteBlock(void *block) override {
+        auto *records = static_cast<forward::classes::RecordBlock<StructB> *>(block);
+        if (records->count == 0U) {
+            structB_buffer_.release(records);
+            return;
+        }
+        std::string date = getDateFromTimestamp(records->records[0].ns);
+        if (records->count > 1U && getDateFromTimestamp(records->records[records->count - 1U].ns) != date) {
+            for (uint32_t i = 0; i < records->count; ++i) {
+                asyncWrite(records->records[i]);
+            }
+            structB_buffer_.release(records);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (last_date_ != "" && last_date_ != date) {
+            flushBuffer();
+            last_date_ = date;
+        }
+
+        const int64_t count = records->count;
+        structB_buffer_.adopt(records);
+        records_.add(count);
+        buffer_occupancy_.set(static_cast<int64_t>(structB_buffer_.size()));
+
+        if (structB_buffer_.size() >= MAX_BUFFER_SIZE) {
+            flushBuffer();
+        }
+    }
+
+    forward::common::PoolStats getPoolStats() const override {
+        return structB_buffer_.get_pool_stats();
+    }
+
 protected:
-    std::vector<StructB> structB_buffer_;
+    forward::classes::RecordBuffer<StructB> structB_buffer_{MAX_BUFFER_SIZE, "StructB"};
 
     void asyncWrite(const StructB& data) {
         std::string date = getDateFromTimestamp(data.ns);
@@ -261,10 +500,10 @@ protected:
         }
 
         // 将新数据添加到缓冲区
-        structB_buffer_.push_back(data);
+        appendRecords(&data, 1U);
 
         // 检查缓冲区是否已达到最大大小
-        if (structB_buffer_.size() == MAX_BUFFER_SIZE) {
+        if (structB_buffer_.size() >= MAX_BUFFER_SIZE) {
             flushBuffer();  // 当缓冲区满时，保存缓冲区的数据
         }
     }
@@ -278,36 +517,46 @@ protected:
         return s;
     }
 
-    void writeToCSV(const std::filesystem::path& p, const std::vector<StructB>& data) {
-        if (csv_open_files_.find(p.string()) == csv_open_files_.end()) {
-            std::filesystem::create_directories(p.parent_path());
-            csv_open_files_[p.string()] = std::ofstream(p, std::ios::app);
+    // 在mutex_内调用, 块池耗尽时丢弃放不下的记录
+    void appendRecords(const StructB *data, size_t count) {
+        const size_t copied = structB_buffer_.append(data, count);
+        records_.add(static_cast<int64_t>(copied));
+        buffer_occupancy_.set(static_cast<int64_t>(structB_buffer_.size()));
+        if (copied < count) {
+            FORWARD_LOG_RATE_LIMITED(forward::common::LogLevel::kWarn, 1000, "%s record pool exhausted, %zu records dropped",
+                                     data_type_, count - copied);
         }
-        std::ofstream& file = csv_open_files_[p.string()];
-
-        std::stringstream buffer;  // 使用一个字符串流来缓冲数据
-
-        for (const auto& entry : data) {
-            buffer << entry.ns << "," << entry.recv_ns << ","
-                   << entry.num1 << "," << entry.num2 << entry.num1 << ","
-                   << entry.data << ","
-                   << entry.total_id << "," << entry.data_id;
+    }
 
-            // 移除最后一个逗号
-            //buffer.seekp(-1, std::ios_base::cur);
-            buffer << "\n";
-        }
+    void writeToCSV(const std::string& date, const forward::classes::RecordBuffer<StructB>& data) {
+        std::ofstream& file = csvFile(date);
+
+        // 格式与原先的stringstream输出一致, double按%g
+        csv_buffer_.clear();
+        data.for_each([this](const StructB& entry) {
+            char line[kCsvLineMax];
+            const int n = snprintf(line, sizeof(line),
+                                   "%" PRIu64 ",%" PRIu64 ",%g,%g%g,%.*s,%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%" PRId64 ",%" PRId64 "\n",
+                                   entry.ns, entry.recv_ns, entry.num1, entry.num2, entry.num1,
+                                   static_cast<int>(strnlen(entry.data, sizeof(entry.data))), entry.data,
+                                   entry.total_id, entry.data_id, entry.owd_ns, entry.nic_ns, entry.rx_ns);
+            if (n > 0) {
+                csv_buffer_.append(line, std::min<size_t>(static_cast<size_t>(n), sizeof(line) - 1U));
+            }
+        });
 
-        file << buffer.str();  // 一次性将所有数据写入文件
+        file.write(csv_buffer_.data(), static_cast<std::streamsize>(csv_buffer_.size()));  // 一次性将所有数据写入文件
         file.flush();          // 确保数据已经写入文件
     }
 
     void flushBuffer() override {
+        if (structB_buffer_.empty()) {
+            return;     // 析构时缓冲区可能为空
+        }
+        const auto flush_start = std::chrono::steady_clock::now();
         // 确定路径和文件名
-        StructB& first_data = structB_buffer_[0];
+        const StructB& first_data = structB_buffer_.front();
         std::string cur_data = getDateFromTimestamp(first_data.ns);
-        std::filesystem::path p = generatePath(cur_data);  // 使用一个函数来生成路径
-        printf("generatePath %s\n", p.string().c_str());
 
         // 如果日期变化，关闭旧的文件句柄
         if (last_date_!= "" && cur_data != last_date_) {
@@ -318,11 +567,15 @@ protected:
 
         // 根据file_type_决定如何写入
         if (file_type_ == "csv") {
-            writeToCSV(p, structB_buffer_);
+            writeToCSV(cur_data, structB_buffer_);
         } else if (file_type_ == "h5" || file_type_ == "hdf5") {
             // hdf5的写入逻辑
         }
 
+        // 一批写出一个事件
+        forward::common::Tracer::emit(forward::common::TraceStage::kFlush, 0);
+
         structB_buffer_.clear();
+        recordFlush(flush_start);
     }
 };
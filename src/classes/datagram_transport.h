@@ -0,0 +1,35 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file datagram_transport.h
+* @brief where XUdpSender puts its datagrams when they do not go to an xudp channel
+* @details XUdpSender writes to the xudp tx ring of its channel. A DatagramTransport given to the
+*  SenderMgr / XUdpSender constructor replaces that ring for every datagram, e.g. the in process
+*  loopback of bench/alloc_check. The transport must outlive the senders and is called on the
+*  thread that dispatches, it must not block.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <sys/socket.h>
+
+namespace forward{
+namespace classes{
+class DatagramTransport {
+public:
+    virtual ~DatagramTransport() = default;
+
+    /**
+     * \brief take one datagram addressed to to.
+     * \return false if it was dropped, it then counts as a tx error.
+     */
+    virtual bool send(const uint8_t *data, uint32_t size, const struct sockaddr *to) = 0;
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,235 @@
+#include <cstring>
+#include <utility>
+#include "fec_codec.h"
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+namespace forward {
+namespace classes {
+namespace {
+    // GF(2^8), 本原多项式 x^8 + x^4 + x^3 + x^2 + 1
+    struct GfTables {
+        uint8_t exp[512];
+        uint8_t log[256];
+        // 每个系数的低/高半字节乘法表, 供 pshufb 查表
+        alignas(16) uint8_t nibble_lo[256][16];
+        alignas(16) uint8_t nibble_hi[256][16];
+
+        GfTables() {
+            uint32_t x = 1;
+            for (uint32_t i = 0; i < 255; ++i) {
+                exp[i] = static_cast<uint8_t>(x);
+                log[x] = static_cast<uint8_t>(i);
+                x <<= 1U;
+                if (x & 0x100U) {
+                    x ^= 0x11dU;
+                }
+            }
+            for (uint32_t i = 255; i < 512; ++i) {
+                exp[i] = exp[i - 255];
+            }
+            log[0] = 0;
+            for (uint32_t c = 0; c < 256; ++c) {
+                for (uint32_t v = 0; v < 16; ++v) {
+                    nibble_lo[c][v] = mul(c, v);
+                    nibble_hi[c][v] = mul(c, v << 4U);
+                }
+            }
+        }
+
+        uint8_t mul(uint32_t a, uint32_t b) const {
+            return (a == 0U || b == 0U) ? 0U : exp[log[a] + log[b]];
+        }
+    };
+
+    const GfTables& tables() {
+        static const GfTables t;
+        return t;
+    }
+}
+
+    uint8_t FecCodec::gf_mul(uint8_t a, uint8_t b) {
+        if (a == 0U || b == 0U) {
+            return 0;
+        }
+        const GfTables& t = tables();
+        return t.exp[t.log[a] + t.log[b]];
+    }
+
+    uint8_t FecCodec::gf_inv(uint8_t a) {
+        const GfTables& t = tables();
+        return t.exp[255 - t.log[a]];
+    }
+
+    uint8_t FecCodec::coefficient(uint32_t k, uint32_t j, uint32_t i) {
+        if (j == 0U) {
+            return 1;
+        }
+        // Cauchy: 1 / (x_j ^ y_i), x_j = k + j, y_i = i, 列乘 (x_0 ^ y_i) 使第0行全为1
+        const uint8_t y = static_cast<uint8_t>(i);
+        const uint8_t x0 = static_cast<uint8_t>(k);
+        const uint8_t xj = static_cast<uint8_t>(k + j);
+        return gf_mul(static_cast<uint8_t>(x0 ^ y), gf_inv(static_cast<uint8_t>(xj ^ y)));
+    }
+
+    void FecCodec::xor_region(uint8_t* __restrict dst, const uint8_t* __restrict src, size_t n) {
+        size_t i = 0;
+        for (; i + 8U <= n; i += 8U) {
+            uint64_t a, b;
+            memcpy(&a, dst + i, 8);
+            memcpy(&b, src + i, 8);
+            a ^= b;
+            memcpy(dst + i, &a, 8);
+        }
+        for (; i < n; ++i) {
+            dst[i] ^= src[i];
+        }
+    }
+
+    void FecCodec::mul_add_region(uint8_t* __restrict dst, const uint8_t* __restrict src, uint8_t c, size_t n) {
+        if (c == 0U) {
+            return;
+        }
+        if (c == 1U) {
+            xor_region(dst, src, n);
+            return;
+        }
+        // c * s = c * (s & 0x0f) ^ c * (s & 0xf0)
+        const uint8_t* lo = tables().nibble_lo[c];
+        const uint8_t* hi = tables().nibble_hi[c];
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i lo_tbl = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)lo));
+        const __m256i hi_tbl = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)hi));
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        for (; i + 32U <= n; i += 32U) {
+            const __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+            const __m256i l = _mm256_shuffle_epi8(lo_tbl, _mm256_and_si256(s, mask));
+            const __m256i h = _mm256_shuffle_epi8(hi_tbl, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask));
+            const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(d, _mm256_xor_si256(l, h)));
+        }
+#elif defined(__SSSE3__)
+        const __m128i lo_tbl = _mm_load_si128((const __m128i*)lo);
+        const __m128i hi_tbl = _mm_load_si128((const __m128i*)hi);
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        for (; i + 16U <= n; i += 16U) {
+            const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+            const __m128i l = _mm_shuffle_epi8(lo_tbl, _mm_and_si128(s, mask));
+            const __m128i h = _mm_shuffle_epi8(hi_tbl, _mm_and_si128(_mm_srli_epi64(s, 4), mask));
+            const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+        }
+#endif
+        for (; i < n; ++i) {
+            dst[i] ^= static_cast<uint8_t>(lo[src[i] & 0x0fU] ^ hi[src[i] >> 4U]);
+        }
+    }
+
+    void FecCodec::encode(uint32_t k, uint32_t m, const uint8_t* const* data, uint8_t* const* parity, size_t len) {
+        for (uint32_t j = 0; j < m; ++j) {
+            memset(parity[j], 0, len);
+            for (uint32_t i = 0; i < k; ++i) {
+                mul_add_region(parity[j], data[i], coefficient(k, j, i), len);
+            }
+        }
+    }
+
+    bool FecCodec::decode(uint32_t k, uint32_t m, uint8_t* const* data, const bool* data_present,
+                          const uint8_t* const* parity, const bool* parity_present, size_t len) {
+        uint32_t missing[kMaxParity];
+        uint32_t rows[kMaxParity];
+        uint32_t e = 0;
+        for (uint32_t i = 0; i < k; ++i) {
+            if (!data_present[i]) {
+                if (e == kMaxParity) {
+                    return false;
+                }
+                missing[e++] = i;
+            }
+        }
+        if (e == 0U) {
+            return true;
+        }
+        uint32_t r = 0;
+        for (uint32_t j = 0; j < m && r < e; ++j) {
+            if (parity_present[j]) {
+                rows[r++] = j;
+            }
+        }
+        if (r < e) {
+            return false;
+        }
+
+        // 1. 伴随式: 校验符号减去已收到数据的贡献, 直接写入缺失数据的缓冲区
+        for (uint32_t c = 0; c < e; ++c) {
+            uint8_t* s = data[missing[c]];
+            memcpy(s, parity[rows[c]], len);
+            for (uint32_t i = 0; i < k; ++i) {
+                if (data_present[i]) {
+                    mul_add_region(s, data[i], coefficient(k, rows[c], i), len);
+                }
+            }
+        }
+        if (e == 1U && rows[0] == 0U) {
+            return true;    // 单丢包, XOR即可
+        }
+
+        // 2. 求 e x e 系数矩阵的逆 (Gauss-Jordan)
+        uint8_t a[kMaxParity][kMaxParity];
+        uint8_t inv[kMaxParity][kMaxParity];
+        for (uint32_t row = 0; row < e; ++row) {
+            for (uint32_t col = 0; col < e; ++col) {
+                a[row][col] = coefficient(k, rows[row], missing[col]);
+                inv[row][col] = (row == col) ? 1U : 0U;
+            }
+        }
+        for (uint32_t col = 0; col < e; ++col) {
+            uint32_t pivot = col;
+            while (pivot < e && a[pivot][col] == 0U) {
+                ++pivot;
+            }
+            if (pivot == e) {
+                return false;
+            }
+            if (pivot != col) {
+                for (uint32_t x = 0; x < e; ++x) {
+                    std::swap(a[pivot][x], a[col][x]);
+                    std::swap(inv[pivot][x], inv[col][x]);
+                }
+            }
+            const uint8_t scale = gf_inv(a[col][col]);
+            for (uint32_t x = 0; x < e; ++x) {
+                a[col][x] = gf_mul(a[col][x], scale);
+                inv[col][x] = gf_mul(inv[col][x], scale);
+            }
+            for (uint32_t row = 0; row < e; ++row) {
+                const uint8_t f = a[row][col];
+                if (row == col || f == 0U) {
+                    continue;
+                }
+                for (uint32_t x = 0; x < e; ++x) {
+                    a[row][x] ^= gf_mul(f, a[col][x]);
+                    inv[row][x] ^= gf_mul(f, inv[col][x]);
+                }
+            }
+        }
+
+        // 3. 缺失数据 = inv * 伴随式
+        uint8_t syndrome[kMaxParity][kMaxSymbol];
+        for (uint32_t c = 0; c < e; ++c) {
+            memcpy(syndrome[c], data[missing[c]], len);
+        }
+        for (uint32_t c = 0; c < e; ++c) {
+            uint8_t* out = data[missing[c]];
+            memset(out, 0, len);
+            for (uint32_t x = 0; x < e; ++x) {
+                mul_add_region(out, syndrome[x], inv[c][x], len);
+            }
+        }
+        return true;
+    }
+} /* namespace classes */
+} /* namespace forward */
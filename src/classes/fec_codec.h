@@ -0,0 +1,73 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file fec_codec.h
+* @brief systematic erasure code over GF(2^8) used for FEC parity frames
+* @details The parity matrix is a Cauchy matrix whose columns are scaled so that the first row is
+*  all ones: parity 0 is the plain XOR of the data symbols and any k of the k + m symbols are
+*  enough to rebuild the block (MDS). With m == 1 encode and decode only use the XOR kernel.
+*
+*  The kernels work on whole regions. The XOR kernel runs on 64 bit words and is vectorized by the
+*  compiler, the multiply-add kernel uses split nibble tables (16 + 16 entries per coefficient) which
+*  map to pshufb when built with SSSE3 or AVX2 (-mssse3, -mavx2 or -march=native), with a scalar
+*  fallback otherwise.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace forward{
+namespace classes{
+class FecCodec {
+public:
+    static constexpr uint32_t kMaxData = 32;      // 每块最多数据帧数 k
+    static constexpr uint32_t kMaxParity = 8;     // 每块最多校验帧数 m
+    static constexpr uint32_t kMaxSymbol = 1474;  // 2字节帧长 + 最大帧
+
+    FecCodec() = delete;
+
+    /**
+     * \return the coefficient of data symbol i in parity symbol j.
+     */
+    static uint8_t coefficient(uint32_t k, uint32_t j, uint32_t i);
+
+    /**
+     * \brief dst ^= src over n bytes.
+     */
+    static void xor_region(uint8_t* dst, const uint8_t* src, size_t n);
+
+    /**
+     * \brief dst ^= c * src over n bytes in GF(2^8).
+     */
+    static void mul_add_region(uint8_t* dst, const uint8_t* src, uint8_t c, size_t n);
+
+    /**
+     * \brief compute m parity symbols of len bytes from k data symbols, len <= kMaxSymbol.
+     */
+    static void encode(uint32_t k, uint32_t m, const uint8_t* const* data, uint8_t* const* parity, size_t len);
+
+    /**
+     * \brief rebuild the missing data symbols in place.
+     *
+     * \param data           : k symbol buffers, the missing ones are overwritten
+     * \param data_present   : k flags
+     * \param parity         : m symbol buffers
+     * \param parity_present : m flags
+     * \return false if fewer parity symbols than missing data symbols are present.
+     */
+    static bool decode(uint32_t k, uint32_t m, uint8_t* const* data, const bool* data_present,
+                       const uint8_t* const* parity, const bool* parity_present, size_t len);
+
+    static uint8_t gf_mul(uint8_t a, uint8_t b);
+    static uint8_t gf_inv(uint8_t a);
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,145 @@
+#include "fec_stream.h"
+#include "structs/pack_helper.h"
+
+namespace forward {
+namespace classes {
+    FecEncoder::FecEncoder(uint32_t k, uint32_t m, uint16_t channel_id)
+            : k_(k), m_(m), channel_id_(channel_id) {
+        symbols_.resize(static_cast<size_t>(k_) * FecCodec::kMaxSymbol);
+        parity_frames_.resize(m_);
+    }
+
+    uint32_t FecEncoder::on_frame(uint32_t seq, const uint8_t* frame, uint32_t size) {
+        const uint32_t base = block_base(seq, k_);
+        if (base != block_base_) {
+            block_base_ = base;
+            received_ = 0;
+            symbol_len_ = 0;
+            valid_ = true;
+        }
+        const uint32_t i = seq - base;
+        // 校验帧 = Cmd + FecHeader + 符号, 不能超过一个报文
+        const uint32_t symbol_len = size + 2U;
+        if (!valid_ || i != received_
+            || sizeof(structs::Cmd) + sizeof(structs::FecHeader) + symbol_len > RetransmitRing::kMaxFrameSize) {
+            valid_ = false;
+            return 0;
+        }
+
+        uint8_t* symbol = symbols_.data() + static_cast<size_t>(i) * FecCodec::kMaxSymbol;
+        const uint16_t len = static_cast<uint16_t>(size);
+        memcpy(symbol, &len, sizeof(len));
+        memcpy(symbol + sizeof(len), frame, size);
+        // 之前的符号按新的最大长度补零
+        if (symbol_len > symbol_len_) {
+            for (uint32_t n = 0; n < i; ++n) {
+                uint8_t* old = symbols_.data() + static_cast<size_t>(n) * FecCodec::kMaxSymbol;
+                memset(old + symbol_len_, 0, symbol_len - symbol_len_);
+            }
+            symbol_len_ = symbol_len;
+        } else {
+            memset(symbol + symbol_len, 0, symbol_len_ - symbol_len);
+        }
+        if (++received_ != k_) {
+            return 0;
+        }
+
+        const uint8_t* data[FecCodec::kMaxData];
+        uint8_t* parity[FecCodec::kMaxParity];
+        for (uint32_t n = 0; n < k_; ++n) {
+            data[n] = symbols_.data() + static_cast<size_t>(n) * FecCodec::kMaxSymbol;
+        }
+        const uint32_t frame_len = sizeof(structs::Cmd) + sizeof(structs::FecHeader) + symbol_len_;
+        for (uint32_t j = 0; j < m_; ++j) {
+            auto& out = parity_frames_[j];
+            out.resize(frame_len);
+            auto *cmd = (structs::Cmd *)out.data();
+            cmd->no = structs::kCmdFec;
+            cmd->len = static_cast<uint16_t>(frame_len);
+            auto *header = (structs::FecHeader *)cmd->data;
+            header->block_base = base;
+            header->channel_id = channel_id_;
+            header->symbol_len = static_cast<uint16_t>(symbol_len_);
+            header->k = static_cast<uint8_t>(k_);
+            header->m = static_cast<uint8_t>(m_);
+            header->index = static_cast<uint8_t>(j);
+            header->reserved = 0;
+            parity[j] = header->symbol;
+        }
+        FecCodec::encode(k_, m_, data, parity, symbol_len_);
+        valid_ = false;
+        return m_;
+    }
+
+    void FecDecoder::reset(uint32_t k, uint32_t m) {
+        k_ = k;
+        m_ = m;
+        const size_t block_bytes = static_cast<size_t>(k_ + m_) * FecCodec::kMaxSymbol;
+        storage_.assign(block_bytes * kBlocks, 0);
+        for (uint32_t n = 0; n < kBlocks; ++n) {
+            blocks_[n] = Block{};
+            blocks_[n].storage = storage_.data() + n * block_bytes;
+        }
+    }
+
+    FecDecoder::Block& FecDecoder::block_of(uint32_t base) {
+        Block& block = blocks_[(base / k_) % kBlocks];
+        if (block.base != base) {
+            if (block.base != 0U && !block.done) {
+                for (uint32_t i = 0; i < k_; ++i) {
+                    if (!block.data_present[i]) {
+                        bump(blocks_failed_);
+                        break;
+                    }
+                }
+            }
+            uint8_t* storage = block.storage;
+            block = Block{};
+            block.storage = storage;
+            block.base = base;
+        }
+        return block;
+    }
+
+    uint32_t FecDecoder::rebuild(Block& block) {
+        if (block.done) {
+            return 0;
+        }
+        uint32_t missing = 0;
+        uint32_t parities = 0;
+        for (uint32_t i = 0; i < k_; ++i) {
+            missing += block.data_present[i] ? 0U : 1U;
+        }
+        for (uint32_t j = 0; j < m_; ++j) {
+            parities += block.parity_present[j] ? 1U : 0U;
+        }
+        if (missing == 0U) {
+            block.done = true;
+            return 0;
+        }
+        if (parities < missing || block.symbol_len == 0U) {
+            return missing;
+        }
+
+        uint8_t* data[FecCodec::kMaxData];
+        const uint8_t* parity[FecCodec::kMaxParity];
+        for (uint32_t i = 0; i < k_; ++i) {
+            data[i] = data_symbol(block, i);
+            if (block.data_present[i] && block.data_len[i] < block.symbol_len) {
+                memset(data[i] + block.data_len[i], 0, block.symbol_len - block.data_len[i]);
+            }
+        }
+        for (uint32_t j = 0; j < m_; ++j) {
+            parity[j] = parity_symbol(block, j);
+        }
+        if (!FecCodec::decode(k_, m_, data, block.data_present, parity, block.parity_present, block.symbol_len)) {
+            return missing;
+        }
+        for (uint32_t i = 0; i < k_; ++i) {
+            block.data_present[i] = true;
+        }
+        block.done = true;
+        return 0;
+    }
+} /* namespace classes */
+} /* namespace forward */
@@ -0,0 +1,219 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file fec_stream.h
+* @brief FEC block encoder of a sender channel and block decoder of a receiver stream
+* @details Blocks are k consecutive sequence numbers starting at ((seq - 1) / k) * k + 1. The
+*  symbol of a data frame is its 2 byte length followed by the frame, zero padded to the longest
+*  frame of the block, so recovered frames come back byte exact with their SeqHeader.
+*
+*  The encoder emits the m parity frames as soon as the k-th frame of a block is sent. A block that
+*  stays incomplete (idle channel, frame too large) is not protected. The decoder keeps the last
+*  kBlocks blocks and rebuilds missing frames the moment enough symbols of a block have arrived.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "fec_codec.h"
+#include "retransmit_ring.h"
+#include "structs/cmd_def.h"
+
+namespace forward{
+namespace classes{
+class FecEncoder {
+public:
+    /**
+     * \param k : data frames per block, [1, FecCodec::kMaxData]
+     * \param m : parity frames per block, [1, FecCodec::kMaxParity]
+     */
+    FecEncoder(uint32_t k, uint32_t m, uint16_t channel_id);
+    FecEncoder(const FecEncoder&) = delete;
+    FecEncoder& operator=(const FecEncoder&) = delete;
+
+    /**
+     * \brief account a frame that has just been sent.
+     * \return number of parity frames ready in parity(i) (0 or m), valid until the next call.
+     */
+    uint32_t on_frame(uint32_t seq, const uint8_t* frame, uint32_t size);
+
+    const std::vector<uint8_t>& parity(uint32_t i) const {
+        return parity_frames_[i];
+    }
+
+    static uint32_t block_base(uint32_t seq, uint32_t k) {
+        return ((seq - 1U) / k) * k + 1U;
+    }
+
+private:
+    uint32_t k_;
+    uint32_t m_;
+    uint16_t channel_id_;
+    uint32_t block_base_{0};
+    uint32_t received_{0};          // 本块已收集的帧数
+    bool     valid_{false};         // 本块可以保护
+    uint32_t symbol_len_{0};
+    std::vector<uint8_t> symbols_;  // k * FecCodec::kMaxSymbol
+    std::vector<std::vector<uint8_t>> parity_frames_;
+};
+
+class FecDecoder {
+public:
+    static constexpr uint32_t kBlocks = 4;
+
+    struct Counters {
+        uint64_t parity_received{0};    // 收到的校验帧数
+        uint64_t recovered{0};          // 通过FEC恢复的帧数
+        uint64_t blocks_failed{0};      // 校验帧不足, 未能恢复的块数
+    };
+
+    FecDecoder() = default;
+    FecDecoder(const FecDecoder&) = delete;
+    FecDecoder& operator=(const FecDecoder&) = delete;
+
+    /**
+     * \brief keep a copy of a received data frame, ignored until the first parity frame tells k.
+     */
+    template <typename Deliver>
+    void on_data(uint32_t seq, const uint8_t* frame, uint32_t size, Deliver&& deliver) {
+        if (k_ == 0U || size + 2U > FecCodec::kMaxSymbol) {
+            return;
+        }
+        Block& block = block_of(FecEncoder::block_base(seq, k_));
+        const uint32_t i = seq - block.base;
+        if (block.done || block.data_present[i]) {
+            return;
+        }
+        store_data(block, i, frame, size);
+        try_recover(block, deliver);
+    }
+
+    /**
+     * \brief handle a parity frame, deliver(const Cmd*) is called for each rebuilt data frame.
+     */
+    template <typename Deliver>
+    void on_parity(const structs::FecHeader& header, Deliver&& deliver) {
+        if (header.k == 0U || header.k > FecCodec::kMaxData || header.m > FecCodec::kMaxParity
+            || header.symbol_len > FecCodec::kMaxSymbol) {
+            return;
+        }
+        bump(parity_received_);
+        if (header.k != k_ || header.m != m_) {
+            reset(header.k, header.m);
+        }
+        Block& block = block_of(header.block_base);
+        if (block.done || block.parity_present[header.index]) {
+            return;
+        }
+        block.symbol_len = header.symbol_len;
+        memcpy(parity_symbol(block, header.index), header.symbol, header.symbol_len);
+        block.parity_present[header.index] = true;
+        try_recover(block, deliver);
+    }
+
+    /**
+     * \brief drop the partial blocks, the sender restarted its sequence.
+     */
+    void restart() {
+        if (k_ != 0U) {
+            reset(k_, m_);
+        }
+    }
+
+    Counters get_counters() const {
+        Counters c;
+        c.parity_received = parity_received_.load(std::memory_order_relaxed);
+        c.recovered = recovered_.load(std::memory_order_relaxed);
+        c.blocks_failed = blocks_failed_.load(std::memory_order_relaxed);
+        return c;
+    }
+
+private:
+    struct Block {
+        uint32_t base{0};
+        uint32_t symbol_len{0};
+        bool done{false};
+        bool data_present[FecCodec::kMaxData]{};
+        uint16_t data_len[FecCodec::kMaxData]{};        // 已存数据符号的有效长度
+        bool parity_present[FecCodec::kMaxParity]{};
+        uint8_t* storage{nullptr};                      // (k + m) * FecCodec::kMaxSymbol
+    };
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1U) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void reset(uint32_t k, uint32_t m);
+
+    /**
+     * \brief the block starting at base, recycling the slot of an older block.
+     */
+    Block& block_of(uint32_t base);
+
+    uint8_t* data_symbol(Block& block, uint32_t i) {
+        return block.storage + i * FecCodec::kMaxSymbol;
+    }
+
+    uint8_t* parity_symbol(Block& block, uint32_t j) {
+        return block.storage + (k_ + j) * FecCodec::kMaxSymbol;
+    }
+
+    void store_data(Block& block, uint32_t i, const uint8_t* frame, uint32_t size) {
+        uint8_t* symbol = data_symbol(block, i);
+        const uint16_t len = static_cast<uint16_t>(size);
+        memcpy(symbol, &len, sizeof(len));
+        memcpy(symbol + sizeof(len), frame, size);
+        block.data_len[i] = static_cast<uint16_t>(size + sizeof(len));
+        block.data_present[i] = true;
+    }
+
+    /**
+     * \brief rebuild the block when it has enough symbols.
+     * \return number of missing frames, after a successful recovery 0.
+     */
+    uint32_t rebuild(Block& block);
+
+    template <typename Deliver>
+    void try_recover(Block& block, Deliver&& deliver) {
+        bool missing[FecCodec::kMaxData];
+        for (uint32_t i = 0; i < k_; ++i) {
+            missing[i] = !block.data_present[i];
+        }
+        if (rebuild(block) != 0U) {
+            return;
+        }
+        for (uint32_t i = 0; i < k_; ++i) {
+            if (!missing[i]) {
+                continue;
+            }
+            const uint8_t* symbol = data_symbol(block, i);
+            uint16_t len;
+            memcpy(&len, symbol, sizeof(len));
+            if (len < sizeof(structs::Cmd) || len + sizeof(len) > block.symbol_len) {
+                continue;
+            }
+            bump(recovered_);
+            deliver((const structs::Cmd *)(symbol + sizeof(len)), len);
+        }
+    }
+
+    uint32_t k_{0};
+    uint32_t m_{0};
+    Block blocks_[kBlocks];
+    std::vector<uint8_t> storage_;
+
+    std::atomic<uint64_t> parity_received_{0};
+    std::atomic<uint64_t> recovered_{0};
+    std::atomic<uint64_t> blocks_failed_{0};
+};
+}
+}
+/** @}*/    // end of group forward
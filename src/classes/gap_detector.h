@@ -0,0 +1,191 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file gap_detector.h
+* @brief loss, duplicate and reorder accounting for one sequenced stream
+* @details A sliding bitmap of kWindowBits sequence numbers ending at the highest sequence seen.
+*  A sequence number that leaves the window without having been seen is counted as lost, one
+*  that arrives below the highest is either out of order (first time) or duplicate (bit already
+*  set), one that arrives below the window is late. In order packets cost one bit set and one bit
+*  test, so the detector can run on the receive thread for every packet.
+*
+*  reset() forgets the window, the next packet starts a new one. The receiver calls it when the
+*  sender restarted its sequence, see kSeqEpochMask.
+*
+*  Single writer: only the receive thread calls on_packet(). Counters are relaxed atomics so that
+*  a stats thread may read them at any time.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+namespace forward{
+namespace classes{
+class GapDetector {
+public:
+    static constexpr uint32_t kWindowBits = 1024;
+    static constexpr uint32_t kWords = kWindowBits / 64;
+
+    enum class Result : uint8_t {
+        kInOrder,       // 按序到达
+        kGap,           // 按序到达, 但前面有缺失
+        kOutOfOrder,    // 乱序到达, 补上了缺失
+        kDuplicate,     // 重复
+        kLate,          // 早于窗口, 已被计为丢失
+    };
+
+    /**
+     * \brief snapshot of the counters.
+     */
+    struct Counters {
+        uint64_t received{0};
+        uint64_t lost{0};
+        uint64_t duplicate{0};
+        uint64_t out_of_order{0};
+        uint64_t late{0};
+        uint64_t resets{0};
+        uint32_t highest_seq{0};
+    };
+
+    GapDetector() = default;
+    GapDetector(const GapDetector&) = delete;
+    GapDetector& operator=(const GapDetector&) = delete;
+
+    Result on_packet(uint32_t seq) {
+        bump(received_);
+        if (!started_) {
+            started_ = true;
+            highest_ = seq;
+            // 起始序号之前的位视为已收到, 不计入丢失
+            bitmap_.fill(~0ULL);
+            highest_seq_.store(seq, std::memory_order_relaxed);
+            return Result::kInOrder;
+        }
+
+        const int32_t delta = static_cast<int32_t>(seq - highest_);
+        if (delta > 0) {
+            advance(static_cast<uint32_t>(delta));
+            set_bit(seq);
+            highest_ = seq;
+            highest_seq_.store(seq, std::memory_order_relaxed);
+            return (delta == 1) ? Result::kInOrder : Result::kGap;
+        }
+
+        if (static_cast<uint32_t>(-delta) >= kWindowBits) {
+            bump(late_);
+            return Result::kLate;
+        }
+        if (test_bit(seq)) {
+            bump(duplicate_);
+            return Result::kDuplicate;
+        }
+        set_bit(seq);
+        bump(out_of_order_);
+        return Result::kOutOfOrder;
+    }
+
+    /**
+     * \brief start over with the next packet, counters are kept.
+     */
+    void reset() {
+        started_ = false;
+        bump(resets_);
+    }
+
+    /**
+     * \return true if seq has not been seen yet and is not older than the window.
+     */
+    bool is_missing(uint32_t seq) const {
+        const int32_t delta = static_cast<int32_t>(seq - highest_);
+        if (!started_ || delta > 0) {
+            return true;
+        }
+        if (static_cast<uint32_t>(-delta) >= kWindowBits) {
+            return false;
+        }
+        return !test_bit(seq);
+    }
+
+    uint32_t highest() const {
+        return highest_;
+    }
+
+    Counters get_counters() const {
+        Counters c;
+        c.received = received_.load(std::memory_order_relaxed);
+        c.lost = lost_.load(std::memory_order_relaxed);
+        c.duplicate = duplicate_.load(std::memory_order_relaxed);
+        c.out_of_order = out_of_order_.load(std::memory_order_relaxed);
+        c.late = late_.load(std::memory_order_relaxed);
+        c.resets = resets_.load(std::memory_order_relaxed);
+        c.highest_seq = highest_seq_.load(std::memory_order_relaxed);
+        return c;
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1U) {
+        // 单写者, 不需要原子加
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    bool test_bit(uint32_t seq) const {
+        const uint32_t bit = seq % kWindowBits;
+        return (bitmap_[bit / 64U] >> (bit % 64U)) & 1ULL;
+    }
+
+    void set_bit(uint32_t seq) {
+        const uint32_t bit = seq % kWindowBits;
+        bitmap_[bit / 64U] |= (1ULL << (bit % 64U));
+    }
+
+    /**
+     * \brief slide the window forward by delta, counting the slots that fall out unseen.
+     */
+    void advance(uint32_t delta) {
+        if (delta >= kWindowBits) {
+            uint64_t seen = 0;
+            for (auto word : bitmap_) {
+                seen += static_cast<uint64_t>(__builtin_popcountll(word));
+            }
+            // 整个旧窗口中未收到的, 加上窗口之外跳过的序号
+            bump(lost_, (kWindowBits - seen) + (delta - kWindowBits));
+            bitmap_.fill(0ULL);
+            return;
+        }
+        uint64_t lost = 0;
+        for (uint32_t seq = highest_ + 1U; seq != highest_ + 1U + delta; ++seq) {
+            // 该位当前代表 seq - kWindowBits
+            const uint32_t bit = seq % kWindowBits;
+            uint64_t& word = bitmap_[bit / 64U];
+            const uint64_t mask = 1ULL << (bit % 64U);
+            lost += ((word & mask) == 0U) ? 1U : 0U;
+            word &= ~mask;
+        }
+        if (lost != 0U) {
+            bump(lost_, lost);
+        }
+    }
+
+    bool started_{false};
+    uint32_t highest_{0};
+    std::array<uint64_t, kWords> bitmap_{};
+
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> lost_{0};
+    std::atomic<uint64_t> duplicate_{0};
+    std::atomic<uint64_t> out_of_order_{0};
+    std::atomic<uint64_t> late_{0};
+    std::atomic<uint64_t> resets_{0};
+    std::atomic<uint32_t> highest_seq_{0};
+};
+}
+}
+/** @}*/    // end of group forward
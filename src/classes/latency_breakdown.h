@@ -0,0 +1,95 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file latency_breakdown.h
+* @brief per stage accounting of the receive path latency
+* @details A record passes the stages
+*      sender ns --wire--> NIC (xudp_msg::usec) --kernel/XDP--> rx ring pickup --decode--> recv_ns --store--> sink
+*  and every stage keeps count, sum and max of its duration, so the receive latency can be
+*  attributed to the network, to the kernel/XDP path or to our own decode and store code.
+*  wire-to-NIC is only sampled once the sender clock offset is known, the NIC stages only when the
+*  driver provides a timestamp.
+*
+*  Single writer: only the receive thread calls add(), counters are relaxed atomics.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace forward{
+namespace classes{
+class LatencyBreakdown {
+public:
+    enum Stage : uint32_t {
+        kWireToNic = 0,     // 发送端时间戳到网卡收包, 需要对时
+        kNicToUser,         // 网卡收包到用户态从接收环取到
+        kUserToDecode,      // 取到到解码完成
+        kDecodeToStore,     // 解码完成到交给存储
+        kStageCount,
+    };
+
+    static const char* stage_name(uint32_t stage) {
+        static const char* names[kStageCount] = {"wire_to_nic", "nic_to_user", "user_to_decode",
+                                                 "decode_to_store"};
+        return (stage < kStageCount) ? names[stage] : "unknown";
+    }
+
+    /**
+     * \brief snapshot of one stage.
+     */
+    struct StageStats {
+        uint64_t count{0};
+        int64_t sum_ns{0};
+        int64_t max_ns{0};
+
+        int64_t average_ns() const {
+            return (count == 0U) ? 0 : sum_ns / static_cast<int64_t>(count);
+        }
+
+        void merge(const StageStats& other) {
+            count += other.count;
+            sum_ns += other.sum_ns;
+            max_ns = (other.max_ns > max_ns) ? other.max_ns : max_ns;
+        }
+    };
+
+    LatencyBreakdown() = default;
+    LatencyBreakdown(const LatencyBreakdown&) = delete;
+    LatencyBreakdown& operator=(const LatencyBreakdown&) = delete;
+
+    void add(Stage stage, int64_t ns) {
+        Slot& slot = slots_[stage];
+        slot.count.store(slot.count.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+        slot.sum_ns.store(slot.sum_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        if (ns > slot.max_ns.load(std::memory_order_relaxed)) {
+            slot.max_ns.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    StageStats get(uint32_t stage) const {
+        StageStats s;
+        s.count = slots_[stage].count.load(std::memory_order_relaxed);
+        s.sum_ns = slots_[stage].sum_ns.load(std::memory_order_relaxed);
+        s.max_ns = slots_[stage].max_ns.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> count{0};
+        std::atomic<int64_t> sum_ns{0};
+        std::atomic<int64_t> max_ns{0};
+    };
+
+    Slot slots_[kStageCount];
+};
+}
+}
+/** @}*/    // end of group forward
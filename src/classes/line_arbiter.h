@@ -0,0 +1,154 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file line_arbiter.h
+* @brief first-arrival-wins arbitration of a stream sent on two redundant paths (A/B feed)
+* @details The sender emits every sequenced frame on path A and path B, the B copy carries
+*  kSeqFlagPathB. The arbiter keeps the last kSlots sequence numbers in a power-of-two array
+*  indexed by seq, so the decision per frame is one slot load and compare: the first copy of a seq
+*  is delivered, the second one only records which path lost and by how much.
+*
+*  The arbiter stays passive until the first path-B frame is seen, single path streams pay nothing.
+*  Single writer: only the receive thread calls on_frame(), counters are relaxed atomics.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace forward{
+namespace classes{
+class LineArbiter {
+public:
+    static constexpr uint32_t kSlots = 4096;    // 必须是2的幂
+    static constexpr uint32_t kPathA = 0;
+    static constexpr uint32_t kPathB = 1;
+    static constexpr uint32_t kPaths = 2;
+
+    /**
+     * \brief snapshot of the counters.
+     */
+    struct Counters {
+        bool active{false};
+        uint64_t wins[kPaths]{};        // 先到的一路
+        uint64_t pairs{0};              // 两路都收到的seq数
+        uint64_t lag_sum_ns{0};         // 后到一路落后的时间之和
+        uint64_t lag_max_ns{0};
+        int64_t b_minus_a_sum_ns{0};    // B路到达时间减A路到达时间之和, 正数表示A路更快
+
+        double win_ratio(uint32_t path) const {
+            const uint64_t total = wins[kPathA] + wins[kPathB];
+            return (total == 0U) ? 0.0 : static_cast<double>(wins[path]) / static_cast<double>(total);
+        }
+
+        uint64_t average_lag_ns() const {
+            return (pairs == 0U) ? 0U : lag_sum_ns / pairs;
+        }
+    };
+
+    LineArbiter() : slots_(kSlots) {}
+    LineArbiter(const LineArbiter&) = delete;
+    LineArbiter& operator=(const LineArbiter&) = delete;
+
+    /**
+     * \brief arbitrate one copy of seq.
+     * \return true if this is the first copy and must be delivered, false if the other path won.
+     */
+    bool on_frame(uint32_t seq, bool path_b, int64_t now_ns) {
+        if (!active_) {
+            if (!path_b) {
+                return true;
+            }
+            active_ = true;
+            active_flag_.store(true, std::memory_order_relaxed);
+        }
+
+        const uint32_t path = path_b ? kPathB : kPathA;
+        Slot& slot = slots_[seq & (kSlots - 1U)];
+        if (slot.used && slot.seq == seq) {
+            if (slot.paired || slot.path == path) {
+                return false;   // 同一路重复或第三份副本, 交给后面的去重
+            }
+            slot.paired = true;
+            const int64_t lag = now_ns - slot.arrival_ns;
+            const uint64_t abs_lag = static_cast<uint64_t>(lag < 0 ? -lag : lag);
+            bump(pairs_);
+            bump(lag_sum_ns_, abs_lag);
+            if (abs_lag > lag_max_ns_.load(std::memory_order_relaxed)) {
+                lag_max_ns_.store(abs_lag, std::memory_order_relaxed);
+            }
+            const int64_t b_minus_a = (path == kPathB) ? lag : -lag;
+            b_minus_a_sum_ns_.store(b_minus_a_sum_ns_.load(std::memory_order_relaxed) + b_minus_a,
+                                    std::memory_order_relaxed);
+            return false;
+        }
+        if (slot.used && static_cast<int32_t>(seq - slot.seq) < 0) {
+            return true;        // 早于窗口, 由GapDetector判定为迟到或重复
+        }
+        slot.seq = seq;
+        slot.path = static_cast<uint8_t>(path);
+        slot.used = true;
+        slot.paired = false;
+        slot.arrival_ns = now_ns;
+        bump(wins_[path]);
+        return true;
+    }
+
+    /**
+     * \brief forget the recorded sequence numbers, the sender restarted its sequence.
+     */
+    void reset() {
+        for (auto& slot : slots_) {
+            slot = Slot{};
+        }
+    }
+
+    bool active() const {
+        return active_flag_.load(std::memory_order_relaxed);
+    }
+
+    Counters get_counters() const {
+        Counters c;
+        c.active = active();
+        for (uint32_t i = 0; i < kPaths; ++i) {
+            c.wins[i] = wins_[i].load(std::memory_order_relaxed);
+        }
+        c.pairs = pairs_.load(std::memory_order_relaxed);
+        c.lag_sum_ns = lag_sum_ns_.load(std::memory_order_relaxed);
+        c.lag_max_ns = lag_max_ns_.load(std::memory_order_relaxed);
+        c.b_minus_a_sum_ns = b_minus_a_sum_ns_.load(std::memory_order_relaxed);
+        return c;
+    }
+
+private:
+    struct Slot {
+        uint32_t seq{0};
+        uint8_t path{0};
+        bool used{false};
+        bool paired{false};
+        int64_t arrival_ns{0};
+    };
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1U) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::vector<Slot> slots_;
+    bool active_{false};
+    std::atomic<bool> active_flag_{false};
+    std::atomic<uint64_t> wins_[kPaths]{};
+    std::atomic<uint64_t> pairs_{0};
+    std::atomic<uint64_t> lag_sum_ns_{0};
+    std::atomic<uint64_t> lag_max_ns_{0};
+    std::atomic<int64_t> b_minus_a_sum_ns_{0};
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,130 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file nack_tracker.h
+* @brief collects the gaps of one sequenced stream during a receive burst and builds the NACK
+* @details Gaps found while handling one burst are merged into at most kMaxRanges ranges and sent
+*  back to the sender as a single kCmdNack frame when the burst is done. A gap larger than
+*  kMaxRangeCount is only partly requested, the rest is beyond what the sender ring can hold anyway.
+*
+*  Single writer like GapDetector, counters are relaxed atomics for the stats thread.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstring>
+#include <sys/socket.h>
+
+#include "structs/pack_helper.h"
+
+namespace forward{
+namespace classes{
+class NackTracker {
+public:
+    static constexpr uint16_t kMaxRanges = 64;
+    static constexpr uint32_t kMaxRangeCount = 256;
+
+    struct Counters {
+        uint64_t nacks_sent{0};     // 发送的NACK报文数
+        uint64_t requested{0};      // 请求重传的帧数
+        uint64_t recovered{0};      // 重传补回的帧数
+    };
+
+    NackTracker() = default;
+    NackTracker(const NackTracker&) = delete;
+    NackTracker& operator=(const NackTracker&) = delete;
+
+    /**
+     * \brief record count missing frames starting at first, peer is where the NACK goes.
+     */
+    void on_gap(uint32_t first, uint32_t count, const sockaddr_storage& peer) {
+        if (count > kMaxRangeCount) {
+            first += count - kMaxRangeCount;    // 只请求最近的部分
+            count = kMaxRangeCount;
+        }
+        memcpy(&peer_, &peer, sizeof(peer_));
+        if (range_count_ != 0U) {
+            structs::NackRange& last = ranges_[range_count_ - 1U];
+            if (last.start + last.count == first && last.count + count <= UINT16_MAX) {
+                last.count = static_cast<uint16_t>(last.count + count);
+                return;
+            }
+        }
+        if (range_count_ == kMaxRanges) {
+            return;
+        }
+        ranges_[range_count_++] = structs::NackRange{first, static_cast<uint16_t>(count)};
+    }
+
+    /**
+     * \brief drop the pending ranges, the sender restarted its sequence.
+     */
+    void reset() {
+        range_count_ = 0;
+    }
+
+    void on_recovered() {
+        bump(recovered_);
+    }
+
+    bool pending() const {
+        return range_count_ != 0U;
+    }
+
+    const sockaddr_storage& peer() const {
+        return peer_;
+    }
+
+    /**
+     * \brief write the pending ranges as a kCmdNack frame into buf and clear them.
+     * \return frame length, 0 if nothing is pending.
+     */
+    uint32_t build(uint8_t* buf, uint32_t capacity, uint16_t channel_id) {
+        if (range_count_ == 0U) {
+            return 0;
+        }
+        const uint32_t len = structs::PackHelper::makeupNack(buf, capacity, channel_id,
+                                                            ranges_.data(), range_count_);
+        uint64_t requested = 0;
+        for (uint16_t i = 0; i < range_count_; ++i) {
+            requested += ranges_[i].count;
+        }
+        range_count_ = 0;
+        if (len != 0U) {
+            bump(nacks_sent_);
+            bump(requested_, requested);
+        }
+        return len;
+    }
+
+    Counters get_counters() const {
+        Counters c;
+        c.nacks_sent = nacks_sent_.load(std::memory_order_relaxed);
+        c.requested = requested_.load(std::memory_order_relaxed);
+        c.recovered = recovered_.load(std::memory_order_relaxed);
+        return c;
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1U) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::array<structs::NackRange, kMaxRanges> ranges_{};
+    uint16_t range_count_{0};
+    sockaddr_storage peer_{};
+
+    std::atomic<uint64_t> nacks_sent_{0};
+    std::atomic<uint64_t> requested_{0};
+    std::atomic<uint64_t> recovered_{0};
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,173 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file record_buffer.h
+* @brief records of one type in pooled blocks, from the decoding worker to the storager
+* @details A RecordBlock holds up to kCapacity records, one slab pool per record type provides
+*  them. The RxWorker decodes straight into a block and hands the pointer over with
+*  DataStorager::asyncWriteBlock(), the records are not copied again until they are formatted
+*  into CSV. The storager keeps its blocks in a RecordBuffer and releases them to the pool
+*  after the flush, possibly on another worker thread than the one that decoded them.
+*
+*  A block that would fit into the free space of the last held block is copied there and
+*  released right away, so at low rates, where every burst is a handful of records, the held
+*  blocks stay about full and their number stays bounded by the flush size.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/slab_pool.h"
+
+namespace forward{
+namespace classes{
+    template <typename T>
+    struct alignas(64) RecordBlock {
+        static constexpr uint32_t kCapacity = 64;
+
+        uint32_t count;
+        T records[kCapacity];
+
+        bool full() const {
+            return count == kCapacity;
+        }
+    };
+
+template <typename T>
+class RecordBuffer {
+public:
+    using Block = RecordBlock<T>;
+
+    static constexpr uint32_t kPoolBlocks = 256;
+
+    /**
+     * \param max_records : flush size of the storager, the block list is reserved for it.
+     * \param name : record type, label of the pool metrics.
+     */
+    RecordBuffer(size_t max_records, const std::string& name)
+            : pool_(kPoolBlocks, name) {
+        // 除最后一块外相邻两块合计超过一块容量, 再留出一批跨块追加的余量
+        blocks_.reserve(2U * ((max_records + Block::kCapacity - 1U) / Block::kCapacity) + 8U);
+    }
+
+    RecordBuffer(const RecordBuffer&) = delete;
+    RecordBuffer& operator=(const RecordBuffer&) = delete;
+
+    ~RecordBuffer() {
+        clear();
+    }
+
+    /**
+     * \return an empty block, nullptr if the pool is exhausted.
+     */
+    Block* acquire() {
+        Block *block = pool_.acquire();
+        if (block != nullptr) {
+            block->count = 0;
+        }
+        return block;
+    }
+
+    /**
+     * \brief give back a block that was not handed to adopt().
+     */
+    void release(Block *block) {
+        pool_.release(block);
+    }
+
+    /**
+     * \brief take over a block from acquire(), or copy it into the last block if it fits.
+     */
+    void adopt(Block *block) {
+        if (block->count == 0U) {
+            pool_.release(block);
+            return;
+        }
+        Block *tail = blocks_.empty() ? nullptr : blocks_.back();
+        size_ += block->count;
+        if (tail != nullptr && tail->count + block->count <= Block::kCapacity) {
+            memcpy(&tail->records[tail->count], block->records, block->count * sizeof(T));
+            tail->count += block->count;
+            pool_.release(block);
+            return;
+        }
+        blocks_.push_back(block);
+    }
+
+    /**
+     * \brief copy count records in, filling the last block and then new ones.
+     * \return number of records copied, less than count if the pool is exhausted.
+     */
+    size_t append(const T *records, size_t count) {
+        size_t copied = 0;
+        while (copied < count) {
+            Block *tail = blocks_.empty() ? nullptr : blocks_.back();
+            if (tail == nullptr || tail->full()) {
+                tail = acquire();
+                if (tail == nullptr) {
+                    break;
+                }
+                blocks_.push_back(tail);
+            }
+            const size_t n = std::min<size_t>(count - copied, Block::kCapacity - tail->count);
+            memcpy(&tail->records[tail->count], records + copied, n * sizeof(T));
+            tail->count += static_cast<uint32_t>(n);
+            copied += n;
+        }
+        size_ += copied;
+        return copied;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0U;
+    }
+
+    const T& front() const {
+        return blocks_.front()->records[0];
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const Block *block : blocks_) {
+            for (uint32_t i = 0; i < block->count; ++i) {
+                f(block->records[i]);
+            }
+        }
+    }
+
+    /**
+     * \brief release every held block to the pool.
+     */
+    void clear() {
+        for (Block *block : blocks_) {
+            pool_.release(block);
+        }
+        blocks_.clear();
+        size_ = 0;
+    }
+
+    common::PoolStats get_pool_stats() const {
+        return pool_.get_stats();
+    }
+
+private:
+    common::SlabPool<Block> pool_;
+    std::vector<Block*> blocks_;
+    size_t size_{0};
+};
+}
+}
+/** @}*/    // end of group forward
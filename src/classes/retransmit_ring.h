@@ -0,0 +1,88 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file retransmit_ring.h
+* @brief bounded store of recently sent frames of one channel, keyed by sequence number
+* @details Slot i holds the frame whose seq maps to i, a newer frame silently evicts the older one.
+*  Memory is fixed at construction: slots * kMaxFrameSize bytes, frames larger than a slot are not
+*  kept and can not be retransmitted.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "common/memory_hardening.h"
+
+namespace forward{
+namespace classes{
+class RetransmitRing {
+public:
+    static constexpr uint32_t kMaxFrameSize = 1472;    // 以太网MTU下的UDP载荷
+
+    /**
+     * \param slots : number of frames kept, rounded up to a power of two.
+     */
+    explicit RetransmitRing(uint32_t slots) {
+        uint32_t n = 1;
+        while (n < slots) {
+            n <<= 1U;
+        }
+        mask_ = n - 1U;
+        slots_.resize(n);
+    }
+
+    RetransmitRing(const RetransmitRing&) = delete;
+    RetransmitRing& operator=(const RetransmitRing&) = delete;
+
+    void store(uint32_t seq, const uint8_t* data, uint32_t size) {
+        Slot& slot = slots_[seq & mask_];
+        if (size > kMaxFrameSize) {
+            slot.size = 0;      // 旧帧已被覆盖, 新帧存不下
+            return;
+        }
+        slot.seq = seq;
+        slot.size = size;
+        memcpy(slot.data, data, size);
+    }
+
+    /**
+     * \return the stored frame, nullptr when seq has been evicted or never stored.
+     */
+    const uint8_t* find(uint32_t seq, uint32_t& size) const {
+        const Slot& slot = slots_[seq & mask_];
+        if (slot.size == 0U || slot.seq != seq) {
+            return nullptr;
+        }
+        size = slot.size;
+        return slot.data;
+    }
+
+    uint32_t capacity() const {
+        return static_cast<uint32_t>(slots_.size());
+    }
+
+    size_t memory_bytes() const {
+        return slots_.size() * sizeof(Slot);
+    }
+
+private:
+    struct Slot {
+        uint32_t seq{0};
+        uint32_t size{0};
+        uint8_t data[kMaxFrameSize];
+    };
+
+    uint32_t mask_{0};
+    std::vector<Slot, common::HugePageAllocator<Slot>> slots_;
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,84 @@
+#include "rx_batch_pool.h"
+
+#include <iostream>
+#include <thread>
+
+namespace forward {
+namespace classes {
+
+    RxBatchPool::RxBatchPool(uint32_t hold_batches, uint32_t batch_size, const std::string& labels)
+            : batch_size_(batch_size) {
+        for (uint32_t i = 0; i <= hold_batches; ++i) {
+            batches_.emplace_back(std::make_unique<RxBatch>());
+            RxBatch *batch = batches_.back().get();
+            batch->msgs.resize(batch_size);
+            batch->hdr.msg = batch->msgs.data();
+            batch->hdr.total = batch_size;
+            batch->hdr.used = 0;
+            batch->zero_copy = (i != hold_batches);
+        }
+        auto& metrics = common::MetricsRegistry::get_instance();
+        zero_copy_batches_ = metrics.counter("forward_rx_zero_copy_batches_total", labels);
+        copy_batches_ = metrics.counter("forward_rx_copy_batches_total", labels);
+        held_batches_ = metrics.gauge("forward_rx_held_batches", labels);
+        std::cout << "RxBatchPool hold batches " << hold_batches << " batch size " << batch_size << std::endl;
+    }
+
+    RxBatch* RxBatchPool::acquire() {
+        if (held_ != 0U) {
+            reclaim();
+        }
+        RxBatch *copy = batches_.back().get();
+        for (auto& batch : batches_) {
+            if (batch->zero_copy && !batch->held) {
+                batch->hdr.used = 0;
+                return batch.get();
+            }
+        }
+        copy->hdr.used = 0;
+        return copy;
+    }
+
+    void RxBatchPool::finish(RxBatch *batch) {
+        if (batch->zero_copy) {
+            zero_copy_batches_.add();
+        } else {
+            copy_batches_.add();
+        }
+        if (batch->refs.load(std::memory_order_acquire) == 0U) {
+            recycle(batch);
+            return;
+        }
+        batch->held = true;
+        ++held_;
+        held_batches_.set(held_);
+    }
+
+    void RxBatchPool::reclaim() {
+        for (auto& batch : batches_) {
+            if (batch->held && batch->refs.load(std::memory_order_acquire) == 0U) {
+                batch->held = false;
+                --held_;
+                recycle(batch.get());
+            }
+        }
+        held_batches_.set(held_);
+    }
+
+    void RxBatchPool::drain() {
+        while (held_ != 0U) {
+            reclaim();
+            if (held_ != 0U) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void RxBatchPool::recycle(RxBatch *batch) {
+        if (batch->hdr.used != 0U) {
+            xudp_recycle(&batch->hdr);
+            batch->hdr.used = 0;
+        }
+    }
+} /* namespace classes */
+} /* namespace forward */
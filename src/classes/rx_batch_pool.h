@@ -0,0 +1,100 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file rx_batch_pool.h
+* @brief receive batches whose xudp frames can be held by the workers
+* @details Every xudp_recv_channel() call fills one RxBatch. A zero copy batch is not recycled
+*  when the receive thread is done with it: the workers read the payloads straight from UMEM and
+*  drop the reference count of the batch once a frame is stored. The receive thread recycles the
+*  batch later, when the count reached zero, so xudp_recycle() keeps running on the thread that
+*  owns the fill ring.
+*
+*  At most hold_batches batches are held at a time, so hold_batches * batch_size must stay well
+*  below the rx frame number of the channel. When all of them are still in use, acquire() hands
+*  out the copy batch: its frames are copied into the worker queues and it is recycled at once,
+*  so the fill ring is never starved by a slow worker.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xudp.h"
+#include "common/metrics.h"
+#include "common/memory_hardening.h"
+
+namespace forward{
+namespace classes{
+    /**
+     * \brief messages of one xudp_recv_channel() call.
+     */
+    struct RxBatch {
+        std::vector<xudp_msg, common::HugePageAllocator<xudp_msg>> msgs;
+        xudp_msghdr hdr{};
+        std::atomic<uint32_t> refs{0};      // 仍在工作线程队列中的帧数
+        bool zero_copy{false};              // false: 拷贝批次, 处理完立即回收
+        bool held{false};                   // 已交给工作线程, 等待回收
+    };
+
+class RxBatchPool {
+public:
+    /**
+     * \param hold_batches : number of zero copy batches, 0 always copies.
+     * \param batch_size : messages per batch.
+     * \param labels : metric labels of the receiver.
+     */
+    RxBatchPool(uint32_t hold_batches, uint32_t batch_size, const std::string& labels);
+
+    RxBatchPool(const RxBatchPool&) = delete;
+    RxBatchPool& operator=(const RxBatchPool&) = delete;
+
+    /**
+     * \brief receive thread: recycle the finished batches and return an empty one.
+     * \return a zero copy batch if one is free, else the copy batch.
+     */
+    RxBatch* acquire();
+
+    /**
+     * \brief receive thread: the batch is handled, recycle it unless workers still hold frames of it.
+     */
+    void finish(RxBatch *batch);
+
+    /**
+     * \brief receive thread: wait until the workers released every batch and recycle them.
+     *
+     * The workers must be stopped, or still running, when this is called.
+     */
+    void drain();
+
+    uint32_t batch_size() const {
+        return batch_size_;
+    }
+
+private:
+    void recycle(RxBatch *batch);
+
+    /**
+     * \brief recycle the held batches the workers are done with.
+     */
+    void reclaim();
+
+    uint32_t batch_size_;
+    std::vector<std::unique_ptr<RxBatch>> batches_;     // 最后一个为拷贝批次
+    uint32_t held_{0};
+
+    common::Counter zero_copy_batches_;
+    common::Counter copy_batches_;          // 持有预算用尽后回退到拷贝的批次
+    common::Gauge held_batches_;
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,203 @@
+#include "rx_worker.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "storager_mgr.h"
+#include "structs/pack_helper.h"
+#include "tools/pb_decode.h"
+#include "common/tracer.h"
+#include "common/logger.h"
+#include "common/thread_topology.h"
+
+namespace forward {
+namespace classes {
+
+    // 单向时延: 接收时刻减去换算到本地时钟的发送时刻, 尚未对时则为未修正的差值
+    static int64_t one_way_ns(uint64_t ns, uint64_t recv_ns, const ClockEstimator *clock) {
+        const int64_t raw = static_cast<int64_t>(recv_ns - ns);
+        if (clock == nullptr || !clock->valid()) {
+            return raw;
+        }
+        return raw + clock->offset_at(static_cast<int64_t>(recv_ns));
+    }
+
+    RxWorker::RxWorker(uint32_t index, const std::string& labels)
+            : index_(index) {
+        auto& metrics = common::MetricsRegistry::get_instance();
+        const std::string worker_labels = labels + ",worker=\"" + std::to_string(index) + "\"";
+        processed_ = metrics.counter("forward_rx_worker_processed_total", worker_labels);
+        dropped_ = metrics.counter("forward_rx_worker_dropped_total", worker_labels);
+        decode_errors_ = metrics.counter("forward_rx_decode_errors_total", worker_labels);
+        queue_depth_ = metrics.gauge("forward_rx_worker_queue_depth", worker_labels);
+
+        // 存储器在接收器创建前已注册, 此处解析一次, 避免每条记录查表
+        auto& mgr = StorageMgr::get_instance();
+        pending_a_.data_type = "StructA";
+        pending_a_.storager = mgr.get_storager(pending_a_.data_type);
+        pending_b_.data_type = "StructB";
+        pending_b_.storager = mgr.get_storager(pending_b_.data_type);
+    }
+
+    RxWorker::~RxWorker() {
+        stop();
+        flush();    // 归还内联解码时未交出的块
+    }
+
+    void RxWorker::start() {
+        if (running_.exchange(true)) {
+            return;
+        }
+        thread_ = std::thread([this]() { run(); });
+        std::cout << "RxWorker::start worker " << index_ << std::endl;
+    }
+
+    void RxWorker::stop() {
+        running_.store(false);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    bool RxWorker::submit(const Cmd *cmd, uint32_t len, const RxMeta& meta, std::atomic<uint32_t> *refs) {
+        Item *item = (refs != nullptr || len <= kMaxFrame) ? queue_.claim() : nullptr;
+        if (item == nullptr) {
+            dropped_.add();
+            FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "RxWorker %u queue full, frame dropped", index_);
+            return false;
+        }
+        item->meta = meta;
+        item->len = len;
+        item->refs = refs;
+        if (refs != nullptr) {
+            item->ref = cmd;
+            refs->fetch_add(1U, std::memory_order_relaxed);
+        } else {
+            item->ref = nullptr;
+            memcpy(item->frame, cmd, len);
+        }
+        queue_.publish();
+        return true;
+    }
+
+    void RxWorker::publish_depth() const {
+        queue_depth_.set(queue_.size());
+    }
+
+    void RxWorker::run() {
+        (void)common::ThreadTopology::get_instance().apply("rx_worker", "forward Wk" + std::to_string(index_));
+        uint32_t idle = 0;
+        // 停止后先排空队列再退出
+        while (true) {
+            uint32_t n = 0;
+            Item *item;
+            while (n < kDecodeBatch && (item = queue_.peek()) != nullptr) {
+                if (item->ref != nullptr) {
+                    decode(item->ref, item->meta);
+                    // 解码后记录已不引用帧, 允许接收线程回收所在批次
+                    item->refs->fetch_sub(1U, std::memory_order_release);
+                } else {
+                    decode(reinterpret_cast<const Cmd *>(item->frame), item->meta);
+                }
+                queue_.release();
+                ++n;
+            }
+            if (n != 0U) {
+                idle = 0;
+                flush();
+                continue;
+            }
+            if (!running_.load(std::memory_order_relaxed)) {
+                break;
+            }
+            if (++idle < kSpinRounds) {
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    template <typename T>
+    void RxWorker::decode_record(const Cmd *cmd, Pending<T>& pending, const RxMeta& meta) {
+        if (pending.block == nullptr) {
+            if (pending.storager == nullptr) {
+                FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "RxWorker no storager for %s",
+                                         pending.data_type);
+                return;
+            }
+            pending.block = static_cast<RecordBlock<T> *>(pending.storager->acquireBlock());
+            if (pending.block == nullptr) {
+                // 池已计数, 存储跟不上时丢弃而不是分配
+                FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "RxWorker %s record pool exhausted, record dropped",
+                                         pending.data_type);
+                return;
+            }
+        }
+        // 池中的块保留上次的内容, pb中缺省的字段须为默认值
+        T& record = pending.block->records[pending.block->count];
+        record = T{};
+        // 网络来的畸形报文只计数丢弃, 不抛异常
+        const std::error_code ec = tool::PbDecoder::decode(record, PackHelper::payload(cmd));
+        if (ec) {
+            decode_errors_.add();
+            FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "RxWorker decode %s failed: %s",
+                                     pending.data_type, ec.message());
+            return;
+        }
+        common::Tracer::emit(common::TraceStage::kDecode, common::Tracer::key(structs::CmdNo<T>::no, record.total_id));
+
+        record.recv_ns = StorageMgr::get_instance().get_ns();
+        record.owd_ns = one_way_ns(record.ns, record.recv_ns, meta.clock);
+        record.nic_ns = meta.nic_ns;
+        record.rx_ns = meta.rx_ns;
+
+        if (meta.nic_ns != 0) {
+            if (meta.clock != nullptr && meta.clock->valid()) {
+                const int64_t sent_ns = static_cast<int64_t>(record.ns) - meta.clock->offset_at(meta.nic_ns);
+                latency_.add(LatencyBreakdown::kWireToNic, meta.nic_ns - sent_ns);
+            }
+            latency_.add(LatencyBreakdown::kNicToUser, meta.rx_ns - meta.nic_ns);
+        }
+        // 含在队列中等待的时间
+        latency_.add(LatencyBreakdown::kUserToDecode, static_cast<int64_t>(record.recv_ns) - meta.rx_ns);
+
+        if (++pending.block->count == RecordBlock<T>::kCapacity) {
+            flush_records(pending);
+        }
+    }
+
+    template <typename T>
+    void RxWorker::flush_records(Pending<T>& pending) {
+        RecordBlock<T> *block = pending.block;
+        if (block == nullptr) {
+            return;
+        }
+        pending.block = nullptr;
+        // 交出后块可能随即被刷盘并归还给池, 先记录时延
+        const uint32_t count = block->count;
+        const int64_t stored_ns = StorageMgr::get_instance().get_ns();
+        for (uint32_t i = 0; i < count; ++i) {
+            common::Tracer::emit(common::TraceStage::kSinkEnqueue,
+                                 common::Tracer::key(structs::CmdNo<T>::no, block->records[i].total_id));
+            latency_.add(LatencyBreakdown::kDecodeToStore, stored_ns - static_cast<int64_t>(block->records[i].recv_ns));
+        }
+        pending.storager->asyncWriteBlock(block);
+        processed_.add(static_cast<int64_t>(count));
+    }
+
+    void RxWorker::decode(const Cmd *cmd, const RxMeta& meta) {
+        const uint16_t no = PackHelper::cmdNo(cmd);
+        if(no == 1) {
+            decode_record(cmd, pending_a_, meta);
+        } else if(no == 2) {
+            decode_record(cmd, pending_b_, meta);
+        }
+    }
+
+    void RxWorker::flush() {
+        flush_records(pending_a_);
+        flush_records(pending_b_);
+    }
+} /* namespace classes */
+} /* namespace forward */
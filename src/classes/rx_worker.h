@@ -0,0 +1,150 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file rx_worker.h
+* @brief decode and storage stage of the receive pipeline
+* @details The receive thread only parses the frame headers and copies each data frame into the
+*  SPSC queue of one worker, chosen by sender channel so the records of a stream stay in order.
+*  The worker does the protobuf decode, stamps the record and hands it to its storager, so a slow
+*  disk stalls the worker and not the receive thread, which keeps the xudp fill ring replenished.
+*  When a queue is full the frame is dropped and counted rather than blocking the receive thread.
+*
+*  Records are decoded straight into a RecordBlock from the pool of their storager and the block
+*  is handed over by pointer with asyncWriteBlock() when it is full and at the end of each burst,
+*  the worker drains up to kDecodeBatch frames per burst. When the pool is exhausted the record
+*  is dropped and counted by the pool, see forward_pool_exhausted.
+*
+*  Frames of a zero copy RxBatch are not copied, the queue item points into UMEM and the worker
+*  drops the reference count of the batch when it is done, see RxBatchPool.
+*
+*  With no worker thread configured the receiver calls process() inline, as before.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <memory>
+#include <vector>
+
+#include "spsc_ring.h"
+#include "retransmit_ring.h"
+#include "clock_estimator.h"
+#include "latency_breakdown.h"
+#include "structs/cmd_def.h"
+#include "structs/structs.h"
+#include "data_storager.h"
+#include "record_buffer.h"
+#include "common/metrics.h"
+
+namespace forward{
+namespace classes{
+    /**
+     * \brief receive timestamps of the datagram a frame came in, written into every record.
+     */
+    struct RxMeta {
+        int64_t nic_ns;                 // 网卡收包时间, 0为驱动未提供
+        int64_t rx_ns;                  // 用户态从接收环取到的时间
+        const ClockEstimator *clock;    // 发送端时钟估计, 非序号帧为nullptr
+    };
+
+class RxWorker {
+public:
+    static constexpr uint32_t kQueueSize = 4096;
+    static constexpr uint32_t kMaxFrame = RetransmitRing::kMaxFrameSize;
+    static constexpr uint32_t kSpinRounds = 1024;   // 队列为空时先自旋再休眠
+    static constexpr uint32_t kDecodeBatch = 256;   // 每批最多解码的帧数
+
+    /**
+     * \param labels : metric labels of the receiver, the worker index is appended.
+     */
+    RxWorker(uint32_t index, const std::string& labels);
+    ~RxWorker();
+
+    RxWorker(const RxWorker&) = delete;
+    RxWorker& operator=(const RxWorker&) = delete;
+
+    void start();
+
+    /**
+     * \brief drain the queue and join the worker thread.
+     */
+    void stop();
+
+    /**
+     * \brief receive thread: queue the frame.
+     * \param refs : reference count of the zero copy batch holding cmd, the worker then reads the
+     *  frame in place and releases it after decoding. nullptr queues a copy of the frame.
+     * \return false if the queue is full or the frame too large, the frame is then dropped.
+     */
+    bool submit(const structs::Cmd *cmd, uint32_t len, const RxMeta& meta, std::atomic<uint32_t> *refs);
+
+    /**
+     * \brief decode one data frame into the pending block of its type.
+     */
+    void decode(const structs::Cmd *cmd, const RxMeta& meta);
+
+    /**
+     * \brief hand the pending blocks to their storagers, one call per type.
+     */
+    void flush();
+
+    const LatencyBreakdown& get_latency() const {
+        return latency_;
+    }
+
+    /**
+     * \brief receive thread: export the current queue depth, called once per received batch.
+     */
+    void publish_depth() const;
+
+private:
+    struct Item {
+        RxMeta meta;
+        uint32_t len;
+        const structs::Cmd *ref;            // 零拷贝时指向UMEM中的帧
+        std::atomic<uint32_t> *refs;        // 零拷贝批次的引用计数
+        alignas(8) uint8_t frame[kMaxFrame];
+    };
+
+    /**
+     * \brief block of one type being filled in the current burst.
+     */
+    template <typename T>
+    struct Pending {
+        RecordBlock<T> *block{nullptr};     // 取自storager的池, 交出后置空
+        std::shared_ptr<DataStorager> storager;
+        const char *data_type;
+    };
+
+    void run();
+
+    template <typename T>
+    void decode_record(const structs::Cmd *cmd, Pending<T>& pending, const RxMeta& meta);
+
+    template <typename T>
+    void flush_records(Pending<T>& pending);
+
+    uint32_t index_;
+    SpscRing<Item> queue_{kQueueSize};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    LatencyBreakdown latency_;
+    Pending<structs::StructA> pending_a_;
+    Pending<structs::StructB> pending_b_;
+
+    common::Counter processed_;
+    common::Counter dropped_;           // 队列满被丢弃, 由接收线程计数
+    common::Counter decode_errors_;
+    common::Gauge queue_depth_;         // 由接收线程在入队后更新
+};
+}
+}
+/** @}*/    // end of group forward
@@ -1,12 +1,15 @@
 
 #include <iostream>
 #include <netdb.h>
+#include <cstring>
 #include "sender_mgr.h"
+#include "structs/pack_helper.h"
+#include "common/logger.h"
 
 namespace forward {
 namespace classes {
-    SenderMgr::SenderMgr(const nlohmann::json& config)
-            : config_(config){   // Must use constructor to create nlohmann::json object.
+    SenderMgr::SenderMgr(const nlohmann::json& config, DatagramTransport *transport)
+            : config_(config), transport_(transport){   // Must use constructor to create nlohmann::json object.
                                  // Can not use initial list to create nlohmann::json.
                                  // Initial list will add [...] automatically around original object
     }
@@ -15,30 +18,32 @@ namespace classes {
         for(const auto& item : config_) {
             structs::SenderChannel info;
             if(info.initialize(item)) {
-                XUdpSender sender(info);
+                XUdpSender sender(info, transport_);
                 sender.initialize();
                 senders_.emplace_back(sender);
             }
         }
+        scheduler_.initialize(senders_);
     }
 
-    void SenderMgr::set_channel() {
-        xudp *x;
+    // 创建只绑定ip的xudp实例, 返回其第一个通道
+    static xudp *bind_xudp(const std::string& ip, const std::string& port, xudp_channel **ch) {
         xudp_conf conf = {};
         conf.group_num     = 1;
         conf.log_with_time = true;
         conf.log_level = XUDP_LOG_WARN;
-        x = xudp_init(&conf, sizeof(conf));
+        xudp *x = xudp_init(&conf, sizeof(conf));
         if(x == nullptr) {
             std::cout << "XUdpSender::initialize xudp_init failed." << std::endl;
-            return;
+            return nullptr;
         }
 
         struct addrinfo* tmp;
-        int ret = getaddrinfo("172.18.0.212", "0", NULL, &tmp);
+        int ret = getaddrinfo(ip.c_str(), port.c_str(), NULL, &tmp);
         if (ret) {
-            printf("XUdpSender::initialize getaddrinfo err ip: 0.0.0.0\n");
-            return;
+            printf("XUdpSender::initialize getaddrinfo err ip: %s\n", ip.c_str());
+            xudp_free(x);
+            return nullptr;
         }
         int size;
         if (tmp->ai_family == AF_INET) {
@@ -48,27 +53,131 @@ namespace classes {
             printf("AF_INET6 addr.\n");
             size = sizeof(struct sockaddr_in6);
         }
-        ret = xudp_bind(x, (struct sockaddr *)tmp->ai_addr, size, 1);
+        ret = xudp_bind(x, tmp->ai_addr, size, 1);
+        freeaddrinfo(tmp);
         if (ret) {
             xudp_free(x);
             printf("xudp bind fail %d\n", ret);
-            return;
+            return nullptr;
         }
 
         xudp_group *g;
         g = xudp_group_get(x, 0);
         if(g == nullptr) {
             std::cout << "XUdpSender::initialize xudp_group_get failed." << std::endl;
+            xudp_free(x);
+            return nullptr;
+        }
+        *ch = xudp_group_channel_first(g);
+        return x;
+    }
+
+    void SenderMgr::set_channel(const std::string& local_ip, const std::string& local_port,
+                                const std::string& backup_local_ip) {
+        xudp_channel *ch = nullptr;
+        xudp *x = bind_xudp(local_ip, local_port, &ch);
+        if (x == nullptr) {
             return;
         }
-        xudp_channel *ch = xudp_group_channel_first(g);
+        // B路径单独一个xudp实例, 副本从备用地址所在的网卡发出
+        xudp_channel *backup_ch = nullptr;
+        if (!backup_local_ip.empty()) {
+            backup_x_ = bind_xudp(backup_local_ip, local_port, &backup_ch);
+            if (backup_x_ == nullptr) {
+                printf("XUdpSender::initialize bind backup ip %s failed, B copies use the primary channel\n",
+                       backup_local_ip.c_str());
+            }
+        }
         for(auto& sender : senders_) {
             sender.set_channel(ch);
+            sender.set_backup_channel(backup_ch);
+        }
+        x_ = x;
+        ch_ = ch;
+        backup_ch_ = backup_ch;
+    }
+
+    int32_t SenderMgr::poll_feedback(const common::TimeSync& ts) {
+        // 接收端把NACK发回帧的来源地址, B路副本的反馈到达备用通道
+        int32_t handled = poll_channel(ch_, ts);
+        if (backup_ch_ != nullptr) {
+            handled += poll_channel(backup_ch_, ts);
+        }
+        return handled;
+    }
+
+    int32_t SenderMgr::poll_channel(xudp_channel *ch, const common::TimeSync& ts) {
+        if (ch == nullptr) {
+            return 0;
+        }
+        int32_t handled = 0;
+        bool replied = false;
+        xudp_def_msg(hdr, 16);
+        while (true) {
+            hdr->used = 0;
+            if (xudp_recv_channel(ch, hdr, 0) < 0 || hdr->used == 0) {
+                break;
+            }
+            const int64_t recv_ns = ts.get_ns();
+            for (uint32_t i = 0; i < hdr->used; ++i) {
+                const xudp_msg *m = hdr->msg + i;
+                const uint32_t len = structs::PackHelper::parseCmd(m->p, m->size);
+                if (len == 0U) {
+                    continue;
+                }
+                const auto *cmd = (const structs::Cmd *)m->p;
+                const auto *nack = structs::PackHelper::nackHeader(cmd);
+                if (nack != nullptr) {
+                    scheduler_.on_nack(*nack);
+                    ++handled;
+                    continue;
+                }
+                const auto *ping = structs::PackHelper::clockProbe(cmd, structs::kCmdPing);
+                if (ping != nullptr) {
+                    structs::ClockProbe pong = *ping;
+                    pong.t2 = recv_ns;
+                    uint8_t buf[sizeof(structs::Cmd) + sizeof(structs::ClockProbe)];
+                    pong.t3 = ts.get_ns();
+                    const uint32_t size = structs::PackHelper::makeupClockProbe(buf, sizeof(buf),
+                                                                              structs::kCmdPong, pong);
+                    const int ret = xudp_send_channel(ch, (char *)buf, size, (struct sockaddr *)&m->peer_addr, 0);
+                    if (ret < 0) {
+                        FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "SenderMgr send pong fail. %d", ret);
+                    }
+                    replied = true;
+                    ++handled;
+                }
+            }
+            xudp_recycle(hdr);
         }
+        if (replied) {
+            xudp_commit_channel(ch);
+        }
+        return handled;
     }
 
     const std::vector<XUdpSender>& SenderMgr::get_senders() {
         return senders_;
     }
+
+    bool SenderMgr::enqueue(size_t index, std::vector<uint8_t>& frame, int64_t now_ns) {
+        return scheduler_.enqueue(index, frame, now_ns);
+    }
+
+    int64_t SenderMgr::dispatch(int64_t now_ns) {
+        return scheduler_.dispatch(now_ns);
+    }
+
+    int32_t SenderMgr::get_feedback_fd() const {
+        return (ch_ == nullptr) ? -1 : xudp_channel_get_fd(ch_);
+    }
+
+    int32_t SenderMgr::get_backup_feedback_fd() const {
+        return (backup_ch_ == nullptr) ? -1 : xudp_channel_get_fd(backup_ch_);
+    }
+
+    const TxScheduler& SenderMgr::get_scheduler() const {
+        return scheduler_;
+    }
 } /* namespace common */
 } /* namespace forward */
\ No newline at end of file
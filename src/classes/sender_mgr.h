@@ -18,12 +18,17 @@
 #include "xudp.h"
 #include "nlohmann/json.hpp"
 #include "xudp_sender.h"
+#include "tx_scheduler.h"
+#include "common/time_sync.h"
 
 namespace forward{
 namespace classes{
 class SenderMgr {
 public:
-    explicit SenderMgr(const nlohmann::json& config);
+    /**
+     * \param transport : handed to every XUdpSender, nullptr sends through the xudp channel of set_channel().
+     */
+    explicit SenderMgr(const nlohmann::json& config, DatagramTransport *transport = nullptr);
     virtual ~SenderMgr() = default;
 
     SenderMgr(SenderMgr const&) = delete;
@@ -35,14 +40,67 @@ public:
      */
     void initialize();
 
-    void set_channel();
+    /**
+     * \brief create the xudp instance bound to the local address and hand its channel to every sender.
+     *
+     * The same channel receives the feedback (NACK) of the receivers, so local_port must be the
+     * port the receivers reply to. backup_local_ip, if not empty, is bound by a second xudp
+     * instance whose channel sends the B copies of an A/B feed, so they leave through the NIC of
+     * that address and its feedback is polled as well.
+     */
+    void set_channel(const std::string& local_ip = "172.18.0.212", const std::string& local_port = "0",
+                     const std::string& backup_local_ip = "");
+
+    /**
+     * \brief drain the feedback frames received on the channel, non blocking.
+     *
+     * NACKs are handed to the scheduler, clock pings are answered right away with a pong stamped
+     * by ts, the clock the frames are stamped with.
+     * \return number of feedback frames handled.
+     */
+    int32_t poll_feedback(const common::TimeSync& ts);
+
+    /**
+     * \brief fd of the channel feedback arrives on, readable when poll_feedback() has work.
+     * \return -1 before set_channel() succeeded.
+     */
+    int32_t get_feedback_fd() const;
+
+    /**
+     * \brief fd of the backup channel, -1 without backup_local_ip.
+     */
+    int32_t get_backup_feedback_fd() const;
 
     const std::vector<XUdpSender>& get_senders();
+
+    /**
+     * \brief queue a serialized frame on the sender at index, see TxScheduler.
+     * \return false if index is out of range or the queue of the sender is full.
+     */
+    bool enqueue(size_t index, std::vector<uint8_t>& frame, int64_t now_ns);
+
+    /**
+     * \brief send the queued frames by priority class and token buckets.
+     * \return nanoseconds until the next shaped frame becomes eligible, 0 if nothing is pending.
+     */
+    int64_t dispatch(int64_t now_ns);
+
+    const TxScheduler& get_scheduler() const;
 protected:
+    /**
+     * \brief poll_feedback() of one channel, pongs are sent back on ch.
+     */
+    int32_t poll_channel(xudp_channel *ch, const common::TimeSync& ts);
 
 private:
     const nlohmann::json& config_;        // sender json object of configuration
+    DatagramTransport *transport_{nullptr};
     std::vector<XUdpSender> senders_;
+    TxScheduler scheduler_;
+    xudp *x_{nullptr};
+    xudp_channel *ch_{nullptr};
+    xudp *backup_x_{nullptr};             // bound to backup_local_ip, nullptr without
+    xudp_channel *backup_ch_{nullptr};
 };
 }
 }
@@ -0,0 +1,110 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file spsc_ring.h
+* @brief bounded lock free single producer single consumer ring
+* @details Slots are written in place: the producer claims the next free slot, fills it and
+*  publishes it, the consumer peeks the oldest slot, uses it and releases it, so large items are
+*  never copied through the ring. Head and tail live on their own cache lines and each side keeps
+*  a cached copy of the other index, the shared line is only read when the cached one says the
+*  ring is full (producer) or empty (consumer).
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "common/memory_hardening.h"
+
+namespace forward{
+namespace classes{
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * \param capacity : number of slots, rounded up to a power of two.
+     */
+    explicit SpscRing(uint32_t capacity) {
+        uint32_t n = 1;
+        while (n < capacity) {
+            n <<= 1U;
+        }
+        mask_ = n - 1U;
+        slots_ = std::vector<T, common::HugePageAllocator<T>>(n);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * \brief producer: next free slot, nullptr when the ring is full.
+     */
+    T* claim() {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ > mask_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ > mask_) {
+                return nullptr;
+            }
+        }
+        return &slots_[head & mask_];
+    }
+
+    /**
+     * \brief producer: make the slot returned by claim() visible to the consumer.
+     */
+    void publish() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1U, std::memory_order_release);
+    }
+
+    /**
+     * \brief consumer: oldest published slot, nullptr when the ring is empty.
+     */
+    T* peek() {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+
+    /**
+     * \brief consumer: hand the slot returned by peek() back to the producer.
+     */
+    void release() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1U, std::memory_order_release);
+    }
+
+    /**
+     * \brief approximate number of queued items, any thread.
+     */
+    uint32_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    uint32_t capacity() const {
+        return mask_ + 1U;
+    }
+
+private:
+    alignas(64) std::atomic<uint32_t> head_{0};
+    uint32_t cached_tail_{0};                   // 生产者缓存的tail
+    alignas(64) std::atomic<uint32_t> tail_{0};
+    uint32_t cached_head_{0};                   // 消费者缓存的head
+    alignas(64) uint32_t mask_{0};
+    std::vector<T, common::HugePageAllocator<T>> slots_;     // 大页与预缺页由MemoryHardening决定
+};
+}
+}
+/** @}*/    // end of group forward
@@ -27,17 +27,21 @@ public:
         return instance;
     }
 
-    void initialize() {
-        // 初始化 TimeSync 类
-        ts_.init();
-        // 启动校准线程
-        ts_.start_calibration_thread();
+    /**
+     * \brief start the process wide clock, config is the optional "time_sync" object.
+     */
+    void initialize(const nlohmann::json& time_sync_config = nlohmann::json::object()) {
+        ts_.init(time_sync_config);
     }
 
     int64_t get_ns() const {
         return ts_.get_ns();
     }
 
+    const forward::common::TimeSync& get_time_sync() const {
+        return ts_;
+    }
+
     void add_storager(const std::string& data_type) {
         std::shared_ptr<DataStorager> ptr{nullptr};
         if(data_type == "StructA") {
@@ -78,8 +82,8 @@ protected:
     }
 private:
     std::unordered_map<std::string, std::shared_ptr<DataStorager>> storagers_;
-    // 初始化纳秒生成器
-    forward::common::TimeSync ts_;
+    // 进程内唯一的纳秒生成器
+    forward::common::TimeSync& ts_{forward::common::TimeSync::get_instance()};
 };
 }
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file token_bucket.h
+* @brief token bucket used to shape the egress of one sender channel
+* @details Tokens are refilled lazily from the timestamp passed in by the caller, so the
+*  bucket never reads a clock itself and costs a few arithmetic ops per check.
+*  A rate of 0 means the bucket is disabled and always admits.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+namespace forward{
+namespace classes{
+class TokenBucket {
+public:
+    static const int64_t NsPerSec = 1000000000;
+
+    TokenBucket() = default;
+
+    /**
+     * \param rate_per_sec : tokens refilled per second, 0 disables shaping
+     * \param burst        : bucket depth, 0 means one second worth of tokens
+     */
+    TokenBucket(uint64_t rate_per_sec, uint64_t burst) {
+        configure(rate_per_sec, burst);
+    }
+
+    void configure(uint64_t rate_per_sec, uint64_t burst) {
+        rate_per_sec_ = rate_per_sec;
+        burst_ = (burst == 0U) ? rate_per_sec : burst;
+        tokens_ = static_cast<double>(burst_);
+        last_ns_ = 0;
+    }
+
+    bool enabled() const {
+        return rate_per_sec_ != 0U;
+    }
+
+    /**
+     * \brief consume n tokens if available.
+     * \return true when the caller may send now.
+     */
+    bool try_consume(uint64_t n, int64_t now_ns) {
+        if (!enabled()) {
+            return true;
+        }
+        refill(now_ns);
+        if (tokens_ < static_cast<double>(n)) {
+            return false;
+        }
+        tokens_ -= static_cast<double>(n);
+        return true;
+    }
+
+    /**
+     * \brief consume n tokens even if they are not available, the bucket may go negative.
+     *
+     * For traffic that must leave now, such as FEC parity right after its block: later frames
+     * then wait until the debt is repaid, so the average rate still holds.
+     */
+    void charge(uint64_t n, int64_t now_ns) {
+        if (!enabled()) {
+            return;
+        }
+        refill(now_ns);
+        tokens_ -= static_cast<double>(n);
+    }
+
+    /**
+     * \brief check whether n tokens are available without consuming them.
+     */
+    bool can_consume(uint64_t n, int64_t now_ns) {
+        if (!enabled()) {
+            return true;
+        }
+        refill(now_ns);
+        return tokens_ >= static_cast<double>(n);
+    }
+
+    /**
+     * \return nanoseconds until n tokens are available, 0 if available now.
+     */
+    int64_t wait_ns(uint64_t n, int64_t now_ns) {
+        if (!enabled()) {
+            return 0;
+        }
+        refill(now_ns);
+        const double missing = static_cast<double>(n) - tokens_;
+        if (missing <= 0.0) {
+            return 0;
+        }
+        return static_cast<int64_t>(missing * NsPerSec / static_cast<double>(rate_per_sec_));
+    }
+
+private:
+    void refill(int64_t now_ns) {
+        if (last_ns_ != 0 && now_ns > last_ns_) {
+            tokens_ += static_cast<double>(now_ns - last_ns_) * static_cast<double>(rate_per_sec_) / NsPerSec;
+            tokens_ = std::min(tokens_, static_cast<double>(burst_));
+        }
+        last_ns_ = now_ns;
+    }
+
+    uint64_t rate_per_sec_{0};  // 每秒令牌数
+    uint64_t burst_{0};         // 桶深度
+    double   tokens_{0.0};      // 当前令牌数
+    int64_t  last_ns_{0};       // 上次补充令牌的时间
+};
+}
+}
+/** @}*/    // end of group forward
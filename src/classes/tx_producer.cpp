@@ -0,0 +1,66 @@
+#include "tx_producer.h"
+
+#include "structs/pack_helper.h"
+#include "common/logger.h"
+
+namespace forward {
+namespace classes {
+    TxProducer::TxProducer(const std::string& name, uint32_t queue_size, const std::vector<XUdpSender>& senders,
+                           const common::TimeSync& ts)
+            : name_(name), queue_(queue_size), ts_(ts) {
+        for (const auto& sender : senders) {
+            sequenced_.push_back(sender.get_channel().sequence_ ? 1U : 0U);
+        }
+        auto& metrics = common::MetricsRegistry::get_instance();
+        const std::string labels = "producer=\"" + name + "\"";
+        sent_counter_ = metrics.counter("forward_tx_producer_sent_total", labels);
+        rejected_counter_ = metrics.counter("forward_tx_producer_rejected_total", labels);
+        queue_depth_ = metrics.gauge("forward_tx_producer_queue_depth", labels);
+    }
+
+    bool TxProducer::send(size_t channel, uint16_t no, const std::string& payload, uint64_t trace_id) {
+        if (!is_open() || channel >= sequenced_.size()) {
+            reject();
+            return false;
+        }
+        Item *item = queue_.claim();
+        if (item == nullptr) {
+            reject();
+            return false;
+        }
+        // 直接序列化进环中的槽位, 发送线程再拷入调度队列
+        const uint32_t len = structs::PackHelper::makeupSerializeDataForCmd(payload, no, sequenced_[channel] != 0U,
+                                                                            item->frame, sizeof(item->frame));
+        if (len == 0U) {
+            FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "TxProducer %s frame of %zu bytes too large",
+                                     name_.c_str(), payload.size());
+            reject();
+            return false;
+        }
+        item->channel = static_cast<uint32_t>(channel);
+        item->len = len;
+        item->enqueue_ns = ts_.get_ns();
+        item->trace_id = trace_id;
+        queue_.publish();
+        sent_.fetch_add(1U, std::memory_order_relaxed);
+        sent_counter_.add();
+        return true;
+    }
+
+    void TxProducer::close() {
+        open_.store(false, std::memory_order_release);
+    }
+
+    TxProducer::Stats TxProducer::get_stats() const {
+        Stats stats;
+        stats.sent = sent_.load(std::memory_order_relaxed);
+        stats.rejected = rejected_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void TxProducer::reject() {
+        rejected_.fetch_add(1U, std::memory_order_relaxed);
+        rejected_counter_.add();
+    }
+} /* namespace classes */
+} /* namespace forward */
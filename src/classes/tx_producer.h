@@ -0,0 +1,139 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file tx_producer.h
+* @brief hand off of serialized frames from one producer thread to the sending thread
+* @details Each in-process producer gets a TxProducer from RuntimeSender::add_producer(). send()
+*  serializes on the producer thread straight into a slot of the SPSC ring of that producer, so
+*  producers never share a lock or a cache line with each other. The sending thread drains every
+*  ring into SenderMgr, which stays single threaded as before.
+*
+*  A full ring is not waited on: send() returns false and counts the frame as rejected, the
+*  producer decides whether to retry or drop it. After close() every send() is rejected, which
+*  is how RuntimeSender stops taking new frames while it drains the rings on shutdown.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "spsc_ring.h"
+#include "retransmit_ring.h"
+#include "xudp_sender.h"
+#include "common/time_sync.h"
+#include "common/tracer.h"
+#include "common/metrics.h"
+#include "iguana/iguana.hpp"
+
+namespace forward{
+namespace classes{
+class TxProducer {
+public:
+    static constexpr uint32_t kMaxFrame = RetransmitRing::kMaxFrameSize;
+
+    struct Item {
+        uint32_t channel;           // SenderMgr中发送器的下标
+        uint32_t len;
+        int64_t enqueue_ns;
+        uint64_t trace_id;
+        alignas(8) uint8_t frame[kMaxFrame];
+    };
+
+    struct Stats {
+        uint64_t sent{0};           // 已交给发送线程的帧数
+        uint64_t rejected{0};       // 队列满, 帧过长, 通道不存在或已关闭
+    };
+
+    /**
+     * \param senders : senders of the SenderMgr, a channel is an index into them.
+     */
+    TxProducer(const std::string& name, uint32_t queue_size, const std::vector<XUdpSender>& senders,
+               const common::TimeSync& ts);
+
+    TxProducer(const TxProducer&) = delete;
+    TxProducer& operator=(const TxProducer&) = delete;
+
+    /**
+     * \brief producer thread: serialize cmd.data as protobuf and queue it on channel.
+     */
+    template <typename CmdT>
+    bool send(size_t channel, const CmdT& cmd) {
+        iguana::to_pb(cmd.data, payload_);
+        const uint64_t trace_id = common::Tracer::key(CmdT::no, cmd.data.total_id);
+        common::Tracer::emit(common::TraceStage::kSerialize, trace_id);
+        return send(channel, CmdT::no, payload_, trace_id);
+    }
+
+    /**
+     * \brief producer thread: queue an already serialized payload with command number no.
+     * \return false if the frame was rejected, see Stats.
+     */
+    bool send(size_t channel, uint16_t no, const std::string& payload, uint64_t trace_id = 0);
+
+    /**
+     * \brief reject every later send().
+     */
+    void close();
+
+    bool is_open() const {
+        return open_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief sending thread: oldest queued frame, nullptr when the ring is empty.
+     */
+    Item* peek() {
+        return queue_.peek();
+    }
+
+    /**
+     * \brief sending thread: free the slot returned by peek().
+     */
+    void release() {
+        queue_.release();
+    }
+
+    /**
+     * \brief sending thread: export the current queue depth.
+     */
+    void publish_depth() const {
+        queue_depth_.set(queue_.size());
+    }
+
+    uint32_t depth() const {
+        return queue_.size();
+    }
+
+    const std::string& get_name() const {
+        return name_;
+    }
+
+    Stats get_stats() const;
+
+private:
+    void reject();
+
+    std::string name_;
+    SpscRing<Item> queue_;
+    std::vector<uint8_t> sequenced_;    // 按通道下标, 帧是否带SeqHeader
+    const common::TimeSync& ts_;
+    std::atomic<bool> open_{true};
+    std::string payload_;               // 序列化缓冲, 只在生产者线程使用
+
+    alignas(64) std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> rejected_{0};
+    common::Counter sent_counter_;
+    common::Counter rejected_counter_;
+    common::Gauge queue_depth_;         // 由发送线程更新
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,286 @@
+#include <iostream>
+#include <random>
+#include "tx_scheduler.h"
+#include "structs/pack_helper.h"
+#include "common/tracer.h"
+
+namespace forward {
+namespace classes {
+    void TxScheduler::initialize(const std::vector<XUdpSender>& senders) {
+        queues_.clear();
+        latency_queues_.clear();
+        bulk_queues_.clear();
+        queues_.resize(senders.size());
+        // 序号重新从1开始, 换一个代号让接收端丢弃旧窗口
+        epoch_ = static_cast<uint16_t>(std::random_device{}() & (structs::kSeqEpochMask >> structs::kSeqEpochShift));
+        for (size_t i = 0; i < senders.size(); ++i) {
+            const auto& channel = senders[i].get_channel();
+            ChannelQueue& queue = queues_[i];
+            queue.sender = &senders[i];
+            queue.priority = channel.priority_;
+            queue.coalesce_bytes = channel.coalesce_bytes_;
+            queue.channel_id = static_cast<uint16_t>(channel.channel_id_);
+            queue.sequence = channel.sequence_;
+            queue.frames.reset(channel.max_queue_frames_);
+            if (channel.sequence_ && channel.retransmit_slots_ != 0U) {
+                queue.ring = std::make_unique<RetransmitRing>(channel.retransmit_slots_);
+                std::cout << "TxScheduler channel " << channel.channel_id_ << " retransmit ring "
+                          << queue.ring->memory_bytes() << " bytes" << std::endl;
+            }
+            if (channel.sequence_ && channel.fec_k_ != 0U) {
+                if (channel.fec_k_ > FecCodec::kMaxData || channel.fec_m_ == 0U
+                    || channel.fec_m_ > FecCodec::kMaxParity) {
+                    std::cout << "TxScheduler channel " << channel.channel_id_ << " invalid fec k "
+                              << channel.fec_k_ << " m " << channel.fec_m_ << std::endl;
+                } else {
+                    queue.fec = std::make_unique<FecEncoder>(channel.fec_k_, channel.fec_m_, queue.channel_id);
+                }
+            }
+            queue.bytes_bucket.configure(channel.rate_bytes_per_sec_, channel.burst_bytes_);
+            queue.packets_bucket.configure(channel.rate_packets_per_sec_, channel.burst_packets_);
+            if (queue.priority == PriorityClass::kBulk) {
+                bulk_queues_.push_back(i);
+            } else {
+                latency_queues_.push_back(i);
+            }
+        }
+    }
+
+    bool TxScheduler::enqueue(size_t index, std::vector<uint8_t>& frame, int64_t now_ns) {
+        if (index >= queues_.size()) {
+            return false;
+        }
+        ChannelQueue& queue = queues_[index];
+        ClassStats& stats = stats_of(queue.priority);
+        if (queue.frames.full()) {
+            // 不盖序号, 丢弃的帧不会在接收端造成缺口
+            ++stats.dropped;
+            return false;
+        }
+        if (queue.sequence && structs::PackHelper::stampSeq(frame, queue.channel_id, queue.next_seq, epoch_)) {
+            ++queue.next_seq;
+        }
+        (void)queue.frames.push(frame, now_ns);
+
+        ++stats.enqueued;
+        ++stats.queue_depth;
+        stats.max_queue_depth = std::max(stats.max_queue_depth, stats.queue_depth);
+        return true;
+    }
+
+    int64_t TxScheduler::dispatch(int64_t now_ns) {
+        int64_t next_wait_ns = 0;
+        auto track_wait = [&next_wait_ns](int64_t wait_ns) {
+            if (wait_ns > 0 && (next_wait_ns == 0 || wait_ns < next_wait_ns)) {
+                next_wait_ns = wait_ns;
+            }
+        };
+
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            // 1. 低延迟通道总是优先, 排空后再服务bulk通道
+            for (size_t index : latency_queues_) {
+                ChannelQueue& queue = queues_[index];
+                while (!queue.frames.empty()) {
+                    const int64_t wait_ns = send_one(queue, now_ns);
+                    if (wait_ns != 0) {
+                        track_wait(wait_ns);
+                        break;
+                    }
+                }
+            }
+
+            // 2. 带外重传, 每轮有上限, 不阻塞新数据
+            if (send_retransmits()) {
+                progress = true;
+            }
+
+            // 3. bulk通道每轮只发一个报文, 然后回到低延迟通道
+            for (size_t n = 0; n < bulk_queues_.size(); ++n) {
+                ChannelQueue& queue = queues_[bulk_queues_[bulk_cursor_]];
+                bulk_cursor_ = (bulk_cursor_ + 1U) % bulk_queues_.size();
+                if (queue.frames.empty()) {
+                    continue;
+                }
+                const int64_t wait_ns = send_one(queue, now_ns);
+                if (wait_ns != 0) {
+                    track_wait(wait_ns);
+                    continue;
+                }
+                progress = true;
+                break;
+            }
+        }
+
+        for (auto& queue : queues_) {
+            if (queue.dirty) {
+                queue.sender->commit();
+                common::Tracer::emit(common::TraceStage::kTxCommit, 0);
+                queue.dirty = false;
+            }
+        }
+        return next_wait_ns;
+    }
+
+    int64_t TxScheduler::send_one(ChannelQueue& queue, int64_t now_ns) {
+        if (queue.frames.empty()) {
+            return 0;
+        }
+        ClassStats& stats = stats_of(queue.priority);
+
+        // 计算可合并的帧数, 单帧超过合并长度时单独发送
+        size_t count = 1;
+        size_t bytes = queue.frames.front().data.size();
+        if (queue.priority == PriorityClass::kBulk) {
+            while (count < queue.frames.size()
+                   && bytes + queue.frames[count].data.size() <= queue.coalesce_bytes) {
+                bytes += queue.frames[count].data.size();
+                ++count;
+            }
+        }
+
+        if (!queue.bytes_bucket.can_consume(bytes, now_ns)
+            || !queue.packets_bucket.can_consume(1U, now_ns)) {
+            ++stats.shaped;
+            return std::max<int64_t>(1, std::max(queue.bytes_bucket.wait_ns(bytes, now_ns),
+                                                 queue.packets_bucket.wait_ns(1U, now_ns)));
+        }
+        (void)queue.bytes_bucket.try_consume(bytes, now_ns);
+        (void)queue.packets_bucket.try_consume(1U, now_ns);
+
+        if (count == 1U) {
+            auto& frame = queue.frames.front().data;
+            queue.sender->send_sequenced(frame.data(), static_cast<uint32_t>(frame.size()), false);
+        } else {
+            coalesce_buffer_.clear();
+            for (size_t i = 0; i < count; ++i) {
+                const auto& frame = queue.frames[i].data;
+                coalesce_buffer_.insert(coalesce_buffer_.end(), frame.begin(), frame.end());
+            }
+            queue.sender->send_sequenced(coalesce_buffer_.data(), static_cast<uint32_t>(coalesce_buffer_.size()), false);
+        }
+
+        queue.dirty = true;
+
+        for (size_t i = 0; i < count; ++i) {
+            if (queue.ring != nullptr || queue.fec != nullptr) {
+                const auto& frame = queue.frames.front().data;
+                const auto* seq = structs::PackHelper::seqHeader((const structs::Cmd *)frame.data());
+                if (seq != nullptr && queue.ring != nullptr) {
+                    queue.ring->store(seq->seq, frame.data(), static_cast<uint32_t>(frame.size()));
+                }
+                if (seq != nullptr && queue.fec != nullptr) {
+                    send_parity(queue, seq->seq, frame, now_ns);
+                }
+            }
+            const int64_t delay_ns = now_ns - queue.frames.front().enqueue_ns;
+            stats.total_delay_ns += delay_ns;
+            stats.max_delay_ns = std::max(stats.max_delay_ns, delay_ns);
+            queue.frames.pop_front();
+        }
+        stats.sent_frames += count;
+        stats.sent_datagrams += 1U;
+        stats.sent_bytes += bytes;
+        stats.queue_depth -= count;
+        return 0;
+    }
+
+    void TxScheduler::send_parity(ChannelQueue& queue, uint32_t seq, const std::vector<uint8_t>& frame,
+                                  int64_t now_ns) {
+        const uint32_t ready = queue.fec->on_frame(seq, frame.data(), static_cast<uint32_t>(frame.size()));
+        for (uint32_t j = 0; j < ready; ++j) {
+            const auto& parity = queue.fec->parity(j);
+            // 校验帧紧跟其块发出, 令牌不足时记为欠账
+            queue.bytes_bucket.charge(parity.size(), now_ns);
+            queue.packets_bucket.charge(1U, now_ns);
+            queue.sender->send(parity.data(), static_cast<uint32_t>(parity.size()), false);
+        }
+        stats_of(queue.priority).parity_frames += ready;
+    }
+
+    void TxScheduler::on_nack(const structs::NackHeader& nack) {
+        ++retransmit_stats_.nacks_received;
+        size_t index = queues_.size();
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            if (queues_[i].channel_id == nack.channel_id) {
+                index = i;
+                break;
+            }
+        }
+        for (uint16_t r = 0; r < nack.range_count; ++r) {
+            const structs::NackRange& range = nack.ranges[r];
+            retransmit_stats_.requested += range.count;
+            if (index == queues_.size() || queues_[index].ring == nullptr) {
+                retransmit_stats_.unrecoverable += range.count;
+                continue;
+            }
+            // 计数来自网络, 超过环容量的部分早已被覆盖, 只请求最新的capacity个
+            const uint32_t count = std::min<uint32_t>(range.count, queues_[index].ring->capacity());
+            retransmit_stats_.unrecoverable += range.count - count;
+            const uint32_t first = range.start + (range.count - count);
+            for (uint32_t n = 0; n < count; ++n) {
+                if (retransmits_.size() >= kMaxRetransmitQueue) {
+                    // 队列已满, 本段余下的和之后各段一次计入丢弃
+                    retransmit_stats_.dropped += count - n;
+                    for (uint16_t rest = r + 1U; rest < nack.range_count; ++rest) {
+                        retransmit_stats_.requested += nack.ranges[rest].count;
+                        retransmit_stats_.dropped += nack.ranges[rest].count;
+                    }
+                    return;
+                }
+                retransmits_.push_back(RetransmitRequest{index, first + n});
+            }
+        }
+    }
+
+    bool TxScheduler::send_retransmits() {
+        size_t served = 0;
+        while (!retransmits_.empty() && served < kRetransmitBurst) {
+            const RetransmitRequest request = retransmits_.front();
+            retransmits_.pop_front();
+            ++served;
+
+            ChannelQueue& queue = queues_[request.index];
+            uint32_t size = 0;
+            const uint8_t* frame = queue.ring->find(request.seq, size);
+            if (frame == nullptr) {
+                ++retransmit_stats_.unrecoverable;
+                continue;
+            }
+            // 拷贝后标记为重传帧, 缓存中保留原始帧
+            coalesce_buffer_.assign(frame, frame + size);
+            auto* cmd = (structs::Cmd *)coalesce_buffer_.data();
+            ((structs::SeqHeader *)cmd->data)->flags |= structs::kSeqFlagRetransmit;
+            queue.sender->send_sequenced(coalesce_buffer_.data(), size, false);
+            queue.dirty = true;
+            ++retransmit_stats_.retransmitted;
+        }
+        return served != 0U;
+    }
+
+    size_t TxScheduler::pending() const {
+        size_t total = 0;
+        for (const auto& queue : queues_) {
+            total += queue.frames.size();
+        }
+        return total;
+    }
+
+    size_t TxScheduler::queue_depth(size_t index) const {
+        return (index < queues_.size()) ? queues_[index].frames.size() : 0U;
+    }
+
+    size_t TxScheduler::queue_limit(size_t index) const {
+        return (index < queues_.size()) ? queues_[index].frames.limit() : 0U;
+    }
+
+    const TxScheduler::RetransmitStats& TxScheduler::get_retransmit_stats() const {
+        return retransmit_stats_;
+    }
+
+    const TxScheduler::ClassStats& TxScheduler::get_class_stats(PriorityClass cls) const {
+        return class_stats_[static_cast<size_t>(cls)];
+    }
+} /* namespace classes */
+} /* namespace forward */
@@ -0,0 +1,276 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file tx_scheduler.h
+* @brief strict priority scheduler with per channel token bucket shaping
+* @details Frames are queued per channel. dispatch() always drains the latency class first and
+*  only then serves bulk channels round robin, one datagram per channel per round, so a latency
+*  frame never waits behind more than one bulk datagram. Bulk frames of one channel are coalesced
+*  into a single datagram up to SenderChannel::coalesce_bytes_ (the receiver walks every Cmd in a
+*  datagram). Each channel may be shaped by a bytes/s and a packets/s token bucket.
+*
+*  Channels with retransmit_slots_ keep their recently sent frames in a RetransmitRing. Frames
+*  asked for by a NACK are resent out of band: after the latency class and before bulk data,
+*  at most kRetransmitBurst per round and without consuming tokens, so recovery never queues
+*  behind new data and new data never waits behind a long recovery.
+*
+*  Channels with fec_k_ send fec_m_ parity frames right after every block of fec_k_ frames. Parity
+*  is charged to the token buckets of the channel even when they are empty, the following data
+*  frames wait for the debt, so a shaped channel keeps its configured rate with FEC on.
+*
+*  Each channel queue holds at most SenderChannel::max_queue_frames_ frames, preallocated by
+*  initialize(). A full queue rejects enqueue() and counts the frame as dropped, callers that must
+*  not lose frames check queue_depth() against queue_limit() first and hold them back.
+*
+*  Not thread safe: enqueue() and dispatch() are expected to run on the sending thread.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <deque>
+#include <vector>
+
+#include "token_bucket.h"
+#include "retransmit_ring.h"
+#include "fec_stream.h"
+#include "structs/cmd_def.h"
+#include "xudp_sender.h"
+
+namespace forward{
+namespace classes{
+class TxScheduler {
+public:
+    using PriorityClass = forward::structs::PriorityClass;
+
+    /**
+     * \brief statistic of one priority class.
+     */
+    struct ClassStats {
+        uint64_t enqueued{0};           // 入队帧数
+        uint64_t sent_frames{0};        // 已发送帧数
+        uint64_t sent_datagrams{0};     // 已发送报文数(合并后)
+        uint64_t sent_bytes{0};         // 已发送字节数
+        uint64_t queue_depth{0};        // 当前队列深度(帧)
+        uint64_t max_queue_depth{0};    // 最大队列深度(帧)
+        uint64_t shaped{0};             // 因令牌不足而推迟的次数
+        uint64_t dropped{0};            // 队列满而拒绝入队的帧数
+        uint64_t parity_frames{0};      // 已发送的FEC校验帧数
+        int64_t  total_delay_ns{0};     // 入队到发送的累计时延
+        int64_t  max_delay_ns{0};       // 入队到发送的最大时延
+
+        int64_t average_delay_ns() const {
+            return (sent_frames == 0U) ? 0 : total_delay_ns / static_cast<int64_t>(sent_frames);
+        }
+    };
+
+    /**
+     * \brief statistic of the NACK based retransmission.
+     */
+    struct RetransmitStats {
+        uint64_t nacks_received{0};     // 收到的NACK报文数
+        uint64_t requested{0};          // 请求重传的帧数
+        uint64_t retransmitted{0};      // 已重传的帧数
+        uint64_t unrecoverable{0};      // 已被覆盖或未缓存, 无法重传的帧数
+        uint64_t dropped{0};            // 重传队列满而丢弃的请求数
+    };
+
+    static constexpr size_t kRetransmitBurst = 32;         // 每轮最多重传帧数
+    static constexpr size_t kMaxRetransmitQueue = 4096;    // 待重传请求上限
+
+    TxScheduler() = default;
+    virtual ~TxScheduler() = default;
+
+    TxScheduler(TxScheduler const&) = delete;
+    TxScheduler& operator =(TxScheduler const&) = delete;
+    TxScheduler(TxScheduler&&) = delete;
+    TxScheduler& operator=(TxScheduler&&) = delete;
+
+    /**
+     * \brief bind the scheduler to the senders, one queue and one pair of token buckets per sender.
+     */
+    void initialize(const std::vector<XUdpSender>& senders);
+
+    /**
+     * \brief queue a serialized frame on the sender at index.
+     *
+     * Frames of a channel with SenderChannel::sequence_ set must be built with a SeqHeader, the
+     * next channel sequence number and the epoch of this scheduler are stamped into it here.
+     * The frame is swapped into the queue: frame is left holding the buffer of a frame sent
+     * earlier, so a caller that keeps building into the same vector stops allocating once the
+     * queue has cycled.
+     * \return false if index is out of range or the queue is full, frame is then untouched.
+     */
+    bool enqueue(size_t index, std::vector<uint8_t>& frame, int64_t now_ns);
+
+    /**
+     * \brief send everything the priorities and token buckets allow at now_ns.
+     * \return nanoseconds until the next shaped frame becomes eligible, 0 if every queue is empty.
+     */
+    int64_t dispatch(int64_t now_ns);
+
+    /**
+     * \brief handle a NACK received from a receiver, the frames are resent by the next dispatch().
+     *
+     * A range longer than the RetransmitRing only requests its newest frames, the rest counts as
+     * unrecoverable. Once kMaxRetransmitQueue requests wait, the rest of the NACK counts as dropped.
+     */
+    void on_nack(const structs::NackHeader& nack);
+
+    /**
+     * \brief number of frames waiting in all queues.
+     */
+    size_t pending() const;
+
+    /**
+     * \brief number of frames waiting in the queue of the sender at index, 0 if out of range.
+     */
+    size_t queue_depth(size_t index) const;
+
+    /**
+     * \brief SenderChannel::max_queue_frames_ of the sender at index, 0 if out of range.
+     */
+    size_t queue_limit(size_t index) const;
+
+    const ClassStats& get_class_stats(PriorityClass cls) const;
+
+    const RetransmitStats& get_retransmit_stats() const;
+
+private:
+    struct PendingFrame {
+        std::vector<uint8_t> data;
+        int64_t enqueue_ns{0};
+    };
+
+    /**
+     * \brief bounded FIFO of pending frames on a ring allocated once by reset().
+     *
+     * Every slot owns a buffer of RetransmitRing::kMaxFrameSize bytes from the start and push()
+     * swaps the new frame with it, so the caller gets a buffer back that it can build the next
+     * frame into without allocating, from the first frame on.
+     */
+    class FrameQueue {
+    public:
+        void reset(size_t limit) {
+            size_t slots = 1;
+            while (slots < limit) {
+                slots <<= 1U;
+            }
+            slots_.clear();
+            slots_.resize(slots);
+            for (auto& slot : slots_) {
+                slot.data.reserve(RetransmitRing::kMaxFrameSize);
+            }
+            limit_ = limit;
+            head_ = 0;
+            size_ = 0;
+        }
+
+        bool full() const {
+            return size_ >= limit_;
+        }
+
+        size_t limit() const {
+            return limit_;
+        }
+
+        bool empty() const {
+            return size_ == 0U;
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+        PendingFrame& front() {
+            return slots_[head_];
+        }
+
+        PendingFrame& operator[](size_t i) {
+            return slots_[(head_ + i) & (slots_.size() - 1U)];
+        }
+
+        bool push(std::vector<uint8_t>& data, int64_t enqueue_ns) {
+            if (full()) {
+                return false;
+            }
+            PendingFrame& slot = (*this)[size_];
+            slot.data.swap(data);
+            slot.enqueue_ns = enqueue_ns;
+            ++size_;
+            return true;
+        }
+
+        void pop_front() {
+            head_ = (head_ + 1U) & (slots_.size() - 1U);
+            --size_;
+        }
+
+    private:
+        std::vector<PendingFrame> slots_;       // 容量为2的幂, 不小于limit_
+        size_t limit_{0};
+        size_t head_{0};
+        size_t size_{0};
+    };
+
+    struct ChannelQueue {
+        const XUdpSender* sender{nullptr};
+        PriorityClass priority{PriorityClass::kLatency};
+        uint32_t coalesce_bytes{0};
+        uint16_t channel_id{0};
+        bool sequence{false};
+        uint32_t next_seq{1};
+        TokenBucket bytes_bucket;
+        TokenBucket packets_bucket;
+        FrameQueue frames;
+        bool dirty{false};                      // sent since last commit
+        std::unique_ptr<RetransmitRing> ring;   // nullptr when retransmission is disabled
+        std::unique_ptr<FecEncoder> fec;        // nullptr when FEC is disabled
+    };
+
+    struct RetransmitRequest {
+        size_t index;       // index into queues_
+        uint32_t seq;
+    };
+
+    /**
+     * \brief send one datagram from queue, coalescing when allowed.
+     * \return 0 if a datagram was sent or the queue is empty, otherwise the shaping wait in ns.
+     */
+    int64_t send_one(ChannelQueue& queue, int64_t now_ns);
+
+    /**
+     * \brief feed a sent frame to the FEC encoder and send the parity frames of a completed block.
+     */
+    void send_parity(ChannelQueue& queue, uint32_t seq, const std::vector<uint8_t>& frame, int64_t now_ns);
+
+    /**
+     * \brief resend up to kRetransmitBurst requested frames.
+     * \return true if any request was served.
+     */
+    bool send_retransmits();
+
+    ClassStats& stats_of(PriorityClass cls) {
+        return class_stats_[static_cast<size_t>(cls)];
+    }
+
+    std::vector<ChannelQueue> queues_;
+    std::vector<size_t> latency_queues_;        // index into queues_
+    std::vector<size_t> bulk_queues_;           // index into queues_
+    size_t bulk_cursor_{0};                     // round robin position in bulk_queues_
+    uint16_t epoch_{0};                         // 每次initialize()随机选取, 接收端据此识别重启
+    std::vector<uint8_t> coalesce_buffer_;
+    std::deque<RetransmitRequest> retransmits_;
+    RetransmitStats retransmit_stats_{};
+    std::array<ClassStats, static_cast<size_t>(PriorityClass::kCount)> class_stats_{};
+};
+}
+}
+/** @}*/    // end of group forward
@@ -3,133 +3,103 @@
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <atomic>
+#include <chrono>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 
 #include "xudp.h"
 #include "xudp_receiver.h"
 #include "storager_mgr.h"
+#include "retransmit_ring.h"
 #include "structs/pack_helper.h"
-#include "iguana/iguana.hpp"
+#include "common/tracer.h"
+#include "common/logger.h"
+#include "common/thread_topology.h"
 
 namespace forward {
 namespace classes {
 
-    std::atomic_bool g_loop{true};
-
-    static void handle_recv_msg(char* p, uint32_t size) {
-        auto& mgr = StorageMgr::get_instance();
-        const Cmd *cmd = (const Cmd *)p;
-        if(cmd->no == 1) {
-            StructA struct_a;
-            iguana::from_pb(struct_a, std::string_view(cmd->data, cmd->len - sizeof(Cmd)));
-
-            //printf("total id : %lu\n", struct_a.ns);
-            //printf("total id : %lu\n", struct_a.total_id);
-            //printf("total id : %lu\n", struct_a.data_id);
-
-            struct_a.recv_ns = mgr.get_ns();
-            mgr.get_storager("StructA")->asyncWrite(struct_a);
-        } else if(cmd->no == 2) {
-            StructB struct_b;
-            iguana::from_pb(struct_b, std::string_view(cmd->data, cmd->len - sizeof(Cmd)));
-            struct_b.recv_ns = mgr.get_ns();
-            mgr.get_storager("StructB")->asyncWrite(struct_b);
+    void XUdpReceiver::handle_cmd(const Cmd *cmd, uint32_t len, uint32_t key, const RxMeta& meta, bool in_frame) {
+        if (inline_decode_) {
+            workers_.front()->decode(cmd, meta);
+            return;
         }
+        // 零拷贝批次中的帧直接交给工作线程引用, 否则拷贝
+        std::atomic<uint32_t> *refs = (in_frame && current_batch_->zero_copy) ? &current_batch_->refs : nullptr;
+        (void)workers_[key % workers_.size()]->submit(cmd, len, meta, refs);
     }
 
-    struct connect{
-        xudp *x;
-        xudp_channel *ch;
-        void (*handler)(struct connect *);
-    };
-
-    void handler(struct connect *c)
+    // 一个网卡队列可读时取空其接收环, 每个队列单独调整批大小
+    static void receive_bursts(XUdpReceiver *receiver, xudp_channel *ch, BatchSizer& sizer)
     {
         xudp_msg *m;
-        xudp_channel *ch = c->ch;
-        int n, i, ret;
-
-        xudp_def_msg(hdr, 100);
+        xudp_msghdr *hdr;
+        int n, i;
 
         while (true) {
-            hdr->used = 0;
+            hdr = receiver->begin_batch(sizer.size());
 
             n = xudp_recv_channel(ch, hdr, 0);
-            if (n < 0)
+            if (n < 0) {
+                receiver->end_batch();
                 break;
+            }
+            sizer.on_fill(hdr->used);
+            receiver->publish_batch_size(sizer.size());
 
+            // 一批报文同时从接收环取出, 共用一个用户态时间戳
+            const int64_t rx_ns = StorageMgr::get_instance().get_ns();
+            common::Tracer::emit(common::TraceStage::kRx, 0);
             for (i = 0; i < hdr->used; ++i) {
                 m = hdr->msg + i;
                 //printf("recv msg: %.*s", m->size, m->p);
-                printf("recv msg: %d\n", m->size);
-                handle_recv_msg(m->p, m->size);
+                FORWARD_LOG_EVERY_N(common::LogLevel::kDebug, 1000, "recv msg: %u", m->size);
+                receiver->handle_recv_msg(m, rx_ns);
             }
+            receiver->flush_nacks(ch);
+            receiver->publish_depth();
 
-            xudp_recycle(hdr);
+            receiver->end_batch();
             xudp_commit_channel(ch);
         }
     }
 
-    static int epoll_add(xudp *x, int efd)
-    {
-        struct epoll_event e;
-        struct connect *c;
-        xudp_channel *ch;
-        xudp_group *g;
-        int fd;
-
-        e.events = EPOLLIN;
-
-        g = xudp_group_get(x, 0);
-
-        xudp_group_channel_foreach(ch, g) {
-
-            fd = xudp_channel_get_fd(ch);
-
-            c = (struct connect*)(malloc(sizeof(*c)));
-            c->ch = ch;
-            c->x = x;
-            c->handler = handler;
-
-            e.data.ptr = c;
-
-            epoll_ctl(efd, EPOLL_CTL_ADD, fd, &e);
-        }
-
-        return 0;
+    XUdpReceiver::XUdpReceiver(const structs::ReceiverChannel& channel)
+            : channel_(channel){
     }
 
-    static int loop(int efd)
-    {
-        struct connect *c;
-        struct epoll_event e[1024];
-        int n, i;
-
-        while (g_loop) {
-            n = epoll_wait(efd, e, sizeof(e)/sizeof(e[0]), -1);
-
-            if (n == 0)
-                continue;
-
-            if (n < 0) {
-                //printf("epoll wait error: %s\n", strerror(errno));
-                continue;
-            }
-
-            for (i = 0; i < n; ++i) {
-                c = (struct connect*)(e[i].data.ptr);
-                c->handler(c);
-            }
+    XUdpReceiver::~XUdpReceiver() {
+        // 接收线程此时已退出, 不再使用xudp的环
+        if (x_ != nullptr) {
+            xudp_free(x_);
         }
-        return 0;
     }
 
-    XUdpReceiver::XUdpReceiver(const structs::ReceiverChannel& channel)
-            : channel_(channel){
+    void XUdpReceiver::init_pipeline() {
+        auto& metrics = common::MetricsRegistry::get_instance();
+        const std::string labels = "port=\"" + std::to_string(channel_.port_) + "\"";
+        rx_packets_ = metrics.counter("forward_rx_packets_total", labels);
+        rx_bytes_ = metrics.counter("forward_rx_bytes_total", labels);
+        rx_malformed_ = metrics.counter("forward_rx_malformed_total", labels);
+
+        // 0个工作线程时在接收线程内解码, 仍用一个RxWorker承载解码逻辑和统计
+        inline_decode_ = (channel_.workers_ == 0U);
+        const uint32_t worker_num = inline_decode_ ? 1U : channel_.workers_;
+        for (uint32_t i = 0; i < worker_num; ++i) {
+            workers_.emplace_back(std::make_unique<RxWorker>(i, labels));
+        }
+        // 批次按最大批大小分配, 每次接收只取当前批大小
+        batch_pool_ = std::make_unique<RxBatchPool>(inline_decode_ ? 0U : channel_.rx_hold_batches_,
+                                                    std::max(channel_.rx_batch_max_, channel_.rx_batch_min_), labels);
+        batch_size_ = metrics.gauge("forward_rx_batch_size", labels);
     }
 
     void XUdpReceiver::initialize() {
         int ret, size;
+        init_pipeline();
+
         std::cout << "XUdpReceiver::initialize with ip:" << channel_.str_ip_
             << " port:" << channel_.port_ << std::endl;
         ret = getaddrinfo(channel_.str_ip_.c_str(),
@@ -167,9 +137,29 @@ namespace classes {
             size = sizeof(struct sockaddr_in6);
         }
 
-        ret = xudp_bind(x_, (struct sockaddr *)addr_info_->ai_addr, size, 1);
+        // xudp_bind需要连续存放的同族地址, A/B两路绑定在同一个xudp上, 由同一个接收线程仲裁
+        char addrs[2 * sizeof(struct sockaddr_in6)];
+        int num = 1;
+        memcpy(addrs, addr_info_->ai_addr, size);
+        if (!channel_.backup_ip_.empty()) {
+            ret = getaddrinfo(channel_.backup_ip_.c_str(),
+                              std::to_string(channel_.port_).c_str(), NULL, &backup_addr_info_);
+            if (ret || backup_addr_info_->ai_family != addr_info_->ai_family) {
+                printf("getaddrinfo err for backup ip %s.\n", channel_.backup_ip_.c_str());
+                xudp_free(x_);
+                x_ = nullptr;
+                return;
+            }
+            std::cout << "XUdpReceiver::initialize backup path ip:" << channel_.backup_ip_
+                      << " port:" << channel_.port_ << std::endl;
+            memcpy(addrs + size, backup_addr_info_->ai_addr, size);
+            num = 2;
+        }
+
+        ret = xudp_bind(x_, (struct sockaddr *)addrs, size, num);
         if (ret) {
             xudp_free(x_);
+            x_ = nullptr;
             printf("xudp bind fail %d\n", ret);
             return;
         }
@@ -178,6 +168,7 @@ namespace classes {
     }
 
     void XUdpReceiver::run() {
+        (void)common::ThreadTopology::get_instance().apply("rx", "forward Rx" + std::to_string(channel_.port_));
         for(auto &str : channel_.data_types_) {
             if (StorageMgr::get_instance().get_storager(str) == nullptr) {
                 printf("XUdpReceiver::run cannot find data type %s in StorageMgr.\n",
@@ -191,18 +182,287 @@ namespace classes {
             return;
         }
 
-        int efd = epoll_create(1024);
+        if (!inline_decode_) {
+            for (auto& worker : workers_) {
+                worker->start();
+            }
+        }
 
-        epoll_add(x_, efd);
+        xudp_channel *ping_ch = nullptr;
+        xudp_channel *ch;
+        xudp_group *g = xudp_group_get(x_, 0);
+        xudp_group_channel_foreach(ch, g) {
+            const bool added = reactor_.add_fd(xudp_channel_get_fd(ch), EPOLLIN,
+                    [this, ch, sizer = BatchSizer(channel_.rx_batch_min_, channel_.rx_batch_max_)](uint32_t) mutable {
+                        receive_bursts(this, ch, sizer);
+                    });
+            if (!added) {
+                printf("XUdpReceiver::run cannot watch channel fd: %s\n", strerror(errno));
+            }
+            if (ping_ch == nullptr) {
+                ping_ch = ch;
+            }
+        }
+        // 没有数据时也按对时间隔发送对时请求
+        if (channel_.clock_sync_interval_ms_ != 0U && ping_ch != nullptr) {
+            const std::chrono::milliseconds interval(channel_.clock_sync_interval_ms_);
+            (void)reactor_.add_timer(interval, interval, [this, ping_ch](uint32_t) { send_pings(ping_ch); });
+        }
 
-        loop(efd);
+        // shutdown()经eventfd唤醒, 不必按超时检查退出标志
+        reactor_.run();
+        for (auto& worker : workers_) {
+            worker->stop();
+        }
+        batch_pool_->drain();
         std::cout << "XUdpReceiver::run listen ip:" << channel_.str_ip_
                   << " port:" << channel_.port_ << std::endl;
     }
 
+    // bulk通道会把多个Cmd合并到一个报文中, 依次处理
+    void XUdpReceiver::handle_recv_msg(const xudp_msg *m, int64_t rx_ns) {
+        char *p = m->p;
+        uint32_t size = m->size;
+        // usec为网卡/驱动的收包时间, 驱动不提供时为0
+        RxMeta meta{static_cast<int64_t>(m->usec) * 1000, rx_ns, nullptr};
+        rx_packets_.add();
+        rx_bytes_.add(size);
+        while (size >= sizeof(Cmd)) {
+            const uint32_t len = PackHelper::parseCmd(p, size);
+            if (len < sizeof(Cmd)) {
+                rx_malformed_.add();
+                break;
+            }
+            const Cmd *cmd = (const Cmd *)p;
+            p += len;
+            size -= len;
+
+            const SeqHeader *seq = PackHelper::seqHeader(cmd);
+            if (seq == nullptr) {
+                const FecHeader *fec = PackHelper::fecHeader(cmd);
+                if (fec != nullptr) {
+                    RxStream *stream = find_stream(fec->channel_id);
+                    meta.clock = &stream->clock;
+                    stream->fec.on_parity(*fec, [this, stream, &meta](const Cmd *c, uint32_t l) {
+                        deliver_recovered(stream, c, l, meta);
+                    });
+                    continue;
+                }
+                const ClockProbe *pong = PackHelper::clockProbe(cmd, kCmdPong);
+                if (pong != nullptr) {
+                    find_stream(pong->channel_id)->clock.on_sample(pong->t1, pong->t2, pong->t3,
+                                                                   StorageMgr::get_instance().get_ns());
+                    continue;
+                }
+                meta.clock = nullptr;
+                handle_cmd(cmd, len, PackHelper::cmdNo(cmd), meta, true);
+                continue;
+            }
+
+            RxStream *stream = find_stream(seq->channel_id);
+            if (!stream->has_peer) {
+                stream->peer = m->peer_addr;
+                stream->has_peer = true;
+            }
+            const uint16_t epoch = PackHelper::seqEpoch(seq);
+            if (!stream->has_epoch) {
+                stream->has_epoch = true;
+                stream->epoch = epoch;
+            } else if (epoch != stream->epoch) {
+                if (stream->has_prev_epoch && epoch == stream->prev_epoch && rx_ns < stream->prev_epoch_until_ns) {
+                    stream->dropped.add();
+                    continue;   // 重启之前发出的帧, 如迟到的B路副本或重传
+                }
+                // 超过保留期的旧代号(如A->B->A)也是一次重启
+                restart_stream(stream, epoch, rx_ns);
+            }
+            const bool path_b = (seq->flags & kSeqFlagPathB) != 0U;
+            if ((path_b || stream->arbiter.active())
+                && !stream->arbiter.on_frame(seq->seq, path_b, StorageMgr::get_instance().get_ns())) {
+                stream->dropped.add();
+                continue;   // 另一路已先到
+            }
+            const uint32_t prev_highest = stream->gap.highest();
+            const GapDetector::Result result = stream->gap.on_packet(seq->seq);
+            switch (result) {
+                case GapDetector::Result::kDuplicate:
+                case GapDetector::Result::kLate:
+                    stream->dropped.add();
+                    continue;
+                case GapDetector::Result::kGap:
+                    stream->gap_frames.add(seq->seq - prev_highest - 1U);
+                    if (channel_.nack_) {
+                        stream->nack.on_gap(prev_highest + 1U, seq->seq - prev_highest - 1U, m->peer_addr);
+                        nack_pending_ = true;
+                    }
+                    break;
+                case GapDetector::Result::kOutOfOrder:
+                    if (seq->flags & kSeqFlagRetransmit) {
+                        stream->nack.on_recovered();
+                    }
+                    break;
+                default:
+                    break;
+            }
+            meta.clock = &stream->clock;
+            stream->frames.add();
+            handle_cmd(cmd, len, seq->channel_id, meta, true);
+            stream->fec.on_data(seq->seq, (const uint8_t *)cmd, len, [this, stream, &meta](const Cmd *c, uint32_t l) {
+                deliver_recovered(stream, c, l, meta);
+            });
+        }
+    }
+
+    void XUdpReceiver::restart_stream(RxStream *stream, uint16_t epoch, int64_t now_ns) {
+        FORWARD_LOG(common::LogLevel::kWarn, "XUdpReceiver channel %u restarted, epoch %u -> %u, highest seq was %u",
+                    stream->channel_id, stream->epoch, epoch, stream->gap.highest());
+        stream->has_prev_epoch = true;
+        stream->prev_epoch = stream->epoch;
+        stream->prev_epoch_until_ns = now_ns + kPrevEpochHoldNs;
+        stream->epoch = epoch;
+        stream->gap.reset();
+        stream->arbiter.reset();
+        stream->nack.reset();
+        stream->fec.restart();
+    }
+
+    void XUdpReceiver::deliver_recovered(RxStream *stream, const Cmd *cmd, uint32_t len, const RxMeta& meta) {
+        if (PackHelper::parseCmd((const char *)cmd, len) != len) {
+            return;
+        }
+        const SeqHeader *seq = PackHelper::seqHeader(cmd);
+        if (seq == nullptr || seq->channel_id != stream->channel_id || PackHelper::seqEpoch(seq) != stream->epoch
+            || !stream->gap.is_missing(seq->seq)) {
+            return;
+        }
+        (void)stream->gap.on_packet(seq->seq);
+        handle_cmd(cmd, len, seq->channel_id, meta, false);
+    }
+
+    void XUdpReceiver::flush_nacks(xudp_channel *ch) {
+        if (!nack_pending_) {
+            return;
+        }
+        nack_pending_ = false;
+        uint8_t buf[RetransmitRing::kMaxFrameSize];
+        bool sent = false;
+        for (auto& stream : streams_) {
+            const uint32_t len = stream->nack.build(buf, sizeof(buf), stream->channel_id);
+            if (len == 0U) {
+                continue;
+            }
+            auto *to = (struct sockaddr *)&stream->nack.peer();
+            const int ret = xudp_send_channel(ch, (char *)buf, len, to, 0);
+            if (ret < 0) {
+                FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "XUdpReceiver send nack fail. %d", ret);
+            }
+            sent = true;
+        }
+        if (sent) {
+            xudp_commit_channel(ch);
+        }
+    }
+
+    void XUdpReceiver::send_pings(xudp_channel *ch) {
+        uint8_t buf[sizeof(Cmd) + sizeof(ClockProbe)];
+        bool sent = false;
+        for (auto& stream : streams_) {
+            if (!stream->has_peer) {
+                continue;
+            }
+            ClockProbe probe{};
+            probe.channel_id = stream->channel_id;
+            probe.id = stream->next_ping_id++;
+            probe.t1 = StorageMgr::get_instance().get_ns();
+            const uint32_t len = PackHelper::makeupClockProbe(buf, sizeof(buf), kCmdPing, probe);
+            const int ret = xudp_send_channel(ch, (char *)buf, len, (struct sockaddr *)&stream->peer, 0);
+            if (ret < 0) {
+                FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "XUdpReceiver send ping fail. %d", ret);
+                continue;
+            }
+            sent = true;
+        }
+        if (sent) {
+            xudp_commit_channel(ch);
+        }
+    }
+
+    XUdpReceiver::RxStream* XUdpReceiver::find_stream(uint16_t channel_id) {
+        if (last_stream_ != nullptr && last_stream_->channel_id == channel_id) {
+            return last_stream_;
+        }
+        for (auto& stream : streams_) {
+            if (stream->channel_id == channel_id) {
+                last_stream_ = stream.get();
+                return last_stream_;
+            }
+        }
+        // 新的发送通道, 加锁以便统计线程并发读取
+        const std::lock_guard<std::mutex> lock(streams_mutex_);
+        streams_.emplace_back(std::make_unique<RxStream>());
+        last_stream_ = streams_.back().get();
+        last_stream_->channel_id = channel_id;
+        auto& metrics = common::MetricsRegistry::get_instance();
+        const std::string labels = "port=\"" + std::to_string(channel_.port_) + "\",channel=\""
+                                   + std::to_string(channel_id) + "\"";
+        last_stream_->frames = metrics.counter("forward_rx_frames_total", labels);
+        last_stream_->dropped = metrics.counter("forward_rx_dropped_total", labels);
+        last_stream_->gap_frames = metrics.counter("forward_rx_gap_frames_total", labels);
+        return last_stream_;
+    }
+
+    std::vector<XUdpReceiver::StreamStats> XUdpReceiver::get_stream_stats() const {
+        std::vector<StreamStats> stats;
+        const std::lock_guard<std::mutex> lock(streams_mutex_);
+        for (const auto& stream : streams_) {
+            stats.push_back(StreamStats{stream->channel_id, stream->gap.get_counters(),
+                                        stream->nack.get_counters(), stream->fec.get_counters(),
+                                        stream->arbiter.get_counters(), stream->clock.get_counters()});
+        }
+        return stats;
+    }
+
+    xudp_msghdr* XUdpReceiver::begin_batch(uint32_t size) {
+        current_batch_ = batch_pool_->acquire();
+        current_batch_->hdr.total = std::min(size, batch_pool_->batch_size());
+        return &current_batch_->hdr;
+    }
+
+    void XUdpReceiver::publish_batch_size(uint32_t size) const {
+        batch_size_.set(size);
+    }
+
+    void XUdpReceiver::end_batch() {
+        if (inline_decode_) {
+            workers_.front()->flush();      // 整批报文解码完后一次交给存储
+        }
+        batch_pool_->finish(current_batch_);
+        current_batch_ = nullptr;
+    }
+
+    void XUdpReceiver::publish_depth() const {
+        if (inline_decode_) {
+            return;
+        }
+        for (const auto& worker : workers_) {
+            worker->publish_depth();
+        }
+    }
+
+    LatencyBreakdown::StageStats XUdpReceiver::get_latency(uint32_t stage) const {
+        LatencyBreakdown::StageStats stats;
+        for (const auto& worker : workers_) {
+            stats.merge(worker->get_latency().get(stage));
+        }
+        return stats;
+    }
+
+    const structs::ReceiverChannel& XUdpReceiver::get_channel() const {
+        return channel_;
+    }
+
     void XUdpReceiver::shutdown() {
-        xudp_free(x_);
-        g_loop.store(false);
+        reactor_.stop();
     }
 } /* namespace common */
 } /* namespace forward */
\ No newline at end of file
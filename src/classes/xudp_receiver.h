@@ -14,33 +14,199 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "nlohmann/json.hpp"
 #include "xudp.h"
 #include "structs/receiver_channel.h"
+#include "gap_detector.h"
+#include "nack_tracker.h"
+#include "fec_stream.h"
+#include "line_arbiter.h"
+#include "clock_estimator.h"
+#include "latency_breakdown.h"
+#include "rx_worker.h"
+#include "rx_batch_pool.h"
+#include "batch_sizer.h"
+#include "common/metrics.h"
+#include "common/reactor.h"
 
 namespace forward{
 namespace classes{
     class XUdpReceiver {
     public:
+        // 重启后这么久内旧代号的帧视为迟到丢弃, 之后再出现则当作又一次重启
+        static constexpr int64_t kPrevEpochHoldNs = 1000000000;
+
         explicit XUdpReceiver(const structs::ReceiverChannel& channel);
-        virtual ~XUdpReceiver() = default;
+        virtual ~XUdpReceiver();
 
         /**
          * Read in configuration information and initialize runtime from it.
          */
         void initialize();
 
+        /**
+         * \brief receive loop: a Reactor on this thread watches every xudp channel fd and the
+         *  clock ping timer, it returns once shutdown() was called.
+         */
         void run();
 
+        /**
+         * \brief wake run() and make it return, from any thread.
+         */
         void shutdown();
 
+        /**
+         * \brief handle one received datagram, called by the receive loop.
+         *
+         * Walks every Cmd in the datagram, runs sequenced frames through the A/B line arbiter and
+         * the gap detector of their sender channel and drops duplicates before decoding. When nack
+         * is enabled the gaps are remembered and requested by flush_nacks().
+         * \param rx_ns : time the batch holding m was taken from the rx ring.
+         */
+        void handle_recv_msg(const xudp_msg *m, int64_t rx_ns);
+
+        /**
+         * \brief send the NACKs collected during the current burst back on ch.
+         */
+        void flush_nacks(xudp_channel *ch);
+
+        /**
+         * \brief empty message header for the next xudp_recv_channel() call.
+         * \param size : number of messages to receive at most, see BatchSizer.
+         */
+        xudp_msghdr* begin_batch(uint32_t size);
+
+        /**
+         * \brief the batch of begin_batch() is handled, recycle it now or once the workers are done.
+         */
+        void end_batch();
+
+        /**
+         * \brief export the receive batch size chosen by the BatchSizer of the receive loop.
+         */
+        void publish_batch_size(uint32_t size) const;
+
+        /**
+         * \brief export the queue depth of every worker, called once per received batch.
+         */
+        void publish_depth() const;
+
+        /**
+         * \brief send a clock ping to the sender of every sequenced stream seen so far.
+         *
+         * Called by the receive loop every clock_sync_interval_ms, the pongs are handled by
+         * handle_recv_msg() and feed the ClockEstimator of the stream.
+         */
+        void send_pings(xudp_channel *ch);
+
+        /**
+         * \brief loss counters of one sender channel seen by this receiver.
+         */
+        struct StreamStats {
+            uint16_t channel_id;
+            GapDetector::Counters counters;
+            NackTracker::Counters recovery;
+            FecDecoder::Counters fec;
+            LineArbiter::Counters arbiter;
+            ClockEstimator::Counters clock;
+        };
+
+        /**
+         * \brief snapshot of the loss counters of every sequenced sender channel, thread safe.
+         */
+        std::vector<StreamStats> get_stream_stats() const;
+
+        /**
+         * \brief receive path latency of one stage, summed over the workers of this receiver.
+         */
+        LatencyBreakdown::StageStats get_latency(uint32_t stage) const;
+
+        const structs::ReceiverChannel& get_channel() const;
+
+    protected:
+        /**
+         * \brief metrics, workers and batch pool, the part of initialize() that needs no xudp.
+         *
+         * A subclass that feeds datagrams through begin_batch(), handle_recv_msg() and end_batch()
+         * itself calls only this, run() then refuses to start.
+         */
+        void init_pipeline();
+
     private:
+        /**
+         * \brief hand a data frame to the worker of its stream, or decode it inline without workers.
+         * \param key : sender channel of sequenced frames, else the command number, frames with the
+         *  same key always go to the same worker and keep their order.
+         * \param in_frame : cmd lives in a frame of the current batch, false for frames rebuilt by FEC.
+         */
+        void handle_cmd(const structs::Cmd *cmd, uint32_t len, uint32_t key, const RxMeta& meta, bool in_frame);
+
+        /**
+         * \brief receive state of one sequenced sender channel.
+         */
+        struct RxStream {
+            uint16_t channel_id{0};
+            GapDetector gap;
+            NackTracker nack;
+            FecDecoder fec;
+            LineArbiter arbiter;
+            ClockEstimator clock;
+            struct sockaddr_storage peer{};     // 发送端地址, 对时请求发往此处
+            bool has_peer{false};
+            uint32_t next_ping_id{1};
+            bool has_epoch{false};
+            uint16_t epoch{0};              // 发送端当前的代号, 见kSeqEpochMask
+            bool has_prev_epoch{false};     // 只由restart_stream()置位, kPrevEpochHoldNs后失效
+            uint16_t prev_epoch{0};         // 重启前的代号, 其迟到帧直接丢弃
+            int64_t prev_epoch_until_ns{0};
+
+            common::Counter frames;         // 交给解码的帧
+            common::Counter dropped;        // 重复, 迟到或A/B中后到的帧
+            common::Counter gap_frames;     // 检测到缺失的帧
+        };
+
+        /**
+         * \brief the sender of stream restarted with epoch, forget the state of its old sequence.
+         *
+         * Frames of the old epoch are dropped for kPrevEpochHoldNs after now_ns.
+         */
+        void restart_stream(RxStream *stream, uint16_t epoch, int64_t now_ns);
+
+        /**
+         * \brief account and decode a frame rebuilt by FEC, unless it arrived in the meantime.
+         */
+        void deliver_recovered(RxStream *stream, const structs::Cmd *cmd, uint32_t len, const RxMeta& meta);
+
+        /**
+         * \brief find or create the stream of channel_id, only called on the receive thread.
+         */
+        RxStream* find_stream(uint16_t channel_id);
+
         using ReceiverChannel = forward::structs::ReceiverChannel;
         ReceiverChannel channel_;
         struct addrinfo* addr_info_;
+        struct addrinfo* backup_addr_info_{nullptr};
         bool init_{false};
         xudp *x_{nullptr};
+        common::Reactor reactor_;
+
+        std::vector<std::unique_ptr<RxStream>> streams_;
+        RxStream *last_stream_{nullptr};
+        bool nack_pending_{false};          // some stream has NACK ranges to flush
+        std::vector<std::unique_ptr<RxWorker>> workers_;    // 不配置线程时只有一个, 在接收线程内处理
+        bool inline_decode_{true};
+        std::unique_ptr<RxBatchPool> batch_pool_;
+        RxBatch *current_batch_{nullptr};
+
+        common::Counter rx_packets_;
+        common::Counter rx_bytes_;
+        common::Counter rx_malformed_;      // 无法解析出完整Cmd的报文
+        common::Gauge batch_size_;
+        mutable std::mutex streams_mutex_;  // guards streams_ growth against get_stream_stats()
     };
 }
 }
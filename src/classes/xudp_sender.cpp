@@ -2,11 +2,13 @@
 #include <iostream>
 #include "xudp.h"
 #include "xudp_sender.h"
+#include "structs/pack_helper.h"
+#include "common/logger.h"
 
 namespace forward {
 namespace classes {
-    XUdpSender::XUdpSender(const structs::SenderChannel& channel)
-            : channel_(channel){
+    XUdpSender::XUdpSender(const structs::SenderChannel& channel, DatagramTransport *transport)
+            : channel_(channel), transport_(transport){
     }
 
     void XUdpSender::initialize() {
@@ -19,6 +21,23 @@ namespace classes {
             return;
         }
 
+        if (!channel_.backup_ip_.empty()) {
+            std::cout << "XUdpSender::initialize backup target ip:" << channel_.backup_ip_
+                      << " port:" << channel_.backup_port_ << std::endl;
+            ret = getaddrinfo(channel_.backup_ip_.c_str(),
+                              std::to_string(channel_.backup_port_).c_str(), NULL, &backup_to_);
+            if (ret) {
+                printf("getaddrinfo err ip:%s port:%d\n", channel_.backup_ip_.c_str(), channel_.backup_port_);
+                return;
+            }
+        }
+
+        auto& metrics = common::MetricsRegistry::get_instance();
+        const std::string labels = "channel=\"" + std::to_string(channel_.channel_id_) + "\"";
+        tx_datagrams_ = metrics.counter("forward_tx_datagrams_total", labels);
+        tx_bytes_ = metrics.counter("forward_tx_bytes_total", labels);
+        tx_errors_ = metrics.counter("forward_tx_errors_total", labels);
+
         init_ = true;
     }
 
@@ -26,25 +45,104 @@ namespace classes {
         ch_ = ch;
     }
 
+    void XUdpSender::set_backup_channel(xudp_channel *ch) {
+        backup_ch_ = ch;
+    }
+
     void XUdpSender::send(const std::vector<uint8_t>& data) const {
+        send(data.data(), static_cast<uint32_t>(data.size()));
+    }
+
+    void XUdpSender::send(const uint8_t* data, uint32_t size, bool commit) const {
         if(!init_) {
-            printf("XUdpSender init failed. ip:%s port:%d\n",
-                   channel_.str_ip_.c_str(), channel_.port_);
+            FORWARD_LOG_RATE_LIMITED(common::LogLevel::kError, 1000, "XUdpSender init failed. ip:%s port:%u",
+                                     channel_.str_ip_, channel_.port_);
+            return;
+        }
+        if(!ch_ && transport_ == nullptr) {
+            FORWARD_LOG_RATE_LIMITED(common::LogLevel::kError, 1000, "XUdpSender xudp_channel nullptr. channel id:%u",
+                                     channel_.channel_id_);
+            return;
+        }
+        send_to(ch_, data, size, to_->ai_addr);
+        if (backup_to_ != nullptr) {
+            send_to(path_b_channel(), data, size, backup_to_->ai_addr);
+        }
+        if (commit) {
+            this->commit();
+        }
+    }
+
+    void XUdpSender::send_sequenced(uint8_t* data, uint32_t size, bool commit) const {
+        if (backup_to_ == nullptr || !is_ready()) {
+            send(data, size, commit);
             return;
         }
-        if(!ch_) {
-            printf("XUdpSender xudp_channel nullptr. channel id:%d\n", channel_.channel_id_);
+        send_to(ch_, data, size, to_->ai_addr);
+        mark_path_b(data, size, true);
+        send_to(path_b_channel(), data, size, backup_to_->ai_addr);
+        mark_path_b(data, size, false);
+        if (commit) {
+            this->commit();
+        }
+    }
+
+    void XUdpSender::send_to(xudp_channel *ch, const uint8_t* data, uint32_t size, struct sockaddr* to) const {
+        if (transport_ != nullptr) {
+            if (transport_->send(data, size, to)) {
+                tx_datagrams_.add();
+                tx_bytes_.add(size);
+            } else {
+                tx_errors_.add();
+            }
             return;
         }
-        int ret = xudp_send_channel(ch_, (char*)data.data(), data.size(), to_->ai_addr, 0);
-        if (ret < 0) {
-            printf("xudp_send_one fail. %d\n", ret);
+        int ret = xudp_send_channel(ch, (char*)data, size, to, 0);
+        if (ret >= 0) {
+            tx_datagrams_.add();
+            tx_bytes_.add(size);
+        } else {
+            tx_errors_.add();
+            FORWARD_LOG_RATE_LIMITED(common::LogLevel::kWarn, 1000, "xudp_send_one fail. %d", ret);
+        }
+    }
+
+    void XUdpSender::mark_path_b(uint8_t* data, uint32_t size, bool path_b) {
+        while (size >= sizeof(structs::Cmd)) {
+            const uint32_t len = structs::PackHelper::parseCmd((const char *)data, size);
+            if (len == 0U) {
+                return;
+            }
+            auto *cmd = (structs::Cmd *)data;
+            if (cmd->no & structs::kCmdFlagSeq) {
+                auto *seq = (structs::SeqHeader *)cmd->data;
+                seq->flags = path_b ? (seq->flags | structs::kSeqFlagPathB)
+                                    : (seq->flags & ~structs::kSeqFlagPathB);
+            }
+            data += len;
+            size -= len;
+        }
+    }
+
+    bool XUdpSender::is_dual_path() const {
+        return backup_to_ != nullptr;
+    }
+
+    void XUdpSender::commit() const {
+        if (ch_ != nullptr && transport_ == nullptr) {
+            xudp_commit_channel(ch_);
+            if (backup_ch_ != nullptr && backup_to_ != nullptr) {
+                xudp_commit_channel(backup_ch_);
+            }
         }
-        xudp_commit_channel(ch_);
+    }
+
+    const structs::SenderChannel& XUdpSender::get_channel() const {
+        return channel_;
     }
 
     bool XUdpSender::is_ready() const {
-        if(!ch_ || !init_) {
+        if((!ch_ && transport_ == nullptr) || !init_) {
             return false;
         }
         return true;
@@ -18,12 +18,18 @@
 #include "xudp.h"
 #include "nlohmann/json.hpp"
 #include "structs/sender_channel.h"
+#include "datagram_transport.h"
+#include "common/metrics.h"
 
 namespace forward{
 namespace classes{
 class XUdpSender {
 public:
-    explicit XUdpSender(const structs::SenderChannel& channel);
+    /**
+     * \param transport : takes every datagram instead of the xudp channel, nullptr for xudp. With a
+     *  transport set_channel() is not needed and commit() is a no-op.
+     */
+    explicit XUdpSender(const structs::SenderChannel& channel, DatagramTransport *transport = nullptr);
     virtual ~XUdpSender() = default;
 
     /**
@@ -33,15 +39,61 @@ public:
 
     void set_channel(xudp_channel *ch);
 
+    /**
+     * \brief channel the copies to the backup target leave on, nullptr sends them on the main channel.
+     */
+    void set_backup_channel(xudp_channel *ch);
+
     void send(const std::vector<uint8_t>& data) const;
 
+    /**
+     * \brief send one datagram, to both paths when a backup target is configured.
+     * \param commit : commit the tx ring right away, otherwise the caller calls commit() after a burst.
+     */
+    void send(const uint8_t* data, uint32_t size, bool commit = true) const;
+
+    /**
+     * \brief send a datagram of sequenced frames, to both paths when a backup target is configured.
+     *
+     * The same serialized buffer goes to both paths: before the B copy is sent kSeqFlagPathB is set in
+     * the SeqHeader of every frame, afterwards it is cleared again.
+     */
+    void send_sequenced(uint8_t* data, uint32_t size, bool commit = true) const;
+
+    bool is_dual_path() const;
+
+    /**
+     * \brief kick the tx ring so that datagrams queued by send(..., false) go out.
+     */
+    void commit() const;
+
     bool is_ready() const;
+
+    const structs::SenderChannel& get_channel() const;
 private:
+    void send_to(xudp_channel *ch, const uint8_t* data, uint32_t size, struct sockaddr* to) const;
+
+    xudp_channel *path_b_channel() const {
+        return (backup_ch_ != nullptr) ? backup_ch_ : ch_;
+    }
+
+    /**
+     * \brief set or clear kSeqFlagPathB in every sequenced Cmd of the datagram.
+     */
+    static void mark_path_b(uint8_t* data, uint32_t size, bool path_b);
+
     using SenderChannel = forward::structs::SenderChannel;
     SenderChannel channel_;
     struct addrinfo* to_;
+    struct addrinfo* backup_to_{nullptr};
     xudp_channel *ch_{nullptr};
+    xudp_channel *backup_ch_{nullptr};
+    DatagramTransport *transport_{nullptr};
     bool init_{false};
+
+    common::Counter tx_datagrams_;
+    common::Counter tx_bytes_;
+    common::Counter tx_errors_;
 };
 }
 }
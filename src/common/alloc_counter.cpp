@@ -0,0 +1,131 @@
+#include "common/alloc_counter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <malloc.h>
+#include <unistd.h>
+
+#ifdef FORWARD_ALLOC_COUNT
+// glibc导出的原始实现, 替换malloc后由此转发
+extern "C" {
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *p, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void *p);
+}
+
+namespace {
+    struct ThreadCounts {
+        uint64_t allocs;
+        uint64_t frees;
+        uint64_t bytes;
+    };
+
+    // initial-exec: 访问TLS本身不能再调用malloc
+    __thread ThreadCounts t_counts __attribute__((tls_model("initial-exec")));
+    std::atomic<uint64_t> g_allocs{0};
+    std::atomic<uint64_t> g_frees{0};
+    std::atomic<uint64_t> g_bytes{0};
+
+    inline void on_alloc(size_t bytes) {
+        ++t_counts.allocs;
+        t_counts.bytes += bytes;
+        g_allocs.fetch_add(1U, std::memory_order_relaxed);
+        g_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    inline void on_free(const void *p) {
+        if (p == nullptr) {
+            return;
+        }
+        ++t_counts.frees;
+        g_frees.fetch_add(1U, std::memory_order_relaxed);
+    }
+}
+
+extern "C" {
+    void *malloc(size_t size) noexcept {
+        on_alloc(size);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t n, size_t size) noexcept {
+        on_alloc(n * size);
+        return __libc_calloc(n, size);
+    }
+
+    // 原地扩缩也计为一次分配, 调用方无法预知是否会搬移
+    void *realloc(void *p, size_t size) noexcept {
+        if (size != 0U) {
+            on_alloc(size);
+        }
+        on_free(p);
+        return __libc_realloc(p, size);
+    }
+
+    void free(void *p) noexcept {
+        on_free(p);
+        __libc_free(p);
+    }
+
+    void *memalign(size_t alignment, size_t size) noexcept {
+        on_alloc(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size) noexcept {
+        on_alloc(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void **out, size_t alignment, size_t size) noexcept {
+        if (alignment < sizeof(void *) || (alignment & (alignment - 1U)) != 0U) {
+            return EINVAL;
+        }
+        on_alloc(size);
+        void *p = __libc_memalign(alignment, size);
+        if (p == nullptr) {
+            return ENOMEM;
+        }
+        *out = p;
+        return 0;
+    }
+
+    void *valloc(size_t size) noexcept {
+        on_alloc(size);
+        return __libc_memalign(static_cast<size_t>(sysconf(_SC_PAGESIZE)), size);
+    }
+}
+#endif
+
+namespace forward{
+namespace common{
+    bool AllocCounter::enabled() {
+#ifdef FORWARD_ALLOC_COUNT
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    AllocStats AllocCounter::thread_stats() {
+#ifdef FORWARD_ALLOC_COUNT
+        return AllocStats{t_counts.allocs, t_counts.frees, t_counts.bytes};
+#else
+        return AllocStats{};
+#endif
+    }
+
+    AllocStats AllocCounter::process_stats() {
+#ifdef FORWARD_ALLOC_COUNT
+        return AllocStats{g_allocs.load(std::memory_order_relaxed), g_frees.load(std::memory_order_relaxed),
+                          g_bytes.load(std::memory_order_relaxed)};
+#else
+        return AllocStats{};
+#endif
+    }
+}
+}
@@ -0,0 +1,59 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file alloc_counter.h
+* @brief malloc/free counters per thread, for checking that the hot paths do not allocate
+* @details Built with FORWARD_ALLOC_COUNT (cmake -DFORWARD_ALLOC_COUNT=ON) alloc_counter.cpp
+*  defines malloc, calloc, realloc, free and the aligned variants of the process. Each call
+*  bumps counters of the calling thread and of the process, then goes on to the glibc
+*  implementation through __libc_malloc and friends. operator new ends up in malloc, so
+*  containers, strings and streams are counted too.
+*
+*  The counters of a thread only change on that thread, so a loop that must not allocate takes
+*  thread_stats() before and after and compares. process_stats() also sees the background
+*  threads. bench/alloc_check drives the sender and receiver pipelines through a loopback
+*  transport this way and fails on any allocation per message in steady state.
+*
+*  Without FORWARD_ALLOC_COUNT nothing is interposed, enabled() is false and the stats stay 0.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <cstdint>
+
+namespace forward{
+namespace common{
+    struct AllocStats {
+        uint64_t allocs{0};     // malloc/calloc/realloc/memalign等调用次数
+        uint64_t frees{0};      // free非空指针的次数
+        uint64_t bytes{0};      // 申请的字节数
+
+        AllocStats operator-(const AllocStats& begin) const {
+            return AllocStats{allocs - begin.allocs, frees - begin.frees, bytes - begin.bytes};
+        }
+    };
+
+class AllocCounter {
+public:
+    /**
+     * \return true if built with FORWARD_ALLOC_COUNT and malloc is interposed.
+     */
+    static bool enabled();
+
+    /**
+     * \brief allocations of the calling thread since it started.
+     */
+    static AllocStats thread_stats();
+
+    /**
+     * \brief allocations of all threads since the process started.
+     */
+    static AllocStats process_stats();
+};
+}
+}
+/** @}*/    // end of group forward
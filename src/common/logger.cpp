@@ -0,0 +1,187 @@
+#include "common/logger.h"
+
+#include <iostream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/file_utility.h"
+#include "common/thread_topology.h"
+#include "tools/json_unity.h"
+
+namespace forward{
+namespace common{
+
+    std::atomic<uint8_t> Logger::level_{static_cast<uint8_t>(LogLevel::kInfo)};
+
+    static const char* level_name(LogLevel level) {
+        switch (level) {
+            case LogLevel::kDebug: return "DEBUG";
+            case LogLevel::kInfo: return "INFO";
+            case LogLevel::kWarn: return "WARN";
+            case LogLevel::kError: return "ERROR";
+            default: return "OFF";
+        }
+    }
+
+    static LogLevel parse_level(const std::string& name) {
+        if (name == "debug") {
+            return LogLevel::kDebug;
+        } else if (name == "warn") {
+            return LogLevel::kWarn;
+        } else if (name == "error") {
+            return LogLevel::kError;
+        } else if (name == "off") {
+            return LogLevel::kOff;
+        }
+        return LogLevel::kInfo;
+    }
+
+    Logger::~Logger() {
+        stop();
+    }
+
+    void Logger::start(const nlohmann::json& config, const TimeSync& ts) {
+        std::string level{"info"};
+        std::string path;
+        (void)tool::JsonUnity::get(config, "level", level);
+        (void)tool::JsonUnity::get(config, "path", path);
+        (void)tool::JsonUnity::get(config, "flush_interval_ms", flush_interval_ms_);
+        set_level(parse_level(level));
+
+        const std::lock_guard<std::mutex> lock(run_mutex_);
+        if (running_) {
+            return;
+        }
+        if (!path.empty()) {
+            if (path[0] != '/') {
+                path = FileUtility::get_process_path() + "/" + path;
+            }
+            FILE *file = fopen(path.c_str(), "a");
+            if (file == nullptr) {
+                std::cout << "Logger::start failed to open " << path << ", log to stdout" << std::endl;
+            } else {
+                out_ = file;
+            }
+        }
+        ts_.store(&ts, std::memory_order_release);
+        running_ = true;
+        writer_ = std::thread(&Logger::write_loop, this);
+    }
+
+    void Logger::stop() {
+        {
+            const std::lock_guard<std::mutex> lock(run_mutex_);
+            if (!running_) {
+                return;
+            }
+            running_ = false;
+        }
+        run_cv_.notify_all();
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+        drain();
+        ts_.store(nullptr, std::memory_order_release);   // 之后的日志同步输出
+        fflush(out_);
+        if (out_ != stdout) {
+            fclose(out_);
+            out_ = stdout;
+        }
+    }
+
+    uint64_t Logger::dropped() const {
+        uint64_t total = 0;
+        const std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (const auto& ring : rings_) {
+            total += ring->dropped.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void Logger::submit(const Record& record) {
+        if (ts_.load(std::memory_order_acquire) == nullptr) {
+            // 尚未启动写线程, 同步输出
+            char line[512];
+            const size_t n = format_record(record, static_cast<uint32_t>(syscall(SYS_gettid)), line, sizeof(line));
+            fwrite(line, 1, n, stdout);
+            return;
+        }
+        Ring *ring = local_ring();
+        const uint32_t h = ring->head.load(std::memory_order_relaxed);
+        if (h - ring->tail.load(std::memory_order_acquire) >= kRingSize) {
+            ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+            return;
+        }
+        ring->records[h & (kRingSize - 1U)] = record;
+        ring->head.store(h + 1U, std::memory_order_release);
+    }
+
+    Logger::Ring* Logger::local_ring() {
+        thread_local Ring *ring = nullptr;
+        if (ring == nullptr) {
+            auto one = std::make_unique<Ring>();
+            one->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+            const std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.emplace_back(std::move(one));
+            ring = rings_.back().get();
+        }
+        return ring;
+    }
+
+    void Logger::write_loop() {
+        (void)ThreadTopology::get_instance().apply("logger", "forward Log");
+        std::unique_lock<std::mutex> lock(run_mutex_);
+        while (running_) {
+            run_cv_.wait_for(lock, std::chrono::milliseconds(flush_interval_ms_));
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+
+    // 仅写线程或stop()调用, 每个环只有一个消费者
+    void Logger::drain() {
+        std::vector<Ring*> rings;
+        {
+            const std::lock_guard<std::mutex> lock(rings_mutex_);
+            for (auto& ring : rings_) {
+                rings.push_back(ring.get());
+            }
+        }
+        std::string buffer;
+        char line[512];
+        for (Ring *ring : rings) {
+            uint32_t t = ring->tail.load(std::memory_order_relaxed);
+            const uint32_t h = ring->head.load(std::memory_order_acquire);
+            for (; t != h; ++t) {
+                const size_t n = format_record(ring->records[t & (kRingSize - 1U)], ring->tid, line, sizeof(line));
+                buffer.append(line, n);
+            }
+            ring->tail.store(t, std::memory_order_release);
+        }
+        if (!buffer.empty()) {
+            fwrite(buffer.data(), 1, buffer.size(), out_);
+            fflush(out_);
+        }
+    }
+
+    size_t Logger::format_record(const Record& record, uint32_t tid, char *out, size_t capacity) const {
+        const TimeSync *ts = ts_.load(std::memory_order_acquire);
+        const int64_t ns = (ts != nullptr) ? ts->tsc2ns(record.tsc) : TimeSync::get_sys_ns();
+        const time_t sec = static_cast<time_t>(ns / TimeSync::NsPerSec);
+        struct tm tm_local;
+        localtime_r(&sec, &tm_local);
+        int n = static_cast<int>(strftime(out, capacity, "%Y-%m-%d %H:%M:%S", &tm_local));
+        n += snprintf(out + n, capacity - n, ".%09ld [%s][%u] ",
+                      static_cast<long>(ns % TimeSync::NsPerSec), level_name(record.level), tid);
+        const int body = record.format(out + n, capacity - n - 1, record.fmt, record.args);
+        if (body > 0) {
+            n += (static_cast<size_t>(body) < capacity - n - 1) ? body : static_cast<int>(capacity - n - 2);
+        }
+        if (n > 0 && out[n - 1] != '\n') {
+            out[n++] = '\n';
+        }
+        return static_cast<size_t>(n);
+    }
+}
+}
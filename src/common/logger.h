@@ -0,0 +1,267 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file logger.h
+* @brief asynchronous logger for the hot paths
+* @details The calling thread only copies the format string pointer, a TSC timestamp and the
+*  arguments into a fixed size record of its own lock free ring, the background thread does the
+*  snprintf and the write(2). Strings are copied into the record, so std::string temporaries and
+*  c_str() are safe to pass; fmt must be a string literal. When the ring is full the record is
+*  dropped and counted, the hot thread never blocks.
+*
+*  Sites can be sampled (FORWARD_LOG_EVERY_N) or rate limited (FORWARD_LOG_RATE_LIMITED), so
+*  per packet logging can stay compiled in and enabled in production. Before start() is called the
+*  records are formatted and printed synchronously.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+#include "time_sync.h"
+#include "memory_hardening.h"
+
+namespace forward{
+namespace common{
+enum class LogLevel : uint8_t {
+    kDebug = 0,
+    kInfo,
+    kWarn,
+    kError,
+    kOff,
+};
+
+class Logger {
+public:
+    static constexpr uint32_t kRingSize = 1U << 12;     // 每线程记录数, 2的幂
+    static constexpr uint32_t kArgBytes = 224;          // 每条记录的参数空间
+    static constexpr uint32_t kMaxString = 64;          // 字符串参数截断长度
+
+    /**
+     * \brief a string argument copied into the record.
+     */
+    struct InlineString {
+        char str[kMaxString];
+    };
+
+    static Logger& get_instance() {
+        static Logger instance;
+        return instance;
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /**
+     * \brief read the "log" object of a configuration and start the writer thread.
+     *
+     * Keys: level (debug, info, warn, error, off), path (empty for stdout), flush_interval_ms.
+     * ts converts the TSC timestamps and must outlive the logger.
+     */
+    void start(const nlohmann::json& config, const TimeSync& ts);
+
+    /**
+     * \brief write the pending records and join the writer thread.
+     */
+    void stop();
+
+    static inline bool should_log(LogLevel level) {
+        return static_cast<uint8_t>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    static void set_level(LogLevel level) {
+        level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief cheap monotonic milliseconds for rate limited sites.
+     */
+    static inline int64_t coarse_ms() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &t);
+        return static_cast<int64_t>(t.tv_sec) * 1000 + t.tv_nsec / 1000000;
+    }
+
+    /**
+     * \brief records dropped because a ring was full.
+     */
+    uint64_t dropped() const;
+
+    template <typename... Args>
+    static void log(LogLevel level, const char *fmt, const Args&... args) {
+        static_assert((0 + ... + sizeof(typename Encode<Args>::type)) <= kArgBytes, "too many log arguments");
+        static_assert((true && ... && std::is_trivially_copyable<typename Encode<Args>::type>::value),
+                      "log arguments must be trivially copyable");
+
+        Record record;
+        record.tsc = TimeSync::rdtsc();
+        record.level = level;
+        record.fmt = fmt;
+        record.format = &format_args<typename Encode<Args>::type...>;
+        uint8_t *p = record.args;
+        ((p = put(p, Encode<Args>::encode(args))), ...);
+        (void)p;
+        get_instance().submit(record);
+    }
+
+private:
+    using FormatFn = int (*)(char *out, size_t capacity, const char *fmt, const uint8_t *args);
+
+    struct Record {
+        int64_t tsc;
+        const char *fmt;
+        FormatFn format;
+        LogLevel level;
+        alignas(8) uint8_t args[kArgBytes];
+    };
+
+    struct Ring {
+        alignas(64) std::atomic<uint32_t> head{0};      // 生产者写
+        alignas(64) std::atomic<uint32_t> tail{0};      // 写线程写
+        std::atomic<uint64_t> dropped{0};
+        uint32_t tid{0};
+        std::vector<Record, HugePageAllocator<Record>> records = std::vector<Record, HugePageAllocator<Record>>(kRingSize);
+    };
+
+    // 算术类型和指针原样保存, 字符串复制到记录内
+    template <typename T, typename Enable = void>
+    struct Encode {
+        using type = T;
+        static T encode(const T& v) { return v; }
+    };
+
+    static InlineString copy_string(const char *s, size_t len) {
+        InlineString out;
+        const size_t n = (len < kMaxString - 1U) ? len : kMaxString - 1U;
+        memcpy(out.str, s, n);
+        out.str[n] = '\0';
+        return out;
+    }
+
+    template <typename T>
+    static const T& decode(const T& v) { return v; }
+    static const char* decode(const InlineString& v) { return v.str; }
+
+    template <typename T>
+    static uint8_t* put(uint8_t *p, const T& v) {
+        memcpy(p, &v, sizeof(T));
+        return p + sizeof(T);
+    }
+
+    template <typename T>
+    static T take(const uint8_t *&p) {
+        T v;
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+
+    // 参数按顺序紧密存放, 花括号初始化保证从左到右读取
+    template <typename... Stored>
+    static int format_args(char *out, size_t capacity, const char *fmt, const uint8_t *args) {
+        const std::tuple<Stored...> stored{take<Stored>(args)...};
+        return std::apply([&](const auto&... a) {
+            return snprintf(out, capacity, fmt, decode(a)...);
+        }, stored);
+    }
+
+    Logger() = default;
+    ~Logger();
+
+    void submit(const Record& record);
+    Ring* local_ring();
+    void write_loop();
+    void drain();
+    size_t format_record(const Record& record, uint32_t tid, char *out, size_t capacity) const;
+
+    static std::atomic<uint8_t> level_;
+
+    mutable std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::atomic<const TimeSync*> ts_{nullptr};
+    FILE *out_{stdout};
+    uint32_t flush_interval_ms_{100};
+
+    std::mutex run_mutex_;
+    std::condition_variable run_cv_;
+    bool running_{false};
+    std::thread writer_;
+};
+
+template <>
+struct Logger::Encode<const char *> {
+    using type = InlineString;
+    static InlineString encode(const char *v) { return copy_string(v, strlen(v)); }
+};
+
+template <>
+struct Logger::Encode<char *> {
+    using type = InlineString;
+    static InlineString encode(const char *v) { return copy_string(v, strlen(v)); }
+};
+
+template <size_t N>
+struct Logger::Encode<char[N]> {
+    using type = InlineString;
+    static InlineString encode(const char *v) { return copy_string(v, strnlen(v, N)); }
+};
+
+template <>
+struct Logger::Encode<std::string> {
+    using type = InlineString;
+    static InlineString encode(const std::string& v) { return copy_string(v.data(), v.size()); }
+};
+}
+}
+
+#define FORWARD_LOG(level, fmt, ...)                                                        \
+    do {                                                                                    \
+        if (::forward::common::Logger::should_log(level)) {                                 \
+            ::forward::common::Logger::log(level, fmt, ##__VA_ARGS__);                      \
+        }                                                                                   \
+    } while (0)
+
+// 每个调用点每n次只记录一次, 计数按线程
+#define FORWARD_LOG_EVERY_N(level, n, fmt, ...)                                             \
+    do {                                                                                    \
+        if (::forward::common::Logger::should_log(level)) {                                 \
+            static thread_local uint64_t forward_log_count_ = 0;                            \
+            if (forward_log_count_++ % (n) == 0U) {                                         \
+                ::forward::common::Logger::log(level, fmt, ##__VA_ARGS__);                  \
+            }                                                                               \
+        }                                                                                   \
+    } while (0)
+
+// 每个调用点每interval_ms毫秒最多记录一次
+#define FORWARD_LOG_RATE_LIMITED(level, interval_ms, fmt, ...)                              \
+    do {                                                                                    \
+        if (::forward::common::Logger::should_log(level)) {                                 \
+            static std::atomic<int64_t> forward_log_next_ms_{0};                            \
+            const int64_t forward_log_now_ = ::forward::common::Logger::coarse_ms();        \
+            int64_t forward_log_next_ = forward_log_next_ms_.load(std::memory_order_relaxed); \
+            if (forward_log_now_ >= forward_log_next_                                       \
+                && forward_log_next_ms_.compare_exchange_strong(forward_log_next_,          \
+                                                                forward_log_now_ + (interval_ms))) { \
+                ::forward::common::Logger::log(level, fmt, ##__VA_ARGS__);                  \
+            }                                                                               \
+        }                                                                                   \
+    } while (0)
+
+/** @}*/    // end of group forward
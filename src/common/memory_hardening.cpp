@@ -0,0 +1,130 @@
+#include "common/memory_hardening.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+
+#include "tools/json_unity.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace forward{
+namespace common{
+    static size_t round_up(size_t bytes, size_t unit) {
+        return (bytes + unit - 1U) / unit * unit;
+    }
+
+    // /proc/self/status中的一行, 如 "VmLck:  1024 kB"
+    static std::string proc_status(const std::string& key) {
+        std::ifstream ifs("/proc/self/status");
+        std::string line;
+        while (std::getline(ifs, line)) {
+            if (line.compare(0, key.size(), key) == 0 && line.size() > key.size() && line[key.size()] == ':') {
+                const size_t pos = line.find_first_not_of(" \t", key.size() + 1U);
+                return (pos == std::string::npos) ? "" : line.substr(pos);
+            }
+        }
+        return "n/a";
+    }
+
+    void MemoryHardening::configure(const nlohmann::json& config) {
+        (void)tool::JsonUnity::get(config, "mlockall", mlockall_);
+        (void)tool::JsonUnity::get(config, "hugepages", hugepages_);
+        (void)tool::JsonUnity::get(config, "hugepage_min_bytes", hugepage_min_bytes_);
+        (void)tool::JsonUnity::get(config, "prefault", prefault_);
+    }
+
+    bool MemoryHardening::lock_memory() {
+        if (!mlockall_ || locked_) {
+            return true;
+        }
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            std::cout << "MemoryHardening mlockall failed: " << strerror(errno)
+                      << ", raise RLIMIT_MEMLOCK or grant CAP_IPC_LOCK" << std::endl;
+            return false;
+        }
+        locked_ = true;
+        return true;
+    }
+
+    void* MemoryHardening::allocate(size_t bytes) {
+        const int populate = prefault_ ? MAP_POPULATE : 0;
+        void *p = MAP_FAILED;
+        size_t length = 0;
+        const bool huge = hugepages_ && bytes >= hugepage_min_bytes_;
+        if (huge) {
+            length = round_up(bytes, kHugePageSize);
+            p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT) | populate, -1, 0);
+            if (p != MAP_FAILED) {
+                huge_bytes_.fetch_add(length, std::memory_order_relaxed);
+            } else if (huge_failures_.fetch_add(1U, std::memory_order_relaxed) == 0U) {
+                std::cout << "MemoryHardening no free 2MB hugepage (" << strerror(errno)
+                          << "), falling back to 4KB pages, check /proc/sys/vm/nr_hugepages" << std::endl;
+            }
+        }
+        if (p == MAP_FAILED) {
+            length = round_up(bytes, kPageSize);
+            p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | populate, -1, 0);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            // 不参与THP, 避免khugepaged合并和内存规整带来的停顿
+            (void)madvise(p, length, MADV_NOHUGEPAGE);
+            (huge ? fallback_bytes_ : small_bytes_).fetch_add(length, std::memory_order_relaxed);
+        }
+        if (prefault_) {
+            prefaulted_bytes_.fetch_add(length, std::memory_order_relaxed);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        mappings_[p] = length;
+        return p;
+    }
+
+    bool MemoryHardening::deallocate(void *p) noexcept {
+        size_t length;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = mappings_.find(p);
+            if (it == mappings_.end()) {
+                return false;
+            }
+            length = it->second;
+            mappings_.erase(it);
+        }
+        (void)munmap(p, length);
+        return true;
+    }
+
+    void MemoryHardening::prefault(void *p, size_t bytes) {
+        if (!prefault_ || p == nullptr) {
+            return;
+        }
+        volatile char *c = static_cast<volatile char *>(p);
+        for (size_t i = 0; i < bytes; i += kPageSize) {
+            c[i] = c[i];    // 写回原值, 触发写缺页
+        }
+        prefaulted_bytes_.fetch_add(round_up(bytes, kPageSize), std::memory_order_relaxed);
+    }
+
+    void MemoryHardening::report() const {
+        std::cout << "memory mlockall " << (mlockall_ ? (locked_ ? "locked" : "failed") : "off")
+                  << " hugepages " << (hugepages_ ? "on" : "off")
+                  << " hugepage_min_bytes " << hugepage_min_bytes_
+                  << " prefault " << (prefault_ ? "on" : "off")
+                  << " huge_bytes " << huge_bytes_.load(std::memory_order_relaxed)
+                  << " fallback_bytes " << fallback_bytes_.load(std::memory_order_relaxed)
+                  << " small_bytes " << small_bytes_.load(std::memory_order_relaxed)
+                  << " huge_failures " << huge_failures_.load(std::memory_order_relaxed)
+                  << " prefaulted_bytes " << prefaulted_bytes_.load(std::memory_order_relaxed)
+                  << " VmLck " << proc_status("VmLck")
+                  << " VmRSS " << proc_status("VmRSS")
+                  << " HugetlbPages " << proc_status("HugetlbPages") << std::endl;
+    }
+}
+}
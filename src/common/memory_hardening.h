@@ -0,0 +1,156 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file memory_hardening.h
+* @brief mlockall, explicit 2 MB hugepages and prefaulting of the preallocated hot path memory
+* @details The "memory" object of the runtime config switches each step on:
+*  @code
+*  "memory": {"mlockall": true, "hugepages": true, "hugepage_min_bytes": 1048576, "prefault": true}
+*  @endcode
+*  configure() must run before the receivers, storagers and rings are created. The rings of
+*  SpscRing, Logger, Tracer and RetransmitRing, the xudp message arrays of RxBatchPool and the
+*  storage buffers allocate through HugePageAllocator. With hugepages on, each allocation of at
+*  least hugepage_min_bytes (default 1 MB) is an anonymous MAP_HUGETLB mapping rounded up to
+*  2 MB, which needs pages reserved in /proc/sys/vm/nr_hugepages. Smaller ones would waste most
+*  of a hugepage and take 4 KB pages. If no hugepage is free the allocation falls back to 4 KB
+*  pages as well. 4 KB mappings get MADV_NOHUGEPAGE, so THP compaction never runs on them. The
+*  stats file is hugepage backed when metrics.path lies on a hugetlbfs mount, see MetricsRegistry. With prefault on, the mappings are
+*  created with MAP_POPULATE and mapped files such as the stats page are touched through
+*  prefault(). With everything off, HugePageAllocator is plain operator new.
+*
+*  lock_memory() calls mlockall(MCL_CURRENT | MCL_FUTURE) and is called at the end of the
+*  startup phase. report() prints the locked, huge and fallback bytes next to VmLck and
+*  HugetlbPages of /proc/self/status.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+
+#include "nlohmann/json.hpp"
+
+namespace forward{
+namespace common{
+class MemoryHardening {
+public:
+    static constexpr size_t kHugePageSize = 2U * 1024U * 1024U;
+    static constexpr size_t kPageSize = 4096U;
+
+    static MemoryHardening& get_instance() {
+        static MemoryHardening instance;
+        return instance;
+    }
+
+    MemoryHardening(const MemoryHardening&) = delete;
+    MemoryHardening& operator=(const MemoryHardening&) = delete;
+
+    /**
+     * \brief read the "memory" object, keys mlockall, hugepages and prefault.
+     */
+    void configure(const nlohmann::json& config);
+
+    /**
+     * \brief mlockall(MCL_CURRENT | MCL_FUTURE) if configured.
+     * \return false if it was configured and failed, usually RLIMIT_MEMLOCK.
+     */
+    bool lock_memory();
+
+    /**
+     * \brief memory for a preallocated buffer, hugepages and prefault as configured.
+     */
+    void* allocate(size_t bytes);
+
+    /**
+     * \brief unmap memory from allocate().
+     * \return false if p was not allocated here, e.g. before configure(), free it as usual then.
+     */
+    bool deallocate(void *p) noexcept;
+
+    /**
+     * \brief touch every page of a buffer not allocated here, no-op unless prefault is on.
+     *
+     * Reads and writes back each byte at a page boundary, so only call it while no other thread
+     * writes the buffer.
+     */
+    void prefault(void *p, size_t bytes);
+
+    /**
+     * \brief print the configured steps, the bytes they cover and VmLck / HugetlbPages.
+     */
+    void report() const;
+
+    bool is_enabled() const {
+        return hugepages_ || prefault_;
+    }
+
+    bool hugepages_enabled() const {
+        return hugepages_;
+    }
+
+private:
+    MemoryHardening() = default;
+
+    bool mlockall_{false};
+    bool hugepages_{false};
+    uint32_t hugepage_min_bytes_{kHugePageSize / 2U};  // 小于此值的分配不用大页
+    bool prefault_{false};
+    bool locked_{false};
+
+    std::mutex mutex_;
+    std::map<void*, size_t> mappings_;          // 地址 -> 映射长度
+
+    std::atomic<uint64_t> huge_bytes_{0};       // 大页映射字节数
+    std::atomic<uint64_t> fallback_bytes_{0};   // 大页不足时的普通页字节数
+    std::atomic<uint64_t> small_bytes_{0};      // 低于hugepage_min_bytes的普通页字节数
+    std::atomic<uint64_t> prefaulted_bytes_{0};
+    std::atomic<uint32_t> huge_failures_{0};
+};
+
+/**
+ * \brief std allocator over MemoryHardening::allocate(), for vectors that are sized once.
+ */
+template <typename T>
+struct HugePageAllocator {
+    using value_type = T;
+
+    HugePageAllocator() noexcept = default;
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        auto& memory = MemoryHardening::get_instance();
+        if (!memory.is_enabled()) {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        }
+        return static_cast<T*>(memory.allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t) noexcept {
+        if (!MemoryHardening::get_instance().deallocate(p)) {
+            ::operator delete(p, std::align_val_t(alignof(T)));
+        }
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,137 @@
+#include "common/metrics.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include "common/time_sync.h"
+
+namespace forward{
+namespace common{
+
+    std::atomic<int64_t> Counter::sink_{0};
+    std::atomic<int64_t> Gauge::sink_{0};
+
+    // 与<linux/magic.h>中的HUGETLBFS_MAGIC相同
+    constexpr uint64_t kHugetlbfsMagic = 0x958458f6U;
+
+    MetricsRegistry::~MetricsRegistry() {
+        if (header_ != nullptr) {
+            (void)munmap(header_, mapped_size_);
+        }
+    }
+
+    bool MetricsRegistry::open(const std::string& path, const std::string& process, uint32_t capacity) {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        if (header_ != nullptr) {
+            return true;
+        }
+        size_t size = sizeof(StatsHeader) + sizeof(StatsSlot) * capacity;
+        // 先写临时文件再改名, 读者不会看到未初始化的头
+        const std::string tmp = path + ".tmp";
+        const int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::cout << "MetricsRegistry::open failed to create " << tmp << std::endl;
+            return false;
+        }
+        // hugetlbfs上的文件按大页映射, 长度必须是大页的整数倍, 多出的空间用作槽位
+        struct statfs fs{};
+        const bool hugetlb = fstatfs(fd, &fs) == 0 && static_cast<uint64_t>(fs.f_type) == kHugetlbfsMagic;
+        if (hugetlb) {
+            const size_t page = static_cast<size_t>(fs.f_bsize);
+            size = (size + page - 1U) / page * page;
+            capacity = static_cast<uint32_t>((size - sizeof(StatsHeader)) / sizeof(StatsSlot));
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            std::cout << "MetricsRegistry::open failed to size " << tmp << std::endl;
+            (void)close(fd);
+            return false;
+        }
+        void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        (void)close(fd);
+        if (addr == MAP_FAILED) {
+            std::cout << "MetricsRegistry::open failed to map " << tmp << std::endl;
+            return false;
+        }
+
+        auto *header = static_cast<StatsHeader *>(addr);
+        header->magic = kStatsMagic;
+        header->version = kStatsVersion;
+        header->capacity = capacity;
+        header->used.store(0, std::memory_order_relaxed);
+        header->pid = static_cast<uint32_t>(getpid());
+        header->start_ns = TimeSync::get_sys_ns();
+        strncpy(header->process, process.c_str(), sizeof(header->process) - 1U);
+        if (rename(tmp.c_str(), path.c_str()) != 0) {
+            std::cout << "MetricsRegistry::open failed to rename " << tmp << std::endl;
+            (void)munmap(addr, size);
+            return false;
+        }
+
+        header_ = header;
+        slots_ = reinterpret_cast<StatsSlot *>(static_cast<uint8_t *>(addr) + sizeof(StatsHeader));
+        mapped_size_ = size;
+        hugetlb_ = hugetlb;
+        std::cout << "MetricsRegistry::open " << path << " capacity " << capacity
+                  << (hugetlb ? " on hugetlbfs" : "") << std::endl;
+        return true;
+    }
+
+    Counter MetricsRegistry::counter(const std::string& name, const std::string& labels) {
+        return Counter(add_slot(MetricType::kCounter, name, labels));
+    }
+
+    Gauge MetricsRegistry::gauge(const std::string& name, const std::string& labels) {
+        return Gauge(add_slot(MetricType::kGauge, name, labels));
+    }
+
+    std::atomic<int64_t>* MetricsRegistry::add_slot(MetricType type, const std::string& name,
+                                                    const std::string& labels) {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        if (header_ == nullptr || header_->used.load(std::memory_order_relaxed) >= header_->capacity) {
+            if (header_ != nullptr) {
+                std::cout << "MetricsRegistry stats file full, " << name << " is not exported" << std::endl;
+            }
+            private_values_.emplace_back(0);
+            return &private_values_.back();
+        }
+        const uint32_t index = header_->used.load(std::memory_order_relaxed);
+        StatsSlot& slot = slots_[index];
+        slot.value.store(0, std::memory_order_relaxed);
+        slot.type = static_cast<uint8_t>(type);
+        strncpy(slot.name, name.c_str(), sizeof(slot.name) - 1U);
+        strncpy(slot.labels, labels.c_str(), sizeof(slot.labels) - 1U);
+        header_->used.store(index + 1U, std::memory_order_release);
+        return &slot.value;
+    }
+
+    const StatsHeader* MetricsRegistry::map_readonly(const std::string& path, size_t& size) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(StatsHeader)) {
+            (void)close(fd);
+            return nullptr;
+        }
+        void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        (void)close(fd);
+        if (addr == MAP_FAILED) {
+            return nullptr;
+        }
+        const auto *header = static_cast<const StatsHeader *>(addr);
+        if (header->magic != kStatsMagic || header->version != kStatsVersion
+            || sizeof(StatsHeader) + sizeof(StatsSlot) * header->capacity > static_cast<size_t>(st.st_size)) {
+            (void)munmap(addr, static_cast<size_t>(st.st_size));
+            return nullptr;
+        }
+        size = static_cast<size_t>(st.st_size);
+        return header;
+    }
+}
+}
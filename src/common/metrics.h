@@ -0,0 +1,175 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file metrics.h
+* @brief counters and gauges published in a memory mapped stats file
+* @details The stats file is a StatsHeader followed by an array of cache line aligned StatsSlot.
+*  Every metric owns one slot and has one writer, so an update is a relaxed load and store on a
+*  line no other writer touches, there is no syscall and no locked instruction on the hot path.
+*  Readers such as forward_stat map the same file read only and see the values as they change.
+*
+*  Metrics that are updated from several threads register one slot per thread (e.g. with a thread
+*  label), the reader sums them. Registration is cold, takes a mutex and publishes the slot by
+*  bumping StatsHeader::used with release order. Before open() or when the file can not be mapped
+*  the handles point at private memory, so instrumented code never has to check.
+*
+*  A path on a hugetlbfs mount (e.g. /dev/hugepages/forward_receiver.stats) puts the file on
+*  hugepages: the size is rounded up to the huge page size and the extra room becomes slots.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace forward{
+namespace common{
+    constexpr uint64_t kStatsMagic = 0x5354415453574446ULL;    // "FDWSTATS"
+    constexpr uint32_t kStatsVersion = 1;
+
+    enum class MetricType : uint8_t {
+        kCounter = 0,   // 单调递增
+        kGauge,         // 当前值
+    };
+
+    /**
+     * \brief first bytes of the stats file.
+     */
+    struct alignas(64) StatsHeader {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t capacity;              // 槽位数
+        std::atomic<uint32_t> used;     // 已发布的槽位数
+        uint32_t pid;
+        int64_t start_ns;               // 进程启动时间, 系统时钟
+        char process[32];
+    };
+
+    /**
+     * \brief one metric, name and labels in Prometheus syntax, e.g. name "forward_rx_packets_total"
+     * and labels "channel=\"1\"".
+     */
+    struct alignas(64) StatsSlot {
+        std::atomic<int64_t> value;
+        uint8_t type;                   // MetricType
+        char name[55];
+        char labels[64];
+    };
+
+    static_assert(sizeof(StatsSlot) == 128, "StatsSlot must stay two cache lines");
+
+    /**
+     * \brief handle of a counter, single writer.
+     */
+    class Counter {
+    public:
+        Counter() = default;
+        explicit Counter(std::atomic<int64_t> *value) : value_(value) {}
+
+        inline void add(int64_t n = 1) const {
+            value_->store(value_->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        int64_t value() const {
+            return value_->load(std::memory_order_relaxed);
+        }
+
+    private:
+        static std::atomic<int64_t> sink_;
+        std::atomic<int64_t> *value_{&sink_};
+    };
+
+    /**
+     * \brief handle of a gauge, single writer.
+     */
+    class Gauge {
+    public:
+        Gauge() = default;
+        explicit Gauge(std::atomic<int64_t> *value) : value_(value) {}
+
+        inline void set(int64_t v) const {
+            value_->store(v, std::memory_order_relaxed);
+        }
+
+        inline void set_max(int64_t v) const {
+            if (v > value_->load(std::memory_order_relaxed)) {
+                value_->store(v, std::memory_order_relaxed);
+            }
+        }
+
+        int64_t value() const {
+            return value_->load(std::memory_order_relaxed);
+        }
+
+    private:
+        static std::atomic<int64_t> sink_;
+        std::atomic<int64_t> *value_{&sink_};
+    };
+
+    class MetricsRegistry {
+    public:
+        static constexpr uint32_t kDefaultCapacity = 1024;
+
+        static MetricsRegistry& get_instance() {
+            static MetricsRegistry instance;
+            return instance;
+        }
+
+        MetricsRegistry(const MetricsRegistry&) = delete;
+        MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+        /**
+         * \brief create and map the stats file, must be called before the metrics are registered.
+         * \return false if the file can not be created, metrics then stay process private.
+         */
+        bool open(const std::string& path, const std::string& process, uint32_t capacity = kDefaultCapacity);
+
+        Counter counter(const std::string& name, const std::string& labels = "");
+
+        Gauge gauge(const std::string& name, const std::string& labels = "");
+
+        /**
+         * \brief map an existing stats file read only, used by forward_stat.
+         * \return nullptr on failure, else the header, size is set to the mapped length.
+         */
+        static const StatsHeader* map_readonly(const std::string& path, size_t& size);
+
+        /**
+         * \brief the mapped stats file, nullptr before open(), used to prefault it.
+         */
+        void* get_mapping(size_t& size) {
+            size = mapped_size_;
+            return header_;
+        }
+
+        /**
+         * \brief whether the stats file lies on hugetlbfs, so it is hugepage backed.
+         */
+        bool is_hugetlb() const {
+            return hugetlb_;
+        }
+
+    private:
+        MetricsRegistry() = default;
+        ~MetricsRegistry();
+
+        std::atomic<int64_t>* add_slot(MetricType type, const std::string& name, const std::string& labels);
+
+        std::mutex mutex_;
+        StatsHeader *header_{nullptr};
+        StatsSlot *slots_{nullptr};
+        size_t mapped_size_{0};
+        bool hugetlb_{false};
+        std::deque<std::atomic<int64_t>> private_values_;     // 未映射文件时的存储, deque保证地址不变
+    };
+}
+}
+
+/** @}*/    // end of group forward
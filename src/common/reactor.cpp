@@ -0,0 +1,244 @@
+#include "common/reactor.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <cerrno>
+#include <utility>
+
+#include "common/exception/errno_exception.h"
+
+namespace forward{
+namespace common{
+
+    using namespace forward::common::exception;
+
+    static struct timespec to_timespec(std::chrono::nanoseconds ns) {
+        struct timespec ts{};
+        if (ns.count() > 0) {
+            ts.tv_sec = static_cast<time_t>(ns.count() / 1000000000);
+            ts.tv_nsec = static_cast<long>(ns.count() % 1000000000);
+        }
+        return ts;
+    }
+
+    static bool arm_timer(int32_t fd, std::chrono::nanoseconds first, std::chrono::nanoseconds interval) {
+        struct itimerspec spec{};
+        spec.it_value = to_timespec(first);
+        spec.it_interval = to_timespec(interval);
+        return timerfd_settime(fd, 0, &spec, nullptr) == 0;
+    }
+
+    Reactor::Reactor() {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            throw ErrnoException(errno);
+        }
+        wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        deadline_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (wakeup_fd_ < 0 || deadline_fd_ < 0
+            || !watch(wakeup_fd_, EPOLLIN, Kind::kWakeup, nullptr)
+            || !watch(deadline_fd_, EPOLLIN, Kind::kDeadline, nullptr)) {
+            const int32_t error = errno;
+            close_all();
+            throw ErrnoException(error);
+        }
+    }
+
+    Reactor::~Reactor() noexcept {
+        close_all();
+    }
+
+    void Reactor::close_all() noexcept {
+        // 唤醒和截止时间的fd加入entries_之前也可能已创建
+        if (wakeup_fd_ >= 0) {
+            (void)close(wakeup_fd_);
+        }
+        if (deadline_fd_ >= 0) {
+            (void)close(deadline_fd_);
+        }
+        for (auto& entry : entries_) {
+            if (entry->kind == Kind::kTimer || entry->kind == Kind::kSignal) {
+                (void)close(entry->fd);
+            }
+        }
+        entries_.clear();
+        if (epoll_fd_ >= 0) {
+            (void)close(epoll_fd_);
+        }
+        wakeup_fd_ = -1;
+        deadline_fd_ = -1;
+        epoll_fd_ = -1;
+    }
+
+    bool Reactor::watch(int32_t fd, uint32_t events, Kind kind, Handler handler) {
+        auto entry = std::make_unique<Entry>(Entry{fd, kind, std::move(handler)});
+        struct epoll_event e{};
+        e.events = events;
+        e.data.ptr = entry.get();
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &e) != 0) {
+            return false;
+        }
+        entries_.push_back(std::move(entry));
+        return true;
+    }
+
+    bool Reactor::add_fd(int32_t fd, uint32_t events, Handler handler) {
+        return watch(fd, events, Kind::kFd, std::move(handler));
+    }
+
+    int32_t Reactor::add_timer(std::chrono::nanoseconds first, std::chrono::nanoseconds interval, Handler handler) {
+        const int32_t fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+        if (!arm_timer(fd, first, interval) || !watch(fd, EPOLLIN, Kind::kTimer, std::move(handler))) {
+            (void)close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    bool Reactor::set_timer(int32_t timer, std::chrono::nanoseconds first, std::chrono::nanoseconds interval) {
+        return arm_timer(timer, first, interval);
+    }
+
+    bool Reactor::add_signals(const sigset_t& signals, Handler handler) {
+        const int32_t fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        if (!watch(fd, EPOLLIN, Kind::kSignal, std::move(handler))) {
+            (void)close(fd);
+            return false;
+        }
+        return true;
+    }
+
+    bool Reactor::remove(int32_t fd) {
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            Entry& entry = **it;
+            if (entry.fd != fd || entry.kind == Kind::kWakeup || entry.kind == Kind::kDeadline) {
+                continue;
+            }
+            (void)epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            if (entry.kind != Kind::kFd) {
+                (void)close(fd);
+            }
+            // 同一轮epoll_wait的后续事件可能还指向它
+            entry.fd = -1;
+            retired_.push_back(std::move(*it));
+            (void)entries_.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    bool Reactor::block_signals(const sigset_t& signals) {
+        return pthread_sigmask(SIG_BLOCK, &signals, nullptr) == 0;
+    }
+
+    void Reactor::post(Task task) {
+        {
+            const std::lock_guard<std::mutex> lock(posted_mutex_);
+            posted_.push_back(std::move(task));
+        }
+        wakeup();
+    }
+
+    void Reactor::wakeup() {
+        const uint64_t one = 1;
+        // 计数溢出前必被读走, EAGAIN无需处理
+        (void)!write(wakeup_fd_, &one, sizeof(one));
+    }
+
+    void Reactor::stop() {
+        stop_.store(true, std::memory_order_release);
+        wakeup();
+    }
+
+    void Reactor::run() {
+        while (!stopped()) {
+            (void)run_once(std::chrono::nanoseconds(-1));
+        }
+    }
+
+    int32_t Reactor::run_once(std::chrono::nanoseconds timeout) {
+        int32_t wait_ms = -1;
+        const bool deadline = timeout.count() > 0;
+        if (timeout.count() == 0) {
+            wait_ms = 0;
+        } else if (deadline) {
+            // epoll_wait只有毫秒精度, 由timerfd按纳秒唤醒
+            (void)arm_timer(deadline_fd_, timeout, std::chrono::nanoseconds(0));
+        }
+        struct epoll_event events[kMaxEvents];
+        const int32_t n = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms);
+        if (deadline) {
+            // 被其他事件提前唤醒时截止时间仍在计时, 不解除会在之后的等待中误唤醒
+            (void)arm_timer(deadline_fd_, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0));
+        }
+        if (n <= 0) {
+            return 0;   // 超时或EINTR
+        }
+        for (int32_t i = 0; i < n; ++i) {
+            dispatch(*static_cast<Entry*>(events[i].data.ptr), events[i].events);
+        }
+        retired_.clear();
+        return n;
+    }
+
+    void Reactor::dispatch(Entry& entry, uint32_t events) {
+        if (entry.fd < 0) {
+            return;     // 本轮已被remove()
+        }
+        switch (entry.kind) {
+            case Kind::kFd:
+                entry.handler(events);
+                break;
+            case Kind::kTimer: {
+                uint64_t expirations = 0;
+                if (read(entry.fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                    entry.handler(static_cast<uint32_t>(expirations));
+                }
+                break;
+            }
+            case Kind::kSignal: {
+                struct signalfd_siginfo info{};
+                while (read(entry.fd, &info, sizeof(info)) == sizeof(info)) {
+                    entry.handler(info.ssi_signo);
+                }
+                break;
+            }
+            case Kind::kWakeup: {
+                uint64_t count = 0;
+                (void)!read(entry.fd, &count, sizeof(count));
+                run_posted();
+                break;
+            }
+            case Kind::kDeadline: {
+                uint64_t expirations = 0;
+                (void)!read(entry.fd, &expirations, sizeof(expirations));
+                break;
+            }
+        }
+    }
+
+    void Reactor::run_posted() {
+        {
+            const std::lock_guard<std::mutex> lock(posted_mutex_);
+            if (posted_.empty()) {
+                return;
+            }
+            running_.swap(posted_);
+        }
+        for (auto& task : running_) {
+            task();
+        }
+        running_.clear();
+    }
+}
+}
@@ -0,0 +1,156 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file reactor.h
+* @brief event loop of one thread on a single epoll: fds, cross-thread wakeup, timers and signals
+* @details A Reactor belongs to the thread that calls run() or run_once(). Everything that can wake
+*  the thread is a file descriptor in the same epoll set:
+*  - fds added with add_fd(), e.g. the xudp channels of a receiver,
+*  - an eventfd written by wakeup(), stop() and post(), the only calls safe from other threads,
+*  - timerfds created by add_timer() for periodic or one shot deadlines,
+*  - a signalfd created by add_signals() for signals the caller has blocked in every thread,
+*  - an internal timerfd that bounds run_once() with sub millisecond resolution.
+*
+*  So a thread blocked in epoll_wait() is woken by stop() or post() within microseconds and never
+*  has to poll a flag with a timeout. Tasks handed over by post() run on the reactor thread in the
+*  order they were posted; post() allocates and is meant for control requests, not for messages.
+*
+*  Handlers get one argument: the epoll events for fds, the number of expirations for timers and
+*  the signal number for signals. add_fd(), add_timer(), add_signals() and remove() are called on
+*  the reactor thread, or before it starts running.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace forward{
+namespace common{
+class Reactor {
+public:
+    using Handler = std::function<void(uint32_t)>;
+    using Task = std::function<void()>;
+
+    /**
+     * \brief create the epoll set, the wakeup eventfd and the deadline timerfd.
+     * @throws ErrnoException if one of them cannot be created.
+     */
+    Reactor();
+    ~Reactor() noexcept;
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+    Reactor(Reactor&&) = delete;
+    Reactor& operator=(Reactor&&) = delete;
+
+    /**
+     * \brief watch fd for events (EPOLLIN, ...), the reactor does not take ownership of fd.
+     */
+    bool add_fd(int32_t fd, uint32_t events, Handler handler);
+
+    /**
+     * \brief create a timer that first fires after first and then every interval, 0 for one shot.
+     * \return the timer, an fd owned by the reactor, -1 on failure.
+     */
+    int32_t add_timer(std::chrono::nanoseconds first, std::chrono::nanoseconds interval, Handler handler);
+
+    /**
+     * \brief re-arm a timer of add_timer(), first of 0 disarms it.
+     */
+    bool set_timer(int32_t timer, std::chrono::nanoseconds first, std::chrono::nanoseconds interval);
+
+    /**
+     * \brief receive the signals of signals through a signalfd.
+     *
+     * The signals must already be blocked in every thread, see block_signals(), otherwise their
+     * default action or handler runs instead.
+     */
+    bool add_signals(const sigset_t& signals, Handler handler);
+
+    /**
+     * \brief stop watching fd, timers and signalfds are closed as well.
+     */
+    bool remove(int32_t fd);
+
+    /**
+     * \brief block signals in the calling thread, threads created later inherit the mask.
+     */
+    static bool block_signals(const sigset_t& signals);
+
+    /**
+     * \brief run task on the reactor thread and wake it, from any thread.
+     */
+    void post(Task task);
+
+    /**
+     * \brief wake the reactor thread, from any thread, async signal safe.
+     */
+    void wakeup();
+
+    /**
+     * \brief make run() return and wake it, from any thread, async signal safe.
+     */
+    void stop();
+
+    bool stopped() const {
+        return stop_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief handle events until stop(), returns at once if stop() was called before.
+     */
+    void run();
+
+    /**
+     * \brief wait at most timeout for events and handle them.
+     * \param timeout : negative waits until an event arrives, 0 does not wait.
+     * \return number of events handled, wakeups and the deadline included.
+     */
+    int32_t run_once(std::chrono::nanoseconds timeout);
+
+private:
+    enum class Kind : uint8_t {
+        kFd,
+        kTimer,
+        kSignal,
+        kWakeup,
+        kDeadline,
+    };
+
+    struct Entry {
+        int32_t fd;
+        Kind kind;
+        Handler handler;
+    };
+
+    bool watch(int32_t fd, uint32_t events, Kind kind, Handler handler);
+    void dispatch(Entry& entry, uint32_t events);
+    void run_posted();
+    void close_all() noexcept;
+
+    static constexpr int32_t kMaxEvents = 64;
+
+    int32_t epoll_fd_{-1};
+    int32_t wakeup_fd_{-1};
+    int32_t deadline_fd_{-1};
+    std::atomic<bool> stop_{false};
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::vector<std::unique_ptr<Entry>> retired_;   // 本轮事件处理完之前不能释放
+    std::mutex posted_mutex_;
+    std::vector<Task> posted_;
+    std::vector<Task> running_;                     // 只在reactor线程使用, 与posted_交换
+};
+}
+}
+/** @}*/    // end of group forward
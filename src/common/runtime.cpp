@@ -1,5 +1,5 @@
 #include "common/runtime.h"
-#include <unistd.h>
+#include <pthread.h>
 #include <csignal>
 #include <fstream>
 #include "common/exception/errno_exception.h"
@@ -10,45 +10,40 @@ namespace common{
     std::mutex Runtime::instance_mutex_{};
     std::unique_ptr<Runtime> Runtime::instance_{nullptr};
 
+    static sigset_t termination_signals() {
+        sigset_t signals;
+        (void)sigemptyset(&signals);
+        (void)sigaddset(&signals, SIGTERM);
+        (void)sigaddset(&signals, SIGINT);
+        return signals;
+    }
+
     Runtime::Runtime(){
-        if (-1 == pipe(selfpipe_)) {
+        // 在创建任何线程之前屏蔽, 之后的线程继承屏蔽字, 信号只从signalfd读出
+        const sigset_t signals = termination_signals();
+        if (!Reactor::block_signals(signals)
+            || !reactor_.add_signals(signals, [this](uint32_t signum) { handle_signal(static_cast<int32_t>(signum)); })) {
             throw ErrnoException(errno);
         }
     }
 
     Runtime::~Runtime() noexcept{
         // Stop signal handling
-        (void)signal(SIGTERM, SIG_DFL);
-
-        (void)close(selfpipe_[0]);
-        (void)close(selfpipe_[1]);
+        const sigset_t signals = termination_signals();
+        (void)pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
     }
 
     void Runtime::handle_signal(const int32_t signum) {
-        if (SIGTERM == signum) {
+        if (SIGTERM == signum || SIGINT == signum) {
             //MEGA_LOG_INFO << "Caught SIGTERM!";
             exit_requested_ = true;
-            if (-1 == write(selfpipe_[1], "\0", 1U)) {
-                throw ErrnoException(errno);
-            }
+            reactor_.stop();
         }
     }
 
-    void Runtime::signal_handler(const int32_t signum) {
-        get_instance().handle_signal(signum);
-    }
-
     void Runtime::wait_until_termination() {
         while (!exit_requested_.load()) {
-            int32_t buffer;
-            // Blocking read on selfpipe_
-            const ssize_t bytes_read(read(selfpipe_[0], &buffer, sizeof(int32_t)));
-            if (bytes_read > 0) {
-                // selfpipe_ is only used to signal an exit request.
-                exit_requested_ = true;
-            } else {
-                throw ErrnoException(errno);
-            }
+            (void)reactor_.run_once(std::chrono::nanoseconds(-1));
         }
     }
 
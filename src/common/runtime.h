@@ -19,6 +19,7 @@
 #include <mutex>
 #include <thread>
 #include "nlohmann/json.hpp"
+#include "reactor.h"
 
 namespace forward{
 namespace common{
@@ -73,8 +74,8 @@ public:
     /**
      * \brief Blocks the application until it is explicitly asked to terminate.
      *
-     * The blocking wait is implemented by a blocking wait on a pipe. HandleSignal() catches the SIGTERM signal and
-     * converts it into a token sent via the pipe.
+     * Runs the reactor of the main thread: SIGTERM and SIGINT arrive through its signalfd, and the timers the
+     * runtime registered in run() fire on this thread until then.
      */
     void wait_until_termination();
 
@@ -87,18 +88,11 @@ public:
      */
     static bool load_configuration(const std::string& path_to_config_file, nlohmann::json &config);
 
-    /**
-     * \brief Signal handler to catch signals sent to the process. In order to give the invoker an opportunity to actively exit the program
-     *
-     * This handler delegates to HandleSignal(int32_t).
-     */
-    static void signal_handler(int32_t signum);
-
     /**
      * \brief Signal handler to catch signals sent to the AdaptiveAutosarApplication.
      *
-     * This signal handler only handles SIGTERM, which asks the application to terminate.
-     * It forwards the notification that a SIGTERM occurred using selfpipe.
+     * This signal handler handles SIGTERM and SIGINT, which ask the application to terminate.
+     * It stops the reactor of wait_until_termination(), so it may also be called from other threads.
      */
     void handle_signal(int32_t signum);
 protected:
@@ -116,9 +110,12 @@ protected:
     static std::mutex instance_mutex_;
 
     /**
-     * \brief A pair of pipes used by SignalHandler() to notify WaitSignal() of an incoming signal.
+     * \brief Event loop of the main thread, run by wait_until_termination().
+     *
+     * The constructor blocks SIGTERM and SIGINT before any thread is created, they are read from a signalfd of
+     * this reactor. Runtimes register their periodic work with add_timer() in run().
      */
-    int32_t selfpipe_[2]{};
+    Reactor reactor_;
 
     /**
      * \brief Pointer to the instance of the AdaptiveAutosarApplication.
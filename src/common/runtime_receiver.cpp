@@ -9,6 +9,12 @@
 #include "common/file_utility.h"
 #include "structs/receiver_channel.h"
 #include "classes/storager_mgr.h"
+#include "tools/json_unity.h"
+#include "common/tracer.h"
+#include "common/logger.h"
+#include "common/metrics.h"
+#include "common/thread_topology.h"
+#include "common/memory_hardening.h"
 
 namespace forward{
 namespace common{
@@ -37,13 +43,6 @@ namespace common{
             return;
         }
         instance_ =  std::unique_ptr<RuntimeReceiver>(new RuntimeReceiver(config)); // because creator is protected. Use new to create this object. can't use make_unique
-
-        // Verify whether signal handler was registered successfully. Otherwise, abort
-        // the application with an error.
-        if (SIG_ERR == signal(SIGTERM, &Runtime::signal_handler)) {
-            instance_.reset();
-            throw ::forward::common::exception::ErrnoException(errno);
-        }
     }
 
     RuntimeReceiver& RuntimeReceiver::get_instance(){
@@ -55,35 +54,78 @@ namespace common{
 
     void RuntimeReceiver::initialize(){
         if (!initialized_) {
+            // 先放置主线程, 之后创建的线程各自按角色放置
+            if (config_.contains("threads")) {
+                (void)ThreadTopology::get_instance().load(config_["threads"]);
+            }
+            (void)ThreadTopology::get_instance().apply("main", "forward Main");
+            // 环和缓冲区在之后创建, 按配置使用大页并预缺页
+            if (config_.contains("memory")) {
+                MemoryHardening::get_instance().configure(config_["memory"]);
+            }
+            if (config_.contains("metrics")) {
+                // 必须在创建接收器和存储器之前映射, 它们在构造和初始化时注册指标
+                std::string path{"/dev/shm/forward_receiver.stats"};
+                uint32_t capacity{MetricsRegistry::kDefaultCapacity};
+                (void)tool::JsonUnity::get(config_["metrics"], "path", path);
+                (void)tool::JsonUnity::get(config_["metrics"], "capacity", capacity);
+                (void)MetricsRegistry::get_instance().open(path, "receiver", capacity);
+                size_t stats_size = 0;
+                void *stats = MetricsRegistry::get_instance().get_mapping(stats_size);
+                MemoryHardening::get_instance().prefault(stats, stats_size);
+                if (MemoryHardening::get_instance().hugepages_enabled() && !MetricsRegistry::get_instance().is_hugetlb()) {
+                    std::cout << "metrics path " << path << " is not on hugetlbfs, the stats page uses 4KB pages" << std::endl;
+                }
+            }
             parse_config();
 
             for(auto& one: receivers_) {
-                one.initialize();
+                one->initialize();
             }
 
-            StorageMgr::get_instance().initialize();
+            StorageMgr::get_instance().initialize(config_.contains("time_sync") ? config_["time_sync"]
+                                                                                : nlohmann::json::object());
+            if (config_.contains("log")) {
+                Logger::get_instance().start(config_["log"], StorageMgr::get_instance().get_time_sync());
+            }
+            if (config_.contains("trace")) {
+                Tracer::get_instance().start(config_["trace"], StorageMgr::get_instance().get_time_sync());
+            }
 
-            (void)pthread_setname_np(pthread_self(), "forward Main");
-            (void)signal(SIGTERM, &signal_handler);
+            // 预分配已完成, 锁定当前及以后的全部内存
+            (void)MemoryHardening::get_instance().lock_memory();
+            MemoryHardening::get_instance().report();
             initialized_ = true;
         }
     }
 
     void RuntimeReceiver::run(){
         for(auto& one : receivers_) {
-            threads_.emplace_back(&XUdpReceiver::run, &one);
+            threads_.emplace_back(&XUdpReceiver::run, one.get());
+        }
+
+        if (stats_interval_ms_ != 0U) {
+            // 在主线程的reactor上触发, wait_until_termination()返回后不再报告
+            const std::chrono::milliseconds interval(stats_interval_ms_);
+            stats_timer_ = reactor_.add_timer(interval, interval, [this](uint32_t) { report_stats(); });
         }
     }
 
     void RuntimeReceiver::shutdown(){
+        if (stats_timer_ >= 0) {
+            (void)reactor_.remove(stats_timer_);
+            stats_timer_ = -1;
+        }
         for(auto& one : receivers_) {
-            one.shutdown();
+            one->shutdown();
         }
         for (auto& work_thread : threads_) {
             if (work_thread.joinable()) {
                 work_thread.join();
             }
         }
+        Tracer::get_instance().stop();
+        Logger::get_instance().stop();
     }
 
     std::string RuntimeReceiver::get_forward_version(){
@@ -102,9 +144,77 @@ namespace common{
                 for(auto &str : info.data_types_) {
                     StorageMgr::get_instance().add_storager(str);
                 }
-                receivers_.emplace_back(XUdpReceiver(info));
+                receivers_.emplace_back(std::make_unique<XUdpReceiver>(info));
             }
         }
+
+        (void)tool::JsonUnity::get(config_, "stats_interval_ms", stats_interval_ms_);
+    }
+
+    void RuntimeReceiver::report_stats() {
+        for (const auto& one : receivers_) {
+            for (const auto& stream : one->get_stream_stats()) {
+                const auto& c = stream.counters;
+                std::cout << "receiver " << one->get_channel().str_ip_ << ":" << one->get_channel().port_
+                          << " channel " << stream.channel_id
+                          << " received: " << c.received
+                          << " lost: " << c.lost
+                          << " duplicate: " << c.duplicate
+                          << " out_of_order: " << c.out_of_order
+                          << " late: " << c.late
+                          << " resets: " << c.resets
+                          << " highest_seq: " << c.highest_seq;
+                if (one->get_channel().nack_) {
+                    // 开启重传后, 仍然丢失的帧即为无法恢复的帧
+                    std::cout << " nacks_sent: " << stream.recovery.nacks_sent
+                              << " nack_requested: " << stream.recovery.requested
+                              << " recovered: " << stream.recovery.recovered
+                              << " unrecoverable: " << c.lost;
+                }
+                if (stream.fec.parity_received != 0U) {
+                    std::cout << " fec_parity: " << stream.fec.parity_received
+                              << " fec_recovered: " << stream.fec.recovered
+                              << " fec_blocks_failed: " << stream.fec.blocks_failed;
+                }
+                const auto& a = stream.arbiter;
+                if (a.active) {
+                    // A/B双发: 各路先到的比例, 以及后到一路落后的时间
+                    const int64_t pairs = static_cast<int64_t>(a.pairs);
+                    std::cout << " path_a_wins: " << a.wins[LineArbiter::kPathA]
+                              << " path_b_wins: " << a.wins[LineArbiter::kPathB]
+                              << " path_a_ratio: " << a.win_ratio(LineArbiter::kPathA)
+                              << " pairs: " << a.pairs
+                              << " lag_avg_ns: " << a.average_lag_ns()
+                              << " lag_max_ns: " << a.lag_max_ns
+                              << " b_minus_a_avg_ns: " << ((pairs == 0) ? 0 : a.b_minus_a_sum_ns / pairs);
+                }
+                if (stream.clock.valid) {
+                    std::cout << " clock_offset_ns: " << stream.clock.offset_ns
+                              << " clock_drift_ppb: " << stream.clock.drift_ppb
+                              << " clock_min_rtt_ns: " << stream.clock.min_rtt_ns
+                              << " clock_samples: " << stream.clock.samples;
+                }
+                std::cout << std::endl;
+            }
+            std::cout << "receiver " << one->get_channel().str_ip_ << ":" << one->get_channel().port_
+                      << " latency";
+            for (uint32_t i = 0; i < LatencyBreakdown::kStageCount; ++i) {
+                const auto stage = one->get_latency(i);
+                if (stage.count == 0U) {
+                    continue;
+                }
+                std::cout << " " << LatencyBreakdown::stage_name(i)
+                          << " avg_ns: " << stage.average_ns() << " max_ns: " << stage.max_ns;
+            }
+            std::cout << std::endl;
+        }
+        if (AllocCounter::enabled()) {
+            const AllocStats now = AllocCounter::process_stats();
+            const AllocStats allocs = now - last_allocs_;
+            std::cout << "process allocs: " << allocs.allocs << " frees: " << allocs.frees
+                      << " bytes: " << allocs.bytes << std::endl;
+            last_allocs_ = now;
+        }
     }
 
     void RuntimeReceiver::un_initialize() noexcept {
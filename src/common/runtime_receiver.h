@@ -18,6 +18,7 @@
 #include <queue>
 
 #include "runtime.h"
+#include "alloc_counter.h"
 #include "classes/xudp_receiver.h"
 
 namespace forward{
@@ -88,10 +89,21 @@ protected:
      */
     void parse_config();
 
+    /**
+     * \brief Print the loss counters of every receiver, called periodically by stats_timer_ on the main thread.
+     *
+     * Built with FORWARD_ALLOC_COUNT it also prints the allocations of the process since the
+     * last report, the report itself included.
+     */
+    void report_stats();
+
 private:
     nlohmann::json config_;                     // root json object of configuration
     std::string str_forward_version_{};         // forward version
-    std::vector<classes::XUdpReceiver> receivers_;
+    std::vector<std::unique_ptr<classes::XUdpReceiver>> receivers_;
+    uint32_t stats_interval_ms_{10000};         // interval of the stats report, 0 disables it
+    int32_t stats_timer_{-1};                   // timer of the main reactor, -1 when not running
+    AllocStats last_allocs_{};                  // process allocations at the last stats report
 
     /**
      * \brief The IPC Communication Manager.
@@ -0,0 +1,341 @@
+#include "common/runtime_sender.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <sys/epoll.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <iostream>
+
+#include "common/exception/errno_exception.h"
+#include "common/file_utility.h"
+#include "common/time_sync.h"
+#include "tools/json_unity.h"
+#include "common/tracer.h"
+#include "common/logger.h"
+#include "common/metrics.h"
+#include "common/thread_topology.h"
+#include "common/memory_hardening.h"
+
+namespace forward{
+namespace common{
+
+    using namespace forward::classes;
+
+    RuntimeSender::RuntimeSender(nlohmann::json config)
+            : config_(std::move(config)){   // Must use constructor to create nlohmann::json object. Can not use initial list to create nlohmann::json. Initial list will add [...] automatically around original object
+
+    }
+
+    void RuntimeSender::make_instance(){
+        if (instance_ != nullptr){//double checker
+            return;
+        }
+        const std::unique_lock<std::mutex> instance_lock(instance_mutex_);
+        if (instance_ != nullptr) {// Another thread was quicker, Instance already exists.
+            return;
+        }
+
+        // create a new instance
+        std::string str_current_dir = FileUtility::get_process_path();
+        std::string path_to_config_file{str_current_dir + "/sender_config.json"};
+        nlohmann::json config;     // root of config
+        if (!load_configuration(path_to_config_file, config)){
+            std::cout << "failed to load " << path_to_config_file << std::endl;
+            return;
+        }
+        instance_ =  std::unique_ptr<RuntimeSender>(new RuntimeSender(config)); // because creator is protected. Use new to create this object. can't use make_unique
+    }
+
+    RuntimeSender& RuntimeSender::get_instance(){
+        if (instance_ == nullptr) {
+            RuntimeSender::make_instance();
+        }
+        return *dynamic_cast<RuntimeSender*>(instance_.get());
+    }
+
+    void RuntimeSender::initialize(){
+        if (initialized_) {
+            return;
+        }
+        // 先放置主线程, 之后创建的线程各自按角色放置
+        if (config_.contains("threads")) {
+            (void)ThreadTopology::get_instance().load(config_["threads"]);
+        }
+        (void)ThreadTopology::get_instance().apply("main", "forward Main");
+        // 环和缓冲区在之后创建, 按配置使用大页并预缺页
+        if (config_.contains("memory")) {
+            MemoryHardening::get_instance().configure(config_["memory"]);
+        }
+        if (config_.contains("metrics")) {
+            // 必须在创建发送器之前映射, 它们在构造和初始化时注册指标
+            std::string path{"/dev/shm/forward_sender.stats"};
+            uint32_t capacity{MetricsRegistry::kDefaultCapacity};
+            (void)tool::JsonUnity::get(config_["metrics"], "path", path);
+            (void)tool::JsonUnity::get(config_["metrics"], "capacity", capacity);
+            (void)MetricsRegistry::get_instance().open(path, "sender", capacity);
+            size_t stats_size = 0;
+            void *stats = MetricsRegistry::get_instance().get_mapping(stats_size);
+            MemoryHardening::get_instance().prefault(stats, stats_size);
+            if (MemoryHardening::get_instance().hugepages_enabled() && !MetricsRegistry::get_instance().is_hugetlb()) {
+                std::cout << "metrics path " << path << " is not on hugetlbfs, the stats page uses 4KB pages" << std::endl;
+            }
+        }
+        (void)tool::JsonUnity::get(config_, "producer_queue_size", producer_queue_size_);
+        (void)tool::JsonUnity::get(config_, "drain_timeout_ms", drain_timeout_ms_);
+        (void)tool::JsonUnity::get(config_, "stats_interval_ms", stats_interval_ms_);
+
+        if (!config_.contains("sender_channels")) {
+            std::cout << "RuntimeSender::initialize has no json key: sender_channels" << std::endl;
+            config_["sender_channels"] = nlohmann::json::array();
+        }
+        // SenderMgr引用config_中的对象, config_在其整个生命周期内不变
+        sender_mgr_ = std::make_unique<SenderMgr>(config_["sender_channels"]);
+        sender_mgr_->initialize();
+        if (sender_mgr_->get_senders().empty()) {
+            std::cout << "RuntimeSender::initialize no sender channel configured" << std::endl;
+        }
+        // 本地地址同时接收接收端的反馈(NACK)
+        std::string local_ip{"172.18.0.212"};
+        uint32_t local_port{0};
+        std::string backup_local_ip;
+        (void)tool::JsonUnity::get(config_, "local_ip", local_ip);
+        (void)tool::JsonUnity::get(config_, "local_port", local_port);
+        (void)tool::JsonUnity::get(config_, "backup_local_ip", backup_local_ip);
+        sender_mgr_->set_channel(local_ip, std::to_string(local_port), backup_local_ip);
+
+        // 纳秒生成器进程内唯一, 配置共享页时与本机其他forward进程共用
+        TimeSync& ts = TimeSync::get_instance();
+        ts.init(config_.contains("time_sync") ? config_["time_sync"] : nlohmann::json::object());
+        if (config_.contains("log")) {
+            Logger::get_instance().start(config_["log"], ts);
+        }
+        if (config_.contains("trace")) {
+            Tracer::get_instance().start(config_["trace"], ts);
+        }
+
+        // 预分配已完成, 锁定当前及以后的全部内存
+        (void)MemoryHardening::get_instance().lock_memory();
+        MemoryHardening::get_instance().report();
+        initialized_ = true;
+    }
+
+    void RuntimeSender::run(){
+        if (!initialized_ || running_.exchange(true)) {
+            return;
+        }
+        // 反馈到达时唤醒空闲的发送线程, 由tx_loop中的poll_feedback()读取
+        for (const int32_t feedback_fd : {sender_mgr_->get_feedback_fd(), sender_mgr_->get_backup_feedback_fd()}) {
+            if (feedback_fd >= 0 && !tx_reactor_.add_fd(feedback_fd, EPOLLIN, [](uint32_t) {})) {
+                std::cout << "RuntimeSender::run cannot watch the feedback channel" << std::endl;
+            }
+        }
+        threads_.emplace_back(&RuntimeSender::tx_loop, this);
+
+        if (stats_interval_ms_ != 0U) {
+            // 在主线程的reactor上触发, wait_until_termination()返回后不再报告
+            const std::chrono::milliseconds interval(stats_interval_ms_);
+            stats_timer_ = reactor_.add_timer(interval, interval, [this](uint32_t) { report_stats(); });
+        }
+    }
+
+    void RuntimeSender::shutdown(){
+        {
+            // 先关闭生产者, 发送线程退出前排空的就是全部已接受的帧
+            const std::lock_guard<std::mutex> lock(producer_mutex_);
+            stopping_.store(true);
+            const uint32_t n = producer_count_.load(std::memory_order_relaxed);
+            for (uint32_t i = 0; i < n; ++i) {
+                producers_[i]->close();
+            }
+        }
+        if (stats_timer_ >= 0) {
+            (void)reactor_.remove(stats_timer_);
+            stats_timer_ = -1;
+        }
+        tx_reactor_.stop();
+        for (auto& work_thread : threads_) {
+            if (work_thread.joinable()) {
+                work_thread.join();
+            }
+        }
+        Tracer::get_instance().stop();
+        Logger::get_instance().stop();
+    }
+
+    TxProducer* RuntimeSender::add_producer(const std::string& name) {
+        const std::lock_guard<std::mutex> lock(producer_mutex_);
+        if (!initialized_ || stopping_.load()) {
+            return nullptr;
+        }
+        const uint32_t n = producer_count_.load(std::memory_order_relaxed);
+        if (n == kMaxProducers) {
+            std::cout << "RuntimeSender::add_producer " << name << " failed, " << kMaxProducers
+                      << " producers registered" << std::endl;
+            return nullptr;
+        }
+        producers_[n] = std::make_unique<TxProducer>(name, producer_queue_size_, sender_mgr_->get_senders(),
+                                                     TimeSync::get_instance());
+        // 发布后发送线程才会访问该生产者
+        producer_count_.store(n + 1U, std::memory_order_release);
+        std::cout << "RuntimeSender::add_producer " << name << " queue size " << producer_queue_size_ << std::endl;
+        return producers_[n].get();
+    }
+
+    int32_t RuntimeSender::channel_index(const std::string& data_type) const {
+        if (sender_mgr_ == nullptr) {
+            return -1;
+        }
+        const auto& senders = sender_mgr_->get_senders();
+        for (size_t i = 0; i < senders.size(); ++i) {
+            if (senders[i].get_channel().data_type_ == data_type) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    void RuntimeSender::tx_loop() {
+        (void)ThreadTopology::get_instance().apply("tx", "forward Tx");
+        const TimeSync& ts = TimeSync::get_instance();
+        uint32_t idle = 0;
+        while (!tx_reactor_.stopped()) {
+            const uint32_t moved = drain_producers();
+            const int32_t feedback = sender_mgr_->poll_feedback(ts);
+            const int64_t now_ns = ts.get_ns();
+            const int64_t wait_ns = sender_mgr_->dispatch(now_ns);
+            if (stats_interval_ms_ != 0U && now_ns >= next_snapshot_ns_) {
+                snapshot_stats();
+                next_snapshot_ns_ = now_ns + kStatsSnapshotMs * 1000000;
+            }
+            if (moved != 0U || feedback != 0) {
+                idle = 0;
+                continue;
+            }
+            if (++idle < kSpinRounds) {
+                continue;
+            }
+            // 整形中的帧即将就绪时不等待, 否则最多等到其就绪, 反馈或shutdown()会提前唤醒
+            const int64_t sleep_us = (wait_ns > 0) ? std::min<int64_t>(kIdleSleepUs, wait_ns / 1000) : kIdleSleepUs;
+            if (sleep_us > 0) {
+                (void)tx_reactor_.run_once(std::chrono::microseconds(sleep_us));
+            }
+        }
+        drain();
+    }
+
+    uint32_t RuntimeSender::drain_producers() {
+        const uint32_t count = producer_count_.load(std::memory_order_acquire);
+        const TxScheduler& scheduler = sender_mgr_->get_scheduler();
+        uint32_t moved = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            TxProducer& producer = *producers_[i];
+            uint32_t n = 0;
+            TxProducer::Item *item;
+            while (n < kDrainBatch && (item = producer.peek()) != nullptr) {
+                // 目标通道的调度队列已满时帧留在生产者的环中, 环满后send()拒绝, 压力传回生产者
+                if (scheduler.queue_depth(item->channel) >= scheduler.queue_limit(item->channel)) {
+                    break;
+                }
+                // frame_与已发送帧的缓冲交换, 队列循环一轮后不再分配
+                frame_.assign(item->frame, item->frame + item->len);
+                (void)sender_mgr_->enqueue(item->channel, frame_, item->enqueue_ns);
+                Tracer::emit(TraceStage::kEnqueue, item->trace_id);
+                producer.release();
+                ++n;
+            }
+            producer.publish_depth();
+            moved += n;
+        }
+        return moved;
+    }
+
+    void RuntimeSender::drain() {
+        const TimeSync& ts = TimeSync::get_instance();
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(drain_timeout_ms_);
+        while (true) {
+            const uint32_t moved = drain_producers();
+            // 排空期间仍应答NACK, 接收端可以补齐最后的丢包
+            (void)sender_mgr_->poll_feedback(ts);
+            (void)sender_mgr_->dispatch(ts.get_ns());
+            if (moved == 0U && sender_mgr_->get_scheduler().pending() == 0U) {
+                break;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+            if (moved == 0U) {
+                // 只剩被整形的帧, 等待令牌或反馈
+                (void)tx_reactor_.run_once(std::chrono::microseconds(kIdleSleepUs));
+            }
+        }
+        size_t left = sender_mgr_->get_scheduler().pending();
+        const uint32_t count = producer_count_.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; ++i) {
+            left += producers_[i]->depth();
+        }
+        std::cout << "RuntimeSender::drain done, frames left unsent: " << left << std::endl;
+        snapshot_stats();
+    }
+
+    void RuntimeSender::snapshot_stats() {
+        const TxScheduler& scheduler = sender_mgr_->get_scheduler();
+        const std::lock_guard<std::mutex> lock(stats_mutex_);
+        for (size_t i = 0; i < stats_snapshot_.classes.size(); ++i) {
+            stats_snapshot_.classes[i] = scheduler.get_class_stats(static_cast<PriorityClass>(i));
+        }
+        stats_snapshot_.retransmit = scheduler.get_retransmit_stats();
+    }
+
+    void RuntimeSender::report_stats() {
+        static const char* names[] = {"latency", "bulk"};
+        // 调度器只属于发送线程, 这里只读它复制出的统计
+        SchedulerStats snapshot;
+        {
+            const std::lock_guard<std::mutex> lock(stats_mutex_);
+            snapshot = stats_snapshot_;
+        }
+        for (size_t i = 0; i < snapshot.classes.size(); ++i) {
+            const auto& stats = snapshot.classes[i];
+            std::cout << "class " << names[i]
+                      << " queue_depth: " << stats.queue_depth
+                      << " max_queue_depth: " << stats.max_queue_depth
+                      << " avg_delay: " << stats.average_delay_ns() << " ns"
+                      << " max_delay: " << stats.max_delay_ns << " ns"
+                      << " shaped: " << stats.shaped
+                      << " dropped: " << stats.dropped
+                      << " frames: " << stats.sent_frames
+                      << " datagrams: " << stats.sent_datagrams << std::endl;
+        }
+        const auto& retransmit = snapshot.retransmit;
+        std::cout << "retransmit nacks: " << retransmit.nacks_received
+                  << " requested: " << retransmit.requested
+                  << " retransmitted: " << retransmit.retransmitted
+                  << " unrecoverable: " << retransmit.unrecoverable
+                  << " dropped: " << retransmit.dropped << std::endl;
+        const uint32_t count = producer_count_.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; ++i) {
+            const TxProducer::Stats stats = producers_[i]->get_stats();
+            std::cout << "producer " << producers_[i]->get_name()
+                      << " sent: " << stats.sent
+                      << " rejected: " << stats.rejected
+                      << " queue_depth: " << producers_[i]->depth() << std::endl;
+        }
+        if (AllocCounter::enabled()) {
+            const AllocStats now = AllocCounter::process_stats();
+            const AllocStats allocs = now - last_allocs_;
+            std::cout << "process allocs: " << allocs.allocs << " frees: " << allocs.frees
+                      << " bytes: " << allocs.bytes << std::endl;
+            last_allocs_ = now;
+        }
+    }
+
+    void RuntimeSender::un_initialize() noexcept {
+        if (instance_ != nullptr){
+            auto tmp = instance_.release();
+            delete tmp;
+        }
+    }
+}
+}
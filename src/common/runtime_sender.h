@@ -0,0 +1,174 @@
+/** @defgroup RuntimeSender
+ *  发送端主程序, 负责发送线程及其生命周期
+ */
+/** @addtogroup common
+ * \ingroup forward
+ *  @{ */
+/**
+* @file runtime_sender.h
+* @brief runtime of the sender: owns SenderMgr, the sending thread, the stats timer and the producers
+* @details In-process producers register with add_producer() and queue frames through their
+*  TxProducer from their own threads. The sending thread created by run() drains the producer
+*  rings into SenderMgr, answers feedback (NACK, clock ping) and dispatches, it is the only thread
+*  touching SenderMgr. When there is nothing to send it spins kSpinRounds rounds and then waits on
+*  its Reactor for feedback, for at most kIdleSleepUs or until a shaped frame becomes eligible.
+*
+*  shutdown(), run on SIGTERM after wait_until_termination(), closes the producers, wakes the
+*  sending thread through its reactor, drains what they queued and keeps dispatching until the scheduler queues are empty or drain_timeout_ms
+*  has passed, then joins the thread. Frames still queued at that point are reported.
+*
+*  The scheduler counters belong to the sending thread. It copies them every kStatsSnapshotMs into
+*  a snapshot under a mutex, the periodic report on the main thread prints that copy.
+*
+*  Config, besides the sections shared with the receiver: producer_queue_size (frames per
+*  producer, default 4096), drain_timeout_ms (default 1000) and stats_interval_ms (default 10000,
+*  0 disables the periodic report).
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "runtime.h"
+#include "alloc_counter.h"
+#include "classes/sender_mgr.h"
+#include "classes/tx_producer.h"
+
+namespace forward{
+namespace common{
+class RuntimeSender : public Runtime {
+public:
+    static constexpr uint32_t kMaxProducers = 16;
+    static constexpr uint32_t kDrainBatch = 256;        // 每轮从一个生产者取出的最大帧数
+    static constexpr uint32_t kSpinRounds = 1024;       // 无数据时先自旋再休眠
+    static constexpr int64_t kIdleSleepUs = 50;
+    static constexpr int64_t kStatsSnapshotMs = 100;    // 发送线程复制调度统计的间隔
+
+    ~RuntimeSender() override = default;
+    /**
+     * Delete default copy constructor.
+     * Ensure that objects of this type are not copyable and not movable.
+     */
+    RuntimeSender(const RuntimeSender&) = delete;
+    RuntimeSender& operator =(RuntimeSender const&) = delete;
+    RuntimeSender(RuntimeSender&&) = delete;
+    RuntimeSender& operator=(RuntimeSender&&) = delete;
+
+    /**
+     * \brief Creates the instance from sender_config.json next to the executable and installs the
+     * SIGTERM handler. If instance_ != nullptr, this method does nothing.
+     */
+    static void make_instance();
+
+    /**
+     * \brief Return the Runtime instance.
+     */
+    static RuntimeSender& get_instance();
+
+    /**
+     * Read in configuration information, create the senders and bind the xudp channel.
+     */
+    void initialize() override;
+
+    /**
+     * Destroy the instance of the Runtime.
+     */
+    void un_initialize() noexcept override;
+
+    /**
+     * Start the sending thread and the stats timer.
+     */
+    void run() override;
+
+    /**
+     * Close the producers, drain the queued frames and join the sending thread.
+     */
+    void shutdown() override;
+
+    /**
+     * \brief register a producer, from any thread, before or after run().
+     *
+     * The returned producer belongs to the runtime and stays valid until un_initialize(), it must
+     * only be used by one thread at a time.
+     * \return nullptr if not initialized, shutting down or kMaxProducers are registered.
+     */
+    classes::TxProducer* add_producer(const std::string& name);
+
+    /**
+     * \brief index of the first sender channel carrying data_type, the channel of TxProducer::send().
+     * \return -1 if no channel is configured for data_type.
+     */
+    int32_t channel_index(const std::string& data_type) const;
+
+protected:
+    /**
+     * \brief Constructor of RuntimeSender.
+     *
+     * \param config The config object used by RuntimeSender.
+     */
+    explicit RuntimeSender(nlohmann::json config);
+
+    /**
+     * \brief Body of the sending thread.
+     */
+    void tx_loop();
+
+    /**
+     * \brief move up to kDrainBatch frames of every producer into the scheduler.
+     *
+     * A producer whose next frame targets a channel with a full scheduler queue is skipped, its
+     * frames wait in its ring and TxProducer::send() rejects once the ring is full.
+     * \return number of frames moved.
+     */
+    uint32_t drain_producers();
+
+    /**
+     * \brief after the loop has stopped: flush producers and scheduler within drain_timeout_ms_.
+     */
+    void drain();
+
+    /**
+     * \brief copy the scheduler counters for report_stats(), on the sending thread.
+     */
+    void snapshot_stats();
+
+    /**
+     * \brief Print the scheduler snapshot and the producer counters, called periodically by stats_timer_ on the main thread.
+     */
+    void report_stats();
+
+private:
+    nlohmann::json config_;                     // root json object of configuration
+    std::unique_ptr<classes::SenderMgr> sender_mgr_{nullptr};
+    std::array<std::unique_ptr<classes::TxProducer>, kMaxProducers> producers_{};
+    std::atomic<uint32_t> producer_count_{0};   // 发送线程只读取已发布的生产者
+    std::mutex producer_mutex_;
+    std::atomic<bool> running_{false};
+    Reactor tx_reactor_;                        // 发送线程空闲时在此等待反馈, 由shutdown()唤醒
+    std::atomic<bool> stopping_{false};
+    uint32_t producer_queue_size_{4096};
+    uint32_t drain_timeout_ms_{1000};
+    uint32_t stats_interval_ms_{10000};         // interval of the stats report, 0 disables it
+    int32_t stats_timer_{-1};                   // timer of the main reactor, -1 when not running
+    std::vector<uint8_t> frame_;                // 发送线程的帧缓冲, 与调度队列交换
+    AllocStats last_allocs_{};                  // process allocations at the last stats report
+
+    // 调度统计的副本, 发送线程写, 主线程的报告读
+    struct SchedulerStats {
+        std::array<classes::TxScheduler::ClassStats, static_cast<size_t>(structs::PriorityClass::kCount)> classes{};
+        classes::TxScheduler::RetransmitStats retransmit{};
+    };
+    std::mutex stats_mutex_;
+    SchedulerStats stats_snapshot_{};
+    int64_t next_snapshot_ns_{0};               // 只在发送线程使用
+};
+}
+}
+/** @} */ // end of group forward
@@ -0,0 +1,216 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file slab_pool.h
+* @brief fixed size pool of cache line aligned objects with per thread caches
+* @details All objects live in one slab allocated at construction, through HugePageAllocator
+*  (hugepages and prefault as configured in "memory"). The slab never grows, so the memory of
+*  the pool stays flat under any load. When every object is in use acquire() returns nullptr
+*  and counts the miss, the caller decides what to drop.
+*
+*  Free objects are kept by index in a lock-free stack whose head carries a tag against ABA.
+*  Each thread keeps up to kCacheSize free indexes in a cache of its own, a cache line apart
+*  from the others, and only touches the shared stack to refill or spill half a cache at a
+*  time. release() may run on any thread, not just the one that acquired the object, which is
+*  how a record block goes from the decoding worker to whichever thread flushes the storager.
+*  Indexes cached by a thread that exits stay in its cache, at most kCacheSize per thread.
+*
+*  Objects are constructed once with the slab. acquire() hands one out as the last user left
+*  it, the caller resets what it needs.
+*
+*  get_stats() and the gauges forward_pool_in_use, forward_pool_high_water and
+*  forward_pool_exhausted, labelled pool="<name>", show the objects in use, the highest number
+*  in use at any time and the failed acquires.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/memory_hardening.h"
+#include "common/metrics.h"
+
+namespace forward{
+namespace common{
+    struct PoolStats {
+        uint64_t capacity{0};
+        uint64_t in_use{0};
+        uint64_t high_water{0};     // 同时在用的最大对象数
+        uint64_t exhausted{0};      // acquire失败次数
+    };
+
+    /**
+     * \brief small dense id of the calling thread, shared by all pools.
+     */
+    inline uint32_t pool_thread_slot() {
+        static std::atomic<uint32_t> next{0};
+        thread_local const uint32_t slot = next.fetch_add(1U, std::memory_order_relaxed);
+        return slot;
+    }
+
+template <typename T>
+class SlabPool {
+public:
+    static constexpr uint32_t kMaxThreads = 64;    // 超出的线程直接使用共享栈
+    static constexpr uint32_t kCacheSize = 32;
+
+    /**
+     * \param name : pool label of the metrics.
+     */
+    SlabPool(uint32_t capacity, const std::string& name)
+            : slots_(capacity), next_(new std::atomic<uint32_t>[capacity]),
+              caches_(new ThreadCache[kMaxThreads]) {
+        // 初始全部空闲, 按下标顺序入栈
+        for (uint32_t i = capacity; i > 0U; --i) {
+            push(i - 1U);
+        }
+        auto& metrics = MetricsRegistry::get_instance();
+        const std::string labels = "pool=\"" + name + "\"";
+        metrics.gauge("forward_pool_capacity", labels).set(capacity);
+        in_use_gauge_ = metrics.gauge("forward_pool_in_use", labels);
+        high_water_gauge_ = metrics.gauge("forward_pool_high_water", labels);
+        exhausted_gauge_ = metrics.gauge("forward_pool_exhausted", labels);
+    }
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    /**
+     * \return a free object, nullptr if all capacity() objects are in use.
+     */
+    T* acquire() {
+        ThreadCache *cache = thread_cache();
+        uint32_t index;
+        if (cache == nullptr) {
+            if (!pop(index)) {
+                return on_exhausted();
+            }
+        } else {
+            if (cache->count == 0U) {
+                while (cache->count < kCacheSize / 2U && pop(cache->items[cache->count])) {
+                    ++cache->count;
+                }
+                if (cache->count == 0U) {
+                    return on_exhausted();
+                }
+            }
+            index = cache->items[--cache->count];
+        }
+        const uint64_t in_use = in_use_.fetch_add(1U, std::memory_order_relaxed) + 1U;
+        in_use_gauge_.set(static_cast<int64_t>(in_use));
+        uint64_t high = high_water_.load(std::memory_order_relaxed);
+        while (in_use > high && !high_water_.compare_exchange_weak(high, in_use, std::memory_order_relaxed)) {
+        }
+        if (in_use > high) {
+            high_water_gauge_.set(static_cast<int64_t>(in_use));
+        }
+        return &slots_[index].object;
+    }
+
+    /**
+     * \brief give back an object of this pool, from any thread.
+     */
+    void release(T *object) {
+        const uint32_t index = static_cast<uint32_t>(reinterpret_cast<Slot *>(object) - slots_.data());
+        ThreadCache *cache = thread_cache();
+        if (cache == nullptr) {
+            push(index);
+        } else {
+            if (cache->count == kCacheSize) {
+                while (cache->count > kCacheSize / 2U) {
+                    push(cache->items[--cache->count]);
+                }
+            }
+            cache->items[cache->count++] = index;
+        }
+        const uint64_t in_use = in_use_.fetch_sub(1U, std::memory_order_relaxed) - 1U;
+        in_use_gauge_.set(static_cast<int64_t>(in_use));
+    }
+
+    bool owns(const T *object) const {
+        const auto *slot = reinterpret_cast<const Slot *>(object);
+        return slot >= slots_.data() && slot < slots_.data() + slots_.size();
+    }
+
+    uint32_t capacity() const {
+        return static_cast<uint32_t>(slots_.size());
+    }
+
+    PoolStats get_stats() const {
+        PoolStats stats;
+        stats.capacity = slots_.size();
+        stats.in_use = in_use_.load(std::memory_order_relaxed);
+        stats.high_water = high_water_.load(std::memory_order_relaxed);
+        stats.exhausted = exhausted_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    struct alignas(64) Slot {
+        T object;
+    };
+
+    struct alignas(64) ThreadCache {
+        uint32_t count{0};
+        uint32_t items[kCacheSize];
+    };
+
+    static constexpr uint32_t kEmpty = 0xffffffffU;
+
+    ThreadCache* thread_cache() {
+        const uint32_t slot = pool_thread_slot();
+        return (slot < kMaxThreads) ? &caches_[slot] : nullptr;
+    }
+
+    T* on_exhausted() {
+        const uint64_t n = exhausted_.fetch_add(1U, std::memory_order_relaxed) + 1U;
+        exhausted_gauge_.set(static_cast<int64_t>(n));
+        return nullptr;
+    }
+
+    // 栈顶: 高32位为版本号, 低32位为下标, 每次修改版本号加一
+    void push(uint32_t index) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t desired;
+        do {
+            next_[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            desired = ((head >> 32U) + 1U) << 32U | index;
+        } while (!head_.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    bool pop(uint32_t& index) {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t desired;
+        do {
+            index = static_cast<uint32_t>(head);
+            if (index == kEmpty) {
+                return false;
+            }
+            desired = ((head >> 32U) + 1U) << 32U | next_[index].load(std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(head, desired, std::memory_order_acquire, std::memory_order_acquire));
+        return true;
+    }
+
+    std::vector<Slot, HugePageAllocator<Slot>> slots_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;         // 空闲栈中下一个下标
+    std::unique_ptr<ThreadCache[]> caches_;                 // 按pool_thread_slot()索引
+    alignas(64) std::atomic<uint64_t> head_{kEmpty};
+    alignas(64) std::atomic<uint64_t> in_use_{0};
+    std::atomic<uint64_t> high_water_{0};
+    std::atomic<uint64_t> exhausted_{0};
+
+    Gauge in_use_gauge_;
+    Gauge high_water_gauge_;
+    Gauge exhausted_gauge_;
+};
+}
+}
+/** @}*/    // end of group forward
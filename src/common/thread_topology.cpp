@@ -0,0 +1,235 @@
+#include "common/thread_topology.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "tools/json_unity.h"
+
+namespace forward{
+namespace common{
+    // 与<numaif.h>相同, 避免依赖libnuma
+    constexpr int kMpolPreferred = 1;
+    constexpr int kMpolBind = 2;
+    constexpr uint32_t kMaxNumaNodes = 64;
+
+    static std::string cpus_of_self() {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            return "?";
+        }
+        // 压缩为cpulist格式
+        std::ostringstream oss;
+        int begin = -1;
+        for (int cpu = 0; cpu <= CPU_SETSIZE; ++cpu) {
+            const bool set_bit = (cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &set);
+            if (set_bit && begin < 0) {
+                begin = cpu;
+            } else if (!set_bit && begin >= 0) {
+                if (oss.tellp() > 0) {
+                    oss << ",";
+                }
+                oss << begin;
+                if (cpu - 1 > begin) {
+                    oss << "-" << (cpu - 1);
+                }
+                begin = -1;
+            }
+        }
+        return oss.str();
+    }
+
+    bool ThreadTopology::parse_cpus(const std::string& text, std::vector<uint32_t>& cpus) {
+        cpus.clear();
+        std::istringstream iss(text);
+        std::string range;
+        while (std::getline(iss, range, ',')) {
+            if (range.empty()) {
+                continue;
+            }
+            char *end = nullptr;
+            const unsigned long first = strtoul(range.c_str(), &end, 10);
+            unsigned long last = first;
+            if (end == range.c_str()) {
+                return false;
+            }
+            if (*end == '-') {
+                const char *second = end + 1;
+                last = strtoul(second, &end, 10);
+                if (end == second) {
+                    return false;
+                }
+            }
+            if (*end != '\0' || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            for (unsigned long cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(static_cast<uint32_t>(cpu));
+            }
+        }
+        return !cpus.empty();
+    }
+
+    bool ThreadTopology::load(const nlohmann::json& config) {
+        if (!config.is_object()) {
+            std::cout << "ThreadTopology threads config is not an object" << std::endl;
+            return false;
+        }
+        bool ok = true;
+        std::map<std::string, ThreadRole> roles;
+        for (auto it = config.begin(); it != config.end(); ++it) {
+            const nlohmann::json& item = it.value();
+            ThreadRole role;
+            std::string policy{"other"};
+            uint32_t priority{0};
+            uint32_t numa_node{0};
+            if (tool::JsonUnity::get(item, "cpus", role.cpus_text) && !parse_cpus(role.cpus_text, role.cpus)) {
+                std::cout << "ThreadTopology role " << it.key() << " has bad cpus " << role.cpus_text << std::endl;
+                ok = false;
+                continue;
+            }
+            (void)tool::JsonUnity::get(item, "policy", policy);
+            if (policy != "fifo" && policy != "other") {
+                std::cout << "ThreadTopology role " << it.key() << " has unknown policy " << policy << std::endl;
+                ok = false;
+                continue;
+            }
+            role.fifo = (policy == "fifo");
+            if (role.fifo) {
+                (void)tool::JsonUnity::get(item, "priority", priority);
+                role.priority = static_cast<int32_t>(priority);
+                if (role.priority < sched_get_priority_min(SCHED_FIFO)
+                    || role.priority > sched_get_priority_max(SCHED_FIFO)) {
+                    std::cout << "ThreadTopology role " << it.key() << " has bad fifo priority " << priority << std::endl;
+                    ok = false;
+                    continue;
+                }
+            }
+            if (item.contains("nice") && item["nice"].is_number_integer()) {
+                role.nice = item["nice"].get<int32_t>();
+            }
+            if (tool::JsonUnity::get(item, "numa_node", numa_node)) {
+                if (numa_node >= kMaxNumaNodes) {
+                    std::cout << "ThreadTopology role " << it.key() << " has bad numa_node " << numa_node << std::endl;
+                    ok = false;
+                    continue;
+                }
+                role.numa_node = static_cast<int32_t>(numa_node);
+            }
+            (void)tool::JsonUnity::get(item, "numa_strict", role.numa_strict);
+            roles[it.key()] = role;
+        }
+        // 记录进程启动时的位置, 未配置的角色恢复到它, 而不是继承创建者的
+        ThreadRole inherited;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+            for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    inherited.cpus.push_back(cpu);
+                }
+            }
+        }
+        int policy = SCHED_OTHER;
+        sched_param param{};
+        if (pthread_getschedparam(pthread_self(), &policy, &param) == 0 && policy == SCHED_FIFO) {
+            inherited.fifo = true;
+            inherited.priority = param.sched_priority;
+        }
+        errno = 0;
+        const int nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+        inherited.nice = (errno == 0) ? nice : 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        roles_ = std::move(roles);
+        inherited_ = std::move(inherited);
+        loaded_ = true;
+        return ok;
+    }
+
+    bool ThreadTopology::apply(const std::string& role_name, const std::string& name) {
+        (void)pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+        ThreadRole role;
+        ThreadPlacement placement;
+        placement.name = name;
+        placement.tid = static_cast<int32_t>(syscall(SYS_gettid));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = roles_.find(role_name);
+            if (it == roles_.end()) {
+                it = roles_.find("default");
+            }
+            if (it != roles_.end()) {
+                role = it->second;
+                placement.role = it->first;
+            } else if (loaded_) {
+                role = inherited_;
+                placement.role = "inherited";
+            }
+        }
+
+        std::string error;
+        if (!placement.role.empty()) {
+            if (!role.cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (const uint32_t cpu : role.cpus) {
+                    CPU_SET(cpu, &set);
+                }
+                const int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                if (ret != 0) {
+                    error += std::string("affinity: ") + strerror(ret) + "; ";
+                }
+            }
+            sched_param param{};
+            param.sched_priority = role.fifo ? role.priority : 0;
+            const int ret = pthread_setschedparam(pthread_self(), role.fifo ? SCHED_FIFO : SCHED_OTHER, &param);
+            if (ret != 0) {
+                error += std::string("sched: ") + strerror(ret) + "; ";
+            }
+            if (!role.fifo && setpriority(PRIO_PROCESS, static_cast<id_t>(placement.tid), role.nice) != 0) {
+                error += std::string("nice: ") + strerror(errno) + "; ";
+            }
+            if (role.numa_node >= 0) {
+                // set_mempolicy只作用于调用线程
+                unsigned long mask = 1UL << static_cast<uint32_t>(role.numa_node);
+                if (syscall(SYS_set_mempolicy, role.numa_strict ? kMpolBind : kMpolPreferred, &mask,
+                            kMaxNumaNodes + 1U) != 0) {
+                    error += std::string("numa: ") + strerror(errno) + "; ";
+                }
+            }
+        }
+
+        // 从内核读回实际位置
+        int policy = SCHED_OTHER;
+        sched_param param{};
+        (void)pthread_getschedparam(pthread_self(), &policy, &param);
+        placement.cpus = cpus_of_self();
+        placement.policy = (policy == SCHED_FIFO) ? "fifo" : "other";
+        placement.priority = (policy == SCHED_FIFO) ? param.sched_priority : getpriority(PRIO_PROCESS, placement.tid);
+        placement.numa_node = role.numa_node;
+        placement.error = error;
+        std::cout << "thread " << placement.name << " tid " << placement.tid
+                  << " role " << (placement.role.empty() ? "-" : placement.role)
+                  << " cpus " << placement.cpus << " policy " << placement.policy
+                  << ((policy == SCHED_FIFO) ? " priority " : " nice ") << placement.priority
+                  << " numa_node " << placement.numa_node
+                  << (error.empty() ? "" : " failed: ") << error << std::endl;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        report_.push_back(std::move(placement));
+        return error.empty();
+    }
+
+    std::vector<ThreadPlacement> ThreadTopology::get_report() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return report_;
+    }
+}
+}
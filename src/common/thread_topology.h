@@ -0,0 +1,106 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file thread_topology.h
+* @brief CPU set, scheduling class and NUMA memory node of every thread role
+* @details The "threads" object of the runtime config maps a role to its placement, e.g.
+*  @code
+*  "threads": {
+*    "rx":      {"cpus": "2",   "policy": "fifo", "priority": 50, "numa_node": 0},
+*    "default": {"cpus": "0-1", "policy": "other", "nice": 0}
+*  }
+*  @endcode
+*  Every thread the project creates calls apply() with its role first thing: rx, rx_worker, tx,
+*  main, time_sync, timer, logger and tracer. A role that is not configured takes "default", so
+*  with isolated cores given to the hot roles the housekeeping threads stay off them. Without a
+*  "default" such threads get the placement the process had when load() was called (cpus,
+*  scheduling class, nice), not the one of the thread that created them, so a thread started by
+*  a pinned SCHED_FIFO main does not inherit its core and priority.
+*
+*  The NUMA node is set with the set_mempolicy syscall for the calling thread, MPOL_PREFERRED
+*  unless "numa_strict" is true, then MPOL_BIND. Errors are reported and the thread keeps running
+*  where it is. Each apply() prints where the thread landed, read back from the kernel, and
+*  get_report() returns all of them.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+namespace forward{
+namespace common{
+    struct ThreadRole {
+        std::vector<uint32_t> cpus;     // 空则不改变亲和性
+        std::string cpus_text;          // 配置原文, 用于报告
+        bool fifo{false};               // SCHED_FIFO, 否则SCHED_OTHER
+        int32_t priority{0};            // SCHED_FIFO优先级 1~99
+        int32_t nice{0};                // SCHED_OTHER的nice值
+        int32_t numa_node{-1};          // -1不设置内存策略
+        bool numa_strict{false};        // MPOL_BIND, 否则MPOL_PREFERRED
+    };
+
+    struct ThreadPlacement {
+        std::string name;
+        std::string role;               // 实际使用的角色, 未配置时为default或空
+        int32_t tid{0};
+        std::string cpus;               // 内核报告的亲和性
+        std::string policy;             // fifo/other
+        int32_t priority{0};
+        int32_t numa_node{-1};
+        std::string error;              // 空表示全部生效
+    };
+
+class ThreadTopology {
+public:
+    static ThreadTopology& get_instance() {
+        static ThreadTopology instance;
+        return instance;
+    }
+
+    ThreadTopology(const ThreadTopology&) = delete;
+    ThreadTopology& operator=(const ThreadTopology&) = delete;
+
+    /**
+     * \brief read the "threads" object, call before starting any thread and before apply("main").
+     *
+     * Also records the placement of the calling thread as the one of roles without a config.
+     * \return false if a role is malformed, it is then skipped.
+     */
+    bool load(const nlohmann::json& config);
+
+    /**
+     * \brief name the calling thread and place it as configured for role.
+     * \param name : thread name, at most 15 characters are kept.
+     * \return false if some setting could not be applied.
+     */
+    bool apply(const std::string& role, const std::string& name);
+
+    std::vector<ThreadPlacement> get_report() const;
+
+    /**
+     * \brief parse a cpulist such as "0-3,8,10-11".
+     */
+    static bool parse_cpus(const std::string& text, std::vector<uint32_t>& cpus);
+
+private:
+    ThreadTopology() = default;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, ThreadRole> roles_;
+    ThreadRole inherited_;                  // load()时调用线程的位置, 用于未配置的角色
+    bool loaded_{false};
+    std::vector<ThreadPlacement> report_;
+};
+}
+}
+/** @}*/    // end of group forward
@@ -0,0 +1,426 @@
+#include "common/time_sync.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <fcntl.h>
+#include <sched.h>
+#include <fstream>
+#include <iostream>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "common/thread_topology.h"
+#include "tools/json_unity.h"
+
+namespace forward{
+namespace common{
+
+    // 共享页超过这么多个校准间隔未更新则重新校准, 不再沿用
+    constexpr int64_t kStaleIntervals = 10;
+    // 至少精校这么多次后才写状态文件, 之后每隔kStateSaveIntervalNs写一次
+    constexpr uint32_t kStateMinRefinements = 2;
+    constexpr int64_t kStateSaveIntervalNs = 60 * TimeSync::NsPerSec;
+    constexpr uint32_t kStateVersion = 1;
+    // 校准误差超过此值视为系统时间跳变
+    constexpr int64_t kStepNs = 1000000;
+    // 测量核间偏差时每个核的采样次数
+    constexpr uint32_t kSkewSamples = 16;
+
+    TimeSync::~TimeSync() {
+        stop_calibration_thread();
+        if (page_ != &local_page_) {
+            (void)munmap(page_, sizeof(TimeSyncPage));
+        }
+        if (page_fd_ >= 0) {
+            (void)close(page_fd_);      // 同时释放校准锁
+        }
+    }
+
+    void TimeSync::init(const nlohmann::json& config) {
+        uint32_t init_calibrate_ms{1000};
+        uint32_t calibrate_interval_ms{3000};
+        uint32_t max_tsc_skew_ns{1000};
+        TimeSyncOptions options;
+        (void)tool::JsonUnity::get(config, "init_calibrate_ms", init_calibrate_ms);
+        (void)tool::JsonUnity::get(config, "calibrate_interval_ms", calibrate_interval_ms);
+        (void)tool::JsonUnity::get(config, "shm_path", options.shm_path);
+        (void)tool::JsonUnity::get(config, "state_path", options.state_path);
+        (void)tool::JsonUnity::get(config, "max_tsc_skew_ns", max_tsc_skew_ns);
+        (void)tool::JsonUnity::get(config, "max_slew_ppm", options.max_slew_ppm);
+        options.init_calibrate_ns = static_cast<int64_t>(init_calibrate_ms) * 1000000;
+        options.calibrate_interval_ns = static_cast<int64_t>(calibrate_interval_ms) * 1000000;
+        options.max_tsc_skew_ns = max_tsc_skew_ns;
+        init(options);
+    }
+
+    void TimeSync::init(int64_t init_calibrate_ns, int64_t calibrate_interval_ns, const std::string& shm_path,
+                        const std::string& state_path) {
+        TimeSyncOptions options;
+        options.init_calibrate_ns = init_calibrate_ns;
+        options.calibrate_interval_ns = calibrate_interval_ns;
+        options.shm_path = shm_path;
+        options.state_path = state_path;
+        init(options);
+    }
+
+    void TimeSync::init(const TimeSyncOptions& options) {
+        std::call_once(init_once_, [&]() {
+            const int64_t init_calibrate_ns = options.init_calibrate_ns;
+            const std::string& shm_path = options.shm_path;
+            calibrate_interval_ns_ = options.calibrate_interval_ns;
+            init_calibrate_ns_ = init_calibrate_ns;
+            state_path_ = options.state_path;
+            max_tsc_skew_ns_ = options.max_tsc_skew_ns;
+            max_slew_ppm_ = options.max_slew_ppm;
+            if (shm_path.empty() || !map_page(shm_path)) {
+                calibrate_from_scratch(init_calibrate_ns);
+                calibrator_.store(true, std::memory_order_release);
+            } else if (calibrator_.load(std::memory_order_acquire)) {
+                take_over(init_calibrate_ns);
+            } else {
+                // 等待校准进程发布参数, 期间它退出则由本进程接手
+                const int64_t deadline_ns = get_sys_ns() + init_calibrate_ns + 2 * NsPerSec;
+                while (page_->ready.load(std::memory_order_acquire) == 0U) {
+                    if (flock(page_fd_, LOCK_EX | LOCK_NB) == 0) {
+                        calibrator_.store(true, std::memory_order_release);
+                        take_over(init_calibrate_ns);
+                        break;
+                    }
+                    if (get_sys_ns() > deadline_ns) {
+                        std::cout << "TimeSync shared page not published in time, use a private page" << std::endl;
+                        page_ = &local_page_;
+                        calibrate_from_scratch(init_calibrate_ns);
+                        calibrator_.store(true, std::memory_order_release);
+                        break;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                if (!is_calibrator()) {
+                    set_clock_source(static_cast<ClockSource>(page_->clock_source));
+                }
+            }
+            std::cout << "TimeSync::init " << (shm_path.empty() ? "private" : shm_path)
+                      << (is_calibrator() ? " calibrator" : " reader")
+                      << (get_clock_source() == ClockSource::kTsc ? " tsc ghz " : " monotonic_raw ghz ")
+                      << getTscGhz() << std::endl;
+            running = true;
+            calibration_thread = std::thread(&TimeSync::calibration_loop, this);
+        });
+    }
+
+    bool TimeSync::map_page(const std::string& shm_path) {
+        const int fd = ::open(shm_path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            std::cout << "TimeSync failed to open " << shm_path << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0
+            || (static_cast<size_t>(st.st_size) < sizeof(TimeSyncPage) && ftruncate(fd, sizeof(TimeSyncPage)) != 0)) {
+            std::cout << "TimeSync failed to size " << shm_path << std::endl;
+            (void)close(fd);
+            return false;
+        }
+        void *addr = mmap(nullptr, sizeof(TimeSyncPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            std::cout << "TimeSync failed to map " << shm_path << std::endl;
+            (void)close(fd);
+            return false;
+        }
+        page_fd_ = fd;
+        page_ = static_cast<TimeSyncPage *>(addr);
+        calibrator_.store(flock(fd, LOCK_EX | LOCK_NB) == 0, std::memory_order_release);
+        return true;
+    }
+
+    void TimeSync::take_over(int64_t init_calibrate_ns) {
+        TimeSyncPage *page = page_;
+        const bool valid = page->magic == kTimeSyncMagic && page->version == kTimeSyncVersion
+                           && page->ready.load(std::memory_order_acquire) != 0U && page->ns_per_tsc > 0.0
+                           && get_sys_ns() - page->updated_ns < kStaleIntervals * calibrate_interval_ns_;
+        if (valid) {
+            // 沿用上一个校准进程的参数和计数源, 读者看到的时间保持连续
+            set_clock_source(static_cast<ClockSource>(page->clock_source));
+            int64_t tsc, ns;
+            syncTime(tsc, ns);
+            saveParam(tsc, tsc2ns(tsc), ns, page->ns_per_tsc);
+        } else {
+            page->ready.store(0, std::memory_order_release);
+            page->magic = kTimeSyncMagic;
+            page->version = kTimeSyncVersion;
+            calibrate_from_scratch(init_calibrate_ns);
+        }
+        page->owner_pid = static_cast<int32_t>(getpid());
+        page->ready.store(1, std::memory_order_release);
+    }
+
+    void TimeSync::calibrate_from_scratch(int64_t init_calibrate_ns) {
+        if (has_invariant_tsc()) {
+            set_clock_source(ClockSource::kTsc);
+            calibrate_tsc(init_calibrate_ns);
+            const int64_t skew_ns = measure_tsc_skew();
+            if (skew_ns > max_tsc_skew_ns_) {
+                std::cout << "TimeSync tsc skew across cores " << skew_ns << " ns, use CLOCK_MONOTONIC_RAW" << std::endl;
+                set_clock_source(ClockSource::kMonotonicRaw);
+            }
+        } else {
+            std::cout << "TimeSync tsc is not invariant, use CLOCK_MONOTONIC_RAW" << std::endl;
+            set_clock_source(ClockSource::kMonotonicRaw);
+        }
+        if (get_clock_source() == ClockSource::kMonotonicRaw) {
+            // 计数即纳秒, 速率从1.0开始, 由calibrate()跟上系统时间的频率调整
+            int64_t tick, ns;
+            syncTime(tick, ns);
+            saveParam(tick, ns, ns, 1.0);
+            next_calibrate_tsc_ = tick + init_calibrate_ns;
+        }
+        page_->clock_source = static_cast<uint32_t>(get_clock_source());
+        page_->ready.store(1, std::memory_order_release);
+    }
+
+    void TimeSync::calibrate_tsc(int64_t init_calibrate_ns) {
+        double saved_ns_per_tsc;
+        if (load_state(saved_ns_per_tsc)) {
+            int64_t tsc, ns;
+            syncTime(tsc, ns);
+            saveParam(tsc, ns, ns, saved_ns_per_tsc);
+            // 首次精校只等init_calibrate_ns, 不等满一个校准间隔
+            next_calibrate_tsc_ = tsc + (int64_t) (init_calibrate_ns / saved_ns_per_tsc);
+            std::cout << "TimeSync restored ns_per_tsc " << saved_ns_per_tsc << " from " << state_path_ << std::endl;
+            return;
+        }
+        int64_t base_tsc, base_ns;
+        syncTime(base_tsc, base_ns);
+        int64_t expire_ns = base_ns + init_calibrate_ns;
+        while (get_sys_ns() < expire_ns) std::this_thread::yield();
+        int64_t delayed_tsc, delayed_ns;
+        syncTime(delayed_tsc, delayed_ns);
+        double init_ns_per_tsc = (double) (delayed_ns - base_ns) / (delayed_tsc - base_tsc);
+        saveParam(base_tsc, base_ns, base_ns, init_ns_per_tsc);
+    }
+
+    bool TimeSync::calibrate() {
+        if (rdtsc() < next_calibrate_tsc_) return false;
+        int64_t tsc, ns;
+        syncTime(tsc, ns);
+        int64_t calculated_ns = tsc2ns(tsc);
+        int64_t ns_err = calculated_ns - ns;
+        int64_t expected_err_at_next_calibration =
+                ns_err + (ns_err - base_ns_err_) * calibrate_interval_ns_ / (ns - page_->base_ns + base_ns_err_);
+        // 速率修正不超过max_slew_ppm: 系统时间跳变被逐步吸收, 速率始终为正, get_ns()不回退不跳变
+        const double max_slew = static_cast<double>(max_slew_ppm_) * 1e-6;
+        const double correction = std::clamp((double) expected_err_at_next_calibration / calibrate_interval_ns_,
+                                             -max_slew, max_slew);
+        const bool stepped = (ns_err > kStepNs || ns_err < -kStepNs);
+        if (stepped && !slewing_) {
+            std::cout << "TimeSync system clock stepped, slewing " << -ns_err << " ns at " << max_slew_ppm_
+                      << " ppm" << std::endl;
+        }
+        slewing_ = stepped;
+        double new_ns_per_tsc = page_->ns_per_tsc * (1.0 - correction);
+        saveParam(tsc, calculated_ns, ns, new_ns_per_tsc);
+        return true;
+    }
+
+    void TimeSync::calibration_loop() {
+        (void)ThreadTopology::get_instance().apply("time_sync", "forward TSync");
+        while (running) {
+            if (is_calibrator()) {
+                if (this->calibrate()) {
+                    ++refinements_;
+                    if (!state_path_.empty() && refinements_ >= kStateMinRefinements
+                        && get_clock_source() == ClockSource::kTsc
+                        && get_sys_ns() - state_saved_ns_ >= kStateSaveIntervalNs) {
+                        save_state();
+                    }
+                }
+            } else {
+                // 跟随校准进程选择的计数源
+                set_clock_source(static_cast<ClockSource>(page_->clock_source));
+                if (flock(page_fd_, LOCK_EX | LOCK_NB) == 0) {
+                    // 校准进程已退出, 接手共享页
+                    take_over(init_calibrate_ns_);
+                    calibrator_.store(true, std::memory_order_release);
+                    std::cout << "TimeSync took over calibration of the shared page" << std::endl;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+
+    void TimeSync::stop_calibration_thread() {
+        running = false;
+        if (calibration_thread.joinable()) {
+            calibration_thread.join();
+            // 退出前保存最新的精校结果
+            if (is_calibrator() && !state_path_.empty() && refinements_ >= kStateMinRefinements
+                && get_clock_source() == ClockSource::kTsc) {
+                save_state();
+            }
+        }
+    }
+
+    bool TimeSync::has_invariant_tsc() {
+#if defined(__i386__) || defined(__x86_64__)
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(0x80000000U, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007U) {
+            return false;
+        }
+        (void)__get_cpuid(0x80000007U, &eax, &ebx, &ecx, &edx);
+        return (edx & (1U << 8U)) != 0U;
+#else
+        return false;
+#endif
+    }
+
+    // 在当前核上取TSC窗口最短的一次采样, 窗口中点对应读取CLOCK_MONOTONIC_RAW的时刻
+    static void sample_tsc(int64_t& tsc, int64_t& mono) {
+        int64_t best_window = LLONG_MAX;
+        for (uint32_t i = 0; i < kSkewSamples; ++i) {
+            const int64_t before = TimeSync::read_tsc();
+            const int64_t ns = TimeSync::monotonic_raw_ns();
+            const int64_t after = TimeSync::read_tsc();
+            if (after - before < best_window) {
+                best_window = after - before;
+                tsc = (before + after) >> 1;
+                mono = ns;
+            }
+        }
+    }
+
+    int64_t TimeSync::measure_tsc_skew() const {
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            return 0;
+        }
+        // 遍历所有在线核, 而不只是调用线程当前的亲和性: 主线程可能已按线程拓扑绑在一个核上
+        std::vector<uint32_t> cpus;
+        std::ifstream ifs("/sys/devices/system/cpu/online");
+        std::string online;
+        if (!std::getline(ifs, online) || !ThreadTopology::parse_cpus(online, cpus)) {
+            cpus.clear();
+            for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+            }
+        }
+        struct Sample {
+            int64_t tsc;
+            int64_t mono;
+        };
+        std::vector<Sample> samples;
+        int first_cpu = -1;
+        for (const uint32_t cpu : cpus) {
+            // cpuset之外的核设置失败, 跳过
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            if (sched_setaffinity(0, sizeof(one), &one) != 0) continue;
+            if (first_cpu < 0) first_cpu = static_cast<int>(cpu);
+            Sample sample{};
+            sample_tsc(sample.tsc, sample.mono);
+            samples.push_back(sample);
+        }
+        // 回到第一个核再采一次, 两次采样给出本次测量自己的TSC速率. page_中的速率按系统时间校准,
+        // 带着NTP的频率调整, 与CLOCK_MONOTONIC_RAW比较会把速率差当成核间偏差
+        Sample last{};
+        bool has_last = false;
+        if (first_cpu >= 0) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(first_cpu, &one);
+            if (sched_setaffinity(0, sizeof(one), &one) == 0) {
+                sample_tsc(last.tsc, last.mono);
+                has_last = true;
+            }
+        }
+        (void)sched_setaffinity(0, sizeof(allowed), &allowed);
+        if (samples.size() < 2U || !has_last || last.tsc <= samples.front().tsc) {
+            return 0;
+        }
+        const Sample& first = samples.front();
+        const double ns_per_tsc = (double) (last.mono - first.mono) / (double) (last.tsc - first.tsc);
+        int64_t min_offset = 0, max_offset = 0;     // 第一个核偏差为0
+        for (const Sample& sample : samples) {
+            const int64_t offset = (int64_t) ((double) (sample.tsc - first.tsc) * ns_per_tsc) - (sample.mono - first.mono);
+            min_offset = std::min(min_offset, offset);
+            max_offset = std::max(max_offset, offset);
+        }
+        return max_offset - min_offset;
+    }
+
+    std::string TimeSync::read_cpu_model() {
+        std::ifstream ifs("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(ifs, line)) {
+            if (line.compare(0, 10, "model name") == 0) {
+                const size_t pos = line.find(':');
+                return (pos == std::string::npos) ? "" : line.substr(line.find_first_not_of(' ', pos + 1U));
+            }
+        }
+        return "";
+    }
+
+    std::string TimeSync::read_boot_id() {
+        std::ifstream ifs("/proc/sys/kernel/random/boot_id");
+        std::string boot_id;
+        std::getline(ifs, boot_id);
+        return boot_id;
+    }
+
+    bool TimeSync::load_state(double& ns_per_tsc) const {
+        if (state_path_.empty() || !has_invariant_tsc()) {
+            return false;
+        }
+        std::ifstream ifs(state_path_, std::ios::binary);
+        if (!ifs.is_open()) {
+            return false;
+        }
+        const nlohmann::json state = nlohmann::json::parse(ifs, nullptr, false);
+        if (state.is_discarded() || !state.is_object() || state.value("version", 0U) != kStateVersion
+            || !state.contains("ns_per_tsc") || !state["ns_per_tsc"].is_number()) {
+            std::cout << "TimeSync ignores malformed state file " << state_path_ << std::endl;
+            return false;
+        }
+        const std::string boot_id = read_boot_id();
+        if (boot_id.empty() || state.value("boot_id", "") != boot_id
+            || state.value("cpu_model", "") != read_cpu_model()) {
+            std::cout << "TimeSync state file " << state_path_ << " is from another boot or cpu" << std::endl;
+            return false;
+        }
+        ns_per_tsc = state["ns_per_tsc"].get<double>();
+        // 0.01 ~ 100 GHz之外视为损坏
+        return ns_per_tsc > 0.01 && ns_per_tsc < 100.0;
+    }
+
+    void TimeSync::save_state() {
+        nlohmann::json state;
+        state["version"] = kStateVersion;
+        state["cpu_model"] = read_cpu_model();
+        state["boot_id"] = read_boot_id();
+        state["ns_per_tsc"] = page_->ns_per_tsc;
+        state["saved_ns"] = get_sys_ns();
+        const std::string tmp_path = state_path_ + ".tmp";
+        {
+            std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!ofs.is_open()) {
+                std::cout << "TimeSync failed to write " << tmp_path << std::endl;
+                return;
+            }
+            ofs << state.dump();
+        }
+        // rename保证其他进程读到的总是完整文件
+        if (std::rename(tmp_path.c_str(), state_path_.c_str()) != 0) {
+            std::cout << "TimeSync failed to rename " << tmp_path << std::endl;
+            return;
+        }
+        state_saved_ns_ = get_sys_ns();
+    }
+}
+}
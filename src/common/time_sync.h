@@ -8,7 +8,24 @@
 *
 * Note that it is guaranteed that no locks are held while the stored
 * TimerHandler is called.
-* @details
+* @details TimeSync is a process wide clock service, get_instance() returns the only instance and
+*  init() starts it once. The conversion parameters live in a TimeSyncPage under a sequence lock.
+*  By default the page is private to the process. With a shm_path the page is a file mapped by every
+*  forward process on the host, like a vDSO page: the process holding the flock on the file
+*  calibrates and publishes, the others only read it, so every thread of every process converts
+*  TSC to the same ns. The calibration thread of a reading process just retries the flock once a
+*  second and takes over the page when the calibrating process exits.
+*
+*  With a state_path the refined ns_per_tsc is saved to a file keyed by the CPU model and the
+*  kernel boot_id. When the TSC is invariant and both keys match on the next start, the first
+*  calibration uses the saved rate and returns in microseconds, calibrate() then refines it in the
+*  background as usual.
+*
+*  The TSC is only used when CPUID reports it invariant and the skew measured by pinning the
+*  calibrating thread to each allowed core stays under max_tsc_skew_ns, else rdtsc() reads
+*  CLOCK_MONOTONIC_RAW in ns and the same calibration maps it to system time. calibrate() corrects
+*  the rate by at most max_slew_ppm, so a step of the system clock is slewed in and get_ns() never
+*  goes backwards or jumps.
 * @author		wuting.xu
 * @date		    2024/10/04
 * @par Copyright(c): 	2024. All rights reserved.
@@ -17,68 +34,146 @@
 
 #include <chrono>
 #include <atomic>
+#include <ctime>
+#include <mutex>
+#include <string>
 #include <thread>
 
+#include "nlohmann/json.hpp"
+
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
 
 namespace forward{
 namespace common{
+    constexpr uint64_t kTimeSyncMagic = 0x434e595354445746ULL;  // "FWDTSYNC"
+    constexpr uint32_t kTimeSyncVersion = 2;
+
+    enum class ClockSource : uint32_t {
+        kTsc = 0,               // rdtsc
+        kMonotonicRaw = 1,      // clock_gettime(CLOCK_MONOTONIC_RAW)
+    };
+
+    struct TimeSyncOptions {
+        int64_t init_calibrate_ns{1000000000};      // 首次校准时长
+        int64_t calibrate_interval_ns{3000000000};  // 校准间隔
+        std::string shm_path;                       // 多进程共享的参数页, 空则进程私有
+        std::string state_path;                     // 校准结果状态文件, 空则不保存
+        int64_t max_tsc_skew_ns{1000};              // 核间TSC偏差超过此值改用CLOCK_MONOTONIC_RAW
+        uint32_t max_slew_ppm{500};                 // 每次校准的最大速率修正
+    };
+
+    /**
+     * \brief conversion parameters, written by the calibrator only.
+     */
+    struct alignas(64) TimeSyncPage {
+        uint64_t magic;
+        uint32_t version;
+        std::atomic<uint32_t> ready;        // 参数已发布
+        int32_t owner_pid;                  // 校准进程
+        uint32_t clock_source;              // ClockSource, 所有进程使用同一计数源
+        int64_t updated_ns;                 // 最近一次发布的系统时间
+
+        alignas(64) std::atomic<uint32_t> param_seq;    // 参数序列号
+        double ns_per_tsc;                              // 每个TSC的纳秒数
+        int64_t base_tsc;                               // 基准TSC值
+        int64_t base_ns;                                // 基准纳秒值
+    };
+
 class TimeSync {
 public:
     static const int64_t NsPerSec = 1000000000; // 每秒纳秒数
 
-    // 初始化函数，默认校验时间为1秒
-    void init(int64_t init_calibrate_ns = 1 * NsPerSec, int64_t calibrate_interval_ns = 3 * NsPerSec) {
-        calibrate_interval_ns_ = calibrate_interval_ns;
-        int64_t base_tsc, base_ns;
-        syncTime(base_tsc, base_ns);
-        int64_t expire_ns = base_ns + init_calibrate_ns;
-        while (get_sys_ns() < expire_ns) std::this_thread::yield();
-        int64_t delayed_tsc, delayed_ns;
-        syncTime(delayed_tsc, delayed_ns);
-        double init_ns_per_tsc = (double) (delayed_ns - base_ns) / (delayed_tsc - base_tsc);
-        saveParam(base_tsc, base_ns, base_ns, init_ns_per_tsc);
+    static TimeSync& get_instance() {
+        static TimeSync instance;
+        return instance;
     }
 
-    // 校准函数
-    void calibrate() {
-        if (rdtsc() < next_calibrate_tsc_) return;
-        int64_t tsc, ns;
-        syncTime(tsc, ns);
-        int64_t calculated_ns = tsc2ns(tsc);
-        int64_t ns_err = calculated_ns - ns;
-        int64_t expected_err_at_next_calibration =
-                ns_err + (ns_err - base_ns_err_) * calibrate_interval_ns_ / (ns - base_ns_ + base_ns_err_);
-        double new_ns_per_tsc =
-                ns_per_tsc_ * (1.0 - (double) expected_err_at_next_calibration / calibrate_interval_ns_);
-        saveParam(tsc, calculated_ns, ns, new_ns_per_tsc);
-    }
+    TimeSync(const TimeSync&) = delete;
+    TimeSync& operator=(const TimeSync&) = delete;
+
+    /**
+     * \brief start the clock service, later calls return at once.
+     *
+     * Blocks for init_calibrate_ns while the first calibration runs, or until the calibrating
+     * process published the shared page.
+     * \param shm_path : file of the page shared by all processes, empty keeps the page private.
+     * \param state_path : file the calibrated rate is saved to and restored from, empty disables it.
+     */
+    void init(int64_t init_calibrate_ns = 1 * NsPerSec, int64_t calibrate_interval_ns = 3 * NsPerSec,
+              const std::string& shm_path = "", const std::string& state_path = "");
+
+    void init(const TimeSyncOptions& options);
 
-    // 读取时间戳计数器
+    /**
+     * \brief init() from the "time_sync" config object, keys init_calibrate_ms,
+     * calibrate_interval_ms, shm_path, state_path, max_tsc_skew_ns and max_slew_ppm.
+     */
+    void init(const nlohmann::json& config);
+
+    // 校准函数, 只由持有参数页的校准线程调用, 返回是否发布了新参数
+    bool calibrate();
+
+    // 读取计数器, TSC不可靠时为CLOCK_MONOTONIC_RAW纳秒
     static inline int64_t rdtsc() {
+        if (__builtin_expect(clock_source_.load(std::memory_order_relaxed) != ClockSource::kTsc, 0)) {
+            return monotonic_raw_ns();
+        }
+        return read_tsc();
+    }
+
+    // 读取硬件TSC
+    static inline int64_t read_tsc() {
 #ifdef _MSC_VER
         return __rdtsc();
 #elif defined(__i386__) || defined(__x86_64__) || defined(__amd64__)
         return __builtin_ia32_rdtsc();
 #else
-        return rdsysns();
+        return monotonic_raw_ns();
+#endif
+    }
+
+    static inline int64_t monotonic_raw_ns() {
+#ifdef CLOCK_MONOTONIC_RAW
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return ts.tv_sec * NsPerSec + ts.tv_nsec;
+#else
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
 #endif
     }
 
+    static ClockSource get_clock_source() { return clock_source_.load(std::memory_order_relaxed); }
+
     // 将TSC值转换为纳秒
     inline int64_t tsc2ns(int64_t tsc) const {
+        const TimeSyncPage *page = page_;
         while (true) {
-            uint32_t before_seq = param_seq_.load(std::memory_order_acquire) & ~1;
+            uint32_t before_seq = page->param_seq.load(std::memory_order_acquire) & ~1;
             std::atomic_signal_fence(std::memory_order_acq_rel);
-            int64_t ns = base_ns_ + (int64_t) ((tsc - base_tsc_) * ns_per_tsc_);
+            int64_t ns = page->base_ns + (int64_t) ((tsc - page->base_tsc) * page->ns_per_tsc);
             std::atomic_signal_fence(std::memory_order_acq_rel);
-            uint32_t after_seq = param_seq_.load(std::memory_order_acquire);
+            uint32_t after_seq = page->param_seq.load(std::memory_order_acquire);
             if (before_seq == after_seq) return ns;
         }
     }
 
+    // 同tsc2ns, 另外累加因参数更新而重读的次数, 供基准测试统计seqlock重试
+    inline int64_t tsc2ns(int64_t tsc, uint64_t& retries) const {
+        const TimeSyncPage *page = page_;
+        while (true) {
+            uint32_t before_seq = page->param_seq.load(std::memory_order_acquire) & ~1;
+            std::atomic_signal_fence(std::memory_order_acq_rel);
+            int64_t ns = page->base_ns + (int64_t) ((tsc - page->base_tsc) * page->ns_per_tsc);
+            std::atomic_signal_fence(std::memory_order_acq_rel);
+            uint32_t after_seq = page->param_seq.load(std::memory_order_acquire);
+            if (before_seq == after_seq) return ns;
+            ++retries;
+        }
+    }
+
     // 获取当前纳秒时间戳
     inline int64_t get_ns() const { return tsc2ns(rdtsc()); }
 
@@ -89,7 +184,23 @@ public:
     }
 
     // 获取TSC的GHz频率
-    double getTscGhz() const { return 1.0 / ns_per_tsc_; }
+    double getTscGhz() const { return 1.0 / page_->ns_per_tsc; }
+
+    // CPUID 0x80000007 EDX bit 8, TSC频率不随P/C状态变化
+    static bool has_invariant_tsc();
+
+    /**
+     * \brief largest TSC offset between the online cores, in ns.
+     *
+     * Pins the calling thread to each online core it may be moved to in turn and compares the TSC with
+     * CLOCK_MONOTONIC_RAW there, the affinity is restored afterwards. The TSC rate is measured
+     * against CLOCK_MONOTONIC_RAW by sampling the first core again at the end, not taken from
+     * the calibration, which follows the NTP slewed system time.
+     */
+    int64_t measure_tsc_skew() const;
+
+    // 本进程是否为参数页的校准者
+    bool is_calibrator() const { return calibrator_.load(std::memory_order_acquire); }
 
     // 同步时间函数
     static void syncTime(int64_t &tsc_out, int64_t &ns_out) {
@@ -131,51 +242,92 @@ public:
     void saveParam(int64_t base_tsc, int64_t base_ns, int64_t sys_ns, double new_ns_per_tsc) {
         base_ns_err_ = base_ns - sys_ns;
         next_calibrate_tsc_ = base_tsc + (int64_t) ((calibrate_interval_ns_ - 1000) / new_ns_per_tsc);
-        uint32_t seq = param_seq_.load(std::memory_order_relaxed);
-        param_seq_.store(++seq, std::memory_order_release);
+        TimeSyncPage *page = page_;
+        uint32_t seq = page->param_seq.load(std::memory_order_relaxed);
+        page->param_seq.store(++seq, std::memory_order_release);
         std::atomic_signal_fence(std::memory_order_acq_rel);
-        base_tsc_ = base_tsc;
-        base_ns_ = base_ns;
-        ns_per_tsc_ = new_ns_per_tsc;
+        page->base_tsc = base_tsc;
+        page->base_ns = base_ns;
+        page->ns_per_tsc = new_ns_per_tsc;
         std::atomic_signal_fence(std::memory_order_acq_rel);
-        param_seq_.store(++seq, std::memory_order_release);
-    }
-
-    std::atomic<bool> running{false};
-    std::thread calibration_thread;
-
-    // 启动校准线程
-    void start_calibration_thread() {
-        running = true;
-        calibration_thread = std::thread([this]() {
-            while (running) {
-                this->calibrate();
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-            }
-        });
+        page->param_seq.store(++seq, std::memory_order_release);
+        page->updated_ns = sys_ns;
     }
 
     // 停止校准线程
-    void stop_calibration_thread() {
-        running = false;
-        if (calibration_thread.joinable()) {
-            calibration_thread.join();
-        }
-    }
+    void stop_calibration_thread();
 
     // 析构函数，确保线程停止
-    ~TimeSync() {
-        stop_calibration_thread();
+    ~TimeSync();
+
+private:
+    TimeSync() = default;
+
+    /**
+     * \brief map the shared page, take the calibrator lock if it is free.
+     * \return false if the page can not be mapped, the private page is used then.
+     */
+    bool map_page(const std::string& shm_path);
+
+    /**
+     * \brief become the calibrator of the page, continue from its parameters if they are recent.
+     */
+    void take_over(int64_t init_calibrate_ns);
+
+    /**
+     * \brief first calibration of a fresh page, picks the counter: the TSC if it is invariant and in
+     * sync across cores, else CLOCK_MONOTONIC_RAW. Blocks for init_calibrate_ns on the TSC path.
+     */
+    void calibrate_from_scratch(int64_t init_calibrate_ns);
+
+    /**
+     * \brief first TSC rate, from the state file or by waiting init_calibrate_ns.
+     */
+    void calibrate_tsc(int64_t init_calibrate_ns);
+
+    static void set_clock_source(ClockSource source) {
+        clock_source_.store(source, std::memory_order_relaxed);
     }
 
-    alignas(64) std::atomic<uint32_t> param_seq_{0};  // 参数序列号
-    double ns_per_tsc_;                               // 每个TSC的纳秒数
-    int64_t base_tsc_;                                // 基准TSC值
-    int64_t base_ns_;                                 // 基准纳秒值
-    int64_t calibrate_interval_ns_;                    // 校准间隔（纳秒）
-    int64_t base_ns_err_;                             // 基准纳秒误差
-    int64_t next_calibrate_tsc_;                      // 下次校准的TSC值
+    /**
+     * \brief read the rate saved by a previous run on this boot of this CPU model.
+     * \return false if there is no state file, it does not match or the TSC is not invariant.
+     */
+    bool load_state(double& ns_per_tsc) const;
+
+    /**
+     * \brief write the current rate to state_path_, through a temp file and rename.
+     */
+    void save_state();
+
+    static std::string read_cpu_model();
+
+    static std::string read_boot_id();
+
+    void calibration_loop();
+
+    std::once_flag init_once_;
+    TimeSyncPage local_page_{};                 // 未使用共享页时的参数
+    TimeSyncPage *page_{&local_page_};
+    int page_fd_{-1};
+    std::atomic<bool> calibrator_{false};
+    std::string state_path_;
+    int64_t max_tsc_skew_ns_{1000};
+    uint32_t max_slew_ppm_{500};
+    bool slewing_{false};                       // 正在吸收系统时间的跳变
+    int64_t state_saved_ns_{0};                 // 最近一次写状态文件的系统时间
+    uint32_t refinements_{0};                   // 本进程完成的校准次数
+
+    std::atomic<bool> running{false};
+    std::thread calibration_thread;
+
+    int64_t init_calibrate_ns_{NsPerSec};         // 首次校准时长（纳秒）
+    int64_t calibrate_interval_ns_{3 * NsPerSec};  // 校准间隔（纳秒）
+    int64_t base_ns_err_{0};                       // 基准纳秒误差
+    int64_t next_calibrate_tsc_{0};                // 下次校准的TSC值
+
+    static inline std::atomic<ClockSource> clock_source_{ClockSource::kTsc};
 };
 }
 }
-/** @}*/    // end of group forward
\ No newline at end of file
+/** @}*/    // end of group forward
@@ -1,4 +1,5 @@
 #include "common/timer.h"
+#include "common/thread_topology.h"
 #include <utility>
 #include <random>
 
@@ -85,6 +86,7 @@ std::chrono::steady_clock::duration Timer::get_time_remaining() const {
 }
 
 void Timer::run(){
+    (void)ThreadTopology::get_instance().apply("timer", "forward Timer");
     std::unique_lock<std::mutex> lock(mutex_);
     while (!exit_requested_.load()) {
         // Block until timer expires or timer is started again
@@ -161,6 +163,7 @@ Timer::Timer(Timer::timer_handler a_timer_handler, Timer::Mode timer_mode)
 }
 
 void Timer::run_backoff() {
+    (void)ThreadTopology::get_instance().apply("timer", "forward Timer");
     std::unique_lock<std::mutex> lock(mutex_);
     while (!exit_requested_.load()) {
         // Block until timer expires or timer is started again
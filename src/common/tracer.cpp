@@ -0,0 +1,128 @@
+#include "common/tracer.h"
+
+#include <iostream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/file_utility.h"
+#include "common/thread_topology.h"
+#include "tools/json_unity.h"
+
+namespace forward{
+namespace common{
+
+    std::atomic<uint64_t> Tracer::sample_every_{0};
+
+    const char* Tracer::stage_name(uint16_t stage) {
+        static const char* names[static_cast<uint16_t>(TraceStage::kCount)] = {
+                "serialize", "enqueue", "tx_commit", "rx", "decode", "sink_enqueue", "flush"};
+        return (stage < static_cast<uint16_t>(TraceStage::kCount)) ? names[stage] : "unknown";
+    }
+
+    Tracer::~Tracer() {
+        stop();
+    }
+
+    void Tracer::start(const nlohmann::json& config, const TimeSync& ts) {
+        uint32_t sample_every{0};
+        std::string path{"trace.json"};
+        (void)tool::JsonUnity::get(config, "sample_every", sample_every);
+        (void)tool::JsonUnity::get(config, "path", path);
+        (void)tool::JsonUnity::get(config, "dump_interval_ms", dump_interval_ms_);
+        if (sample_every == 0U || running_) {
+            return;
+        }
+        if (path.empty() || path[0] != '/') {
+            path = FileUtility::get_process_path() + "/" + path;
+        }
+        out_.open(path, std::ios::trunc);
+        if (!out_.is_open()) {
+            std::cout << "Tracer::start failed to open " << path << std::endl;
+            return;
+        }
+        out_ << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        ts_ = &ts;
+        pid_ = static_cast<uint32_t>(getpid());
+        first_event_ = true;
+        running_ = true;
+        dumper_ = std::thread(&Tracer::dump_loop, this);
+        sample_every_.store(sample_every, std::memory_order_relaxed);
+        std::cout << "Tracer::start sample_every " << sample_every << " to " << path << std::endl;
+    }
+
+    void Tracer::stop() {
+        sample_every_.store(0, std::memory_order_relaxed);
+        {
+            const std::lock_guard<std::mutex> lock(run_mutex_);
+            if (!running_) {
+                return;
+            }
+            running_ = false;
+        }
+        run_cv_.notify_all();
+        if (dumper_.joinable()) {
+            dumper_.join();
+        }
+        drain();
+        out_ << "\n]}\n";
+        out_.close();
+    }
+
+    Tracer::Ring* Tracer::register_thread() {
+        auto ring = std::make_unique<Ring>();
+        ring->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+        const std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.emplace_back(std::move(ring));
+        return rings_.back().get();
+    }
+
+    void Tracer::dump_loop() {
+        (void)ThreadTopology::get_instance().apply("tracer", "forward Trace");
+        std::unique_lock<std::mutex> lock(run_mutex_);
+        while (running_) {
+            run_cv_.wait_for(lock, std::chrono::milliseconds(dump_interval_ms_));
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+
+    // 仅导出线程或stop()调用, 每个环只有一个消费者
+    void Tracer::drain() {
+        std::vector<Ring*> rings;
+        {
+            const std::lock_guard<std::mutex> lock(rings_mutex_);
+            for (auto& ring : rings_) {
+                rings.push_back(ring.get());
+            }
+        }
+        std::string buffer;
+        for (Ring *ring : rings) {
+            uint32_t t = ring->tail.load(std::memory_order_relaxed);
+            const uint32_t h = ring->head.load(std::memory_order_acquire);
+            for (; t != h; ++t) {
+                const Event& e = ring->events[t & (kRingSize - 1U)];
+                const int64_t ns = ts_->tsc2ns(e.tsc);
+                // trace_event的ts单位为微秒
+                char line[256];
+                const int n = snprintf(line, sizeof(line),
+                                       "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%ld.%03ld,"
+                                       "\"pid\":%u,\"tid\":%u,\"args\":{\"cmd\":%u,\"id\":%lu}}",
+                                       first_event_ ? "" : ",\n", stage_name(e.stage),
+                                       static_cast<long>(ns / 1000), static_cast<long>(ns % 1000),
+                                       pid_, ring->tid, static_cast<unsigned>(e.id >> kKeyCmdShift),
+                                       static_cast<unsigned long>(e.id & kKeyIdMask));
+                if (n > 0) {
+                    buffer.append(line, static_cast<size_t>(n));
+                    first_event_ = false;
+                }
+            }
+            ring->tail.store(t, std::memory_order_release);
+        }
+        if (!buffer.empty()) {
+            out_ << buffer;
+            out_.flush();
+        }
+    }
+}
+}
@@ -0,0 +1,172 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file tracer.h
+* @brief sampled per stage TSC tracing with a Chrome trace_event exporter
+* @details Every thread that emits an event gets its own single producer ring of (stage, tsc,
+*  record id) events, so emit() is a thread_local lookup, one rdtsc and one store. A background
+*  dumper drains the rings, converts TSC to ns with TimeSync and appends Chrome trace_event JSON
+*  that can be opened in Perfetto or chrome://tracing.
+*
+*  Events are sampled by record id: a record is traced at every stage when id % sample_every == 0,
+*  so one record can be followed from serialize to the storage sink. Records of different types
+*  share total_id, so the id passed to emit() is key(command number, total_id). Batch events
+*  without a record id (tx commit, rx, flush) are sampled by a per thread counter instead. A full
+*  ring drops the event.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+#include "time_sync.h"
+#include "memory_hardening.h"
+
+namespace forward{
+namespace common{
+enum class TraceStage : uint16_t {
+    kSerialize = 0,     // 发送端序列化完成
+    kEnqueue,           // 进入发送调度队列
+    kTxCommit,          // 提交发送环
+    kRx,                // 接收端从接收环取到一批报文
+    kDecode,            // 解码完成
+    kSinkEnqueue,       // 交给存储
+    kFlush,             // 存储写出文件
+    kCount,
+};
+
+class Tracer {
+public:
+    static constexpr uint32_t kRingSize = 1U << 16;    // 每线程事件数, 2的幂
+
+    /**
+     * \brief one traced point.
+     */
+    struct Event {
+        int64_t tsc;
+        uint64_t id;        // key()得到的记录编号, 批事件为0
+        uint16_t stage;
+    };
+
+    static Tracer& get_instance() {
+        static Tracer instance;
+        return instance;
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /**
+     * \brief read the "trace" object of a configuration and start tracing if it is enabled.
+     *
+     * Keys: sample_every (0 disables tracing), path (output file, relative to the process dir),
+     * dump_interval_ms. ts converts the TSC values and must outlive the tracer.
+     */
+    void start(const nlohmann::json& config, const TimeSync& ts);
+
+    /**
+     * \brief drain the rings a last time, close the JSON and join the dumper.
+     */
+    void stop();
+
+    static inline bool enabled() {
+        return sample_every_.load(std::memory_order_relaxed) != 0U;
+    }
+
+    static constexpr uint32_t kKeyCmdShift = 48;
+    static constexpr uint64_t kKeyIdMask = (1ULL << kKeyCmdShift) - 1U;
+
+    /**
+     * \brief trace id of record id of command no, the command number goes into the top 16 bits.
+     */
+    static constexpr uint64_t key(uint16_t no, uint64_t id) {
+        return (static_cast<uint64_t>(no) << kKeyCmdShift) | (id & kKeyIdMask);
+    }
+
+    /**
+     * \brief record stage for record id if it is sampled, lock free.
+     *
+     * Sampling looks at the record id only, so the records of every type with a sampled id are traced.
+     */
+    static inline void emit(TraceStage stage, uint64_t id) {
+        const uint64_t every = sample_every_.load(std::memory_order_relaxed);
+        if (every == 0U) {
+            return;
+        }
+        Ring *ring = local_ring();
+        if (id == 0U) {
+            if (++ring->batch_counter % every != 0U) {
+                return;
+            }
+        } else if ((id & kKeyIdMask) % every != 0U) {
+            return;
+        }
+        ring->push(Event{TimeSync::rdtsc(), id, static_cast<uint16_t>(stage)});
+    }
+
+    static const char* stage_name(uint16_t stage);
+
+private:
+    struct Ring {
+        alignas(64) std::atomic<uint32_t> head{0};      // 生产者写
+        alignas(64) std::atomic<uint32_t> tail{0};      // 导出线程写
+        uint64_t batch_counter{0};
+        uint64_t dropped{0};
+        uint32_t tid{0};
+        std::vector<Event, HugePageAllocator<Event>> events = std::vector<Event, HugePageAllocator<Event>>(kRingSize);
+
+        void push(const Event& e) {
+            const uint32_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) >= kRingSize) {
+                ++dropped;
+                return;
+            }
+            events[h & (kRingSize - 1U)] = e;
+            head.store(h + 1U, std::memory_order_release);
+        }
+    };
+
+    Tracer() = default;
+    ~Tracer();
+
+    static Ring* local_ring() {
+        thread_local Ring *ring = get_instance().register_thread();
+        return ring;
+    }
+
+    Ring* register_thread();
+    void dump_loop();
+    void drain();
+
+    static std::atomic<uint64_t> sample_every_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    const TimeSync *ts_{nullptr};
+    std::ofstream out_;
+    bool first_event_{true};
+    uint32_t pid_{0};
+    uint32_t dump_interval_ms_{1000};
+
+    std::mutex run_mutex_;
+    std::condition_variable run_cv_;
+    bool running_{false};
+    std::thread dumper_;
+};
+}
+}
+
+/** @}*/    // end of group forward
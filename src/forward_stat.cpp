@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/metrics.h"
+
+using namespace forward::common;
+
+static void usage() {
+    std::cout << "usage: forward_stat <stats file> [-p] [-i interval_ms] [-n count]\n"
+              << "  -p  print Prometheus text format\n"
+              << "  -i  print every interval_ms, counters with their rate per second\n"
+              << "  -n  stop after count prints, 0 runs until killed" << std::endl;
+}
+
+static std::string full_name(const StatsSlot& slot) {
+    std::string name(slot.name, strnlen(slot.name, sizeof(slot.name)));
+    const size_t labels_len = strnlen(slot.labels, sizeof(slot.labels));
+    if (labels_len != 0U) {
+        name += "{" + std::string(slot.labels, labels_len) + "}";
+    }
+    return name;
+}
+
+static void print_prometheus(const StatsHeader *header, const StatsSlot *slots) {
+    // 同名指标归到一组, 每组输出一次TYPE
+    std::map<std::string, std::vector<uint32_t>> groups;
+    const uint32_t used = header->used.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < used && i < header->capacity; ++i) {
+        groups[std::string(slots[i].name, strnlen(slots[i].name, sizeof(slots[i].name)))].push_back(i);
+    }
+    for (const auto& [name, indexes] : groups) {
+        const bool counter = slots[indexes.front()].type == static_cast<uint8_t>(MetricType::kCounter);
+        std::cout << "# TYPE " << name << (counter ? " counter" : " gauge") << "\n";
+        for (const uint32_t i : indexes) {
+            std::cout << full_name(slots[i]) << " " << slots[i].value.load(std::memory_order_relaxed) << "\n";
+        }
+    }
+    std::cout << std::flush;
+}
+
+static void print_table(const StatsHeader *header, const StatsSlot *slots,
+                        std::vector<int64_t>& last, double elapsed_sec) {
+    const uint32_t used = header->used.load(std::memory_order_acquire);
+    last.resize(used, 0);
+    std::cout << "---- " << header->process << " pid " << header->pid << " metrics " << used << "\n";
+    for (uint32_t i = 0; i < used && i < header->capacity; ++i) {
+        const int64_t value = slots[i].value.load(std::memory_order_relaxed);
+        std::cout << full_name(slots[i]) << " " << value;
+        if (elapsed_sec > 0.0 && slots[i].type == static_cast<uint8_t>(MetricType::kCounter)) {
+            std::cout << " (" << static_cast<int64_t>(static_cast<double>(value - last[i]) / elapsed_sec) << "/s)";
+        }
+        std::cout << "\n";
+        last[i] = value;
+    }
+    std::cout << std::flush;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    std::string path = argv[1];
+    bool prometheus = false;
+    uint32_t interval_ms = 0;
+    uint32_t count = 0;
+    bool count_set = false;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "-p") == 0) {
+            prometheus = true;
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            interval_ms = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = static_cast<uint32_t>(std::stoul(argv[++i]));
+            count_set = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!count_set && interval_ms == 0U) {
+        count = 1;      // 不指定间隔时只打印一次
+    }
+
+    size_t size = 0;
+    const StatsHeader *header = MetricsRegistry::map_readonly(path, size);
+    if (header == nullptr) {
+        std::cout << "forward_stat cannot map stats file " << path << std::endl;
+        return 1;
+    }
+    const auto *slots = reinterpret_cast<const StatsSlot *>(reinterpret_cast<const uint8_t *>(header) + sizeof(StatsHeader));
+
+    std::vector<int64_t> last;
+    auto last_time = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; count == 0U || n < count; ++n) {
+        if (prometheus) {
+            print_prometheus(header, slots);
+        } else {
+            const auto now = std::chrono::steady_clock::now();
+            const double elapsed = (n == 0U) ? 0.0 : std::chrono::duration<double>(now - last_time).count();
+            last_time = now;
+            print_table(header, slots, last, elapsed);
+        }
+        if (interval_ms == 0U || (count != 0U && n + 1U == count)) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+    return 0;
+}
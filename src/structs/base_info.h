@@ -27,6 +27,27 @@ constexpr auto key_target_port = "target_port";
 constexpr auto key_local_ip = "local_ip";
 constexpr auto key_local_port = "local_port";
 constexpr auto key_data_type = "data_types";
+constexpr auto key_data_type_single = "data_type";
+constexpr auto key_priority = "priority";
+constexpr auto key_rate_bytes = "rate_bytes_per_sec";
+constexpr auto key_rate_packets = "rate_packets_per_sec";
+constexpr auto key_burst_bytes = "burst_bytes";
+constexpr auto key_burst_packets = "burst_packets";
+constexpr auto key_coalesce_bytes = "coalesce_bytes";
+constexpr auto key_max_queue_frames = "max_queue_frames";
+constexpr auto key_sequence = "sequence";
+constexpr auto key_retransmit_slots = "retransmit_slots";
+constexpr auto key_nack = "nack";
+constexpr auto key_fec_k = "fec_k";
+constexpr auto key_fec_m = "fec_m";
+constexpr auto key_backup_target_ip = "backup_target_ip";
+constexpr auto key_backup_target_port = "backup_target_port";
+constexpr auto key_backup_local_ip = "backup_local_ip";
+constexpr auto key_clock_sync_interval_ms = "clock_sync_interval_ms";
+constexpr auto key_workers = "workers";
+constexpr auto key_rx_hold_batches = "rx_hold_batches";
+constexpr auto key_rx_batch_min = "rx_batch_min";
+constexpr auto key_rx_batch_max = "rx_batch_max";
 
 class BaseInfo {
 public:
@@ -17,11 +17,87 @@ namespace structs{
         uint16_t len;
         char	data[0];
     };
+
+    /**
+     * optional per channel sequence header, present right after Cmd when no has kCmdFlagSeq set.
+     * Cmd.len always counts the whole frame, headers included.
+     */
+    struct SeqHeader {
+        uint32_t seq;           // 通道内帧序号, 从1开始
+        uint16_t channel_id;    // 发送通道编号
+        uint16_t flags;         // kSeqFlag*
+    };
+
+    /**
+     * one range of missing sequence numbers in a NACK.
+     */
+    struct NackRange {
+        uint32_t start;
+        uint16_t count;
+    };
+
+    /**
+     * payload of a kCmdNack frame, sent by the receiver back to the sender of channel_id.
+     */
+    struct NackHeader {
+        uint16_t channel_id;
+        uint16_t range_count;
+        NackRange ranges[0];
+    };
+
+    /**
+     * payload of a kCmdFec frame: one parity symbol of the block of k data frames starting at
+     * block_base, followed by symbol_len bytes.
+     */
+    struct FecHeader {
+        uint32_t block_base;    // 块内第一个数据帧的序号
+        uint16_t channel_id;
+        uint16_t symbol_len;
+        uint8_t  k;             // 数据帧数
+        uint8_t  m;             // 校验帧数
+        uint8_t  index;         // 校验帧编号 [0, m)
+        uint8_t  reserved;
+        uint8_t  symbol[0];
+    };
+
+    /**
+     * payload of kCmdPing and kCmdPong, a PTP style timestamp exchange used to estimate the clock
+     * offset of the sender. The receiver sends a ping with t1, the sender echoes it as a pong with
+     * t2 (ping received) and t3 (pong sent) in its own clock.
+     */
+    struct ClockProbe {
+        uint16_t channel_id;    // 被测的发送通道
+        uint16_t reserved;
+        uint32_t id;
+        int64_t  t1;
+        int64_t  t2;
+        int64_t  t3;
+    };
 #pragma pack()
 
+    constexpr uint16_t kCmdFlagSeq = 0x8000;    // Cmd后紧跟SeqHeader
+    constexpr uint16_t kCmdNoMask = 0x0fff;     // Cmd.no中的命令号
+
+    constexpr uint16_t kSeqFlagRetransmit = 0x0001; // 重传帧
+    constexpr uint16_t kSeqFlagPathB = 0x0002;      // 经B路径发送的副本
+    constexpr uint16_t kSeqEpochShift = 4;          // flags高12位为发送端每次启动选取的代号
+    constexpr uint16_t kSeqEpochMask = 0xfff0;
+
+    // 控制命令号, 不会交给存储
+    constexpr uint16_t kCmdNack = 0x0ff0;       // 接收端请求重传
+    constexpr uint16_t kCmdFec = 0x0ff1;        // 前向纠错校验帧
+    constexpr uint16_t kCmdPing = 0x0ff2;       // 接收端发起的对时请求
+    constexpr uint16_t kCmdPong = 0x0ff3;       // 发送端的对时应答
+
     template <uint8_t no>
     struct UniqueTrailer {};
 
+    /**
+     * command number of a record type, CmdNo<StructA>::no == StructACmd::no.
+     */
+    template <typename T>
+    struct CmdNo;
+
 #define CMD_DECLARE(cmd_name, data_type, n)	\
 	template <> struct UniqueTrailer<n> {};	\
 	struct cmd_name {	\
@@ -29,7 +105,8 @@ namespace structs{
 		cmd_name() {	\
 		}	\
 		data_type	data;               \
-	};
+	};	\
+	template <> struct CmdNo<data_type> { const static uint16_t no = n; };
 
     CMD_DECLARE(StructACmd, StructA, 1);
     CMD_DECLARE(StructBCmd, StructB, 2);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include "xudp.h"
 #include "nlohmann/json.hpp"
@@ -17,25 +18,182 @@ public:
         }
 
         Cmd *cmd = (Cmd *)p;
-        if (size < cmd->len) {
+        if (size < cmd->len || cmd->len < header_size(cmd)) {
             return 0;
         }
 
         return cmd->len;
     }
 
-    static::std::vector<uint8_t> makeupSerializeDataForCmd(const std::string &str, uint16_t no) {
-        int len = str.size();
-        len += sizeof(Cmd);
+    /**
+     * \param with_seq : reserve a SeqHeader, stamped later by stampSeq.
+     */
+    static::std::vector<uint8_t> makeupSerializeDataForCmd(const std::string &str, uint16_t no, bool with_seq = false) {
         std::vector<uint8_t> data;
-        data.resize(len);
-        Cmd *c = (Cmd *)data.data();
+        makeupSerializeDataForCmd(str, no, with_seq, data);
+        return data;
+    }
+
+    /**
+     * \brief same as above, built into data, whose capacity is reused.
+     */
+    static void makeupSerializeDataForCmd(const std::string &str, uint16_t no, bool with_seq,
+                                          std::vector<uint8_t> &data) {
+        data.resize(frameSize(str, with_seq));
+        if (makeupSerializeDataForCmd(str, no, with_seq, data.data(), data.size()) == 0U) {
+            data.clear();   // 超出Cmd.len的范围
+        }
+    }
+
+    /**
+     * \brief same as above, built into buf of size bytes.
+     * \return length of the frame, 0 if it does not fit into buf.
+     */
+    static uint32_t makeupSerializeDataForCmd(const std::string &str, uint16_t no, bool with_seq,
+                                              uint8_t *buf, size_t size) {
+        const size_t len = frameSize(str, with_seq);
+        if (len > size || len > UINT16_MAX) {
+            return 0;
+        }
+        Cmd *c = (Cmd *)buf;
+        c->len = len;
+        c->no = with_seq ? (no | kCmdFlagSeq) : no;
+        if (with_seq) {
+            SeqHeader *h = (SeqHeader *)c->data;
+            h->seq = 0;
+            h->channel_id = 0;
+            h->flags = 0;
+        }
+
+        memcpy(buf + header_size(c), str.c_str(), str.size());
+        return static_cast<uint32_t>(len);
+    }
+
+    static size_t frameSize(const std::string &str, bool with_seq) {
+        return sizeof(Cmd) + (with_seq ? sizeof(SeqHeader) : 0U) + str.size();
+    }
+
+    /**
+     * \brief write the sequence number and the sender epoch into a frame built with with_seq.
+     * \return false if the frame has no SeqHeader.
+     */
+    static bool stampSeq(std::vector<uint8_t> &frame, uint16_t channel_id, uint32_t seq, uint16_t epoch = 0) {
+        if (frame.size() < sizeof(Cmd) + sizeof(SeqHeader)) {
+            return false;
+        }
+        Cmd *c = (Cmd *)frame.data();
+        if ((c->no & kCmdFlagSeq) == 0) {
+            return false;
+        }
+        SeqHeader *h = (SeqHeader *)c->data;
+        h->seq = seq;
+        h->channel_id = channel_id;
+        h->flags = static_cast<uint16_t>((h->flags & ~kSeqEpochMask) | ((epoch << kSeqEpochShift) & kSeqEpochMask));
+        return true;
+    }
+
+    /**
+     * \brief epoch of the sender that stamped h, changes when the sender restarts its sequence.
+     */
+    static uint16_t seqEpoch(const SeqHeader *h) {
+        return static_cast<uint16_t>(h->flags >> kSeqEpochShift);
+    }
+
+    /**
+     * \brief build a kCmdNack frame into buf.
+     * \return frame length, 0 if buf is too small.
+     */
+    static uint32_t makeupNack(uint8_t *buf, uint32_t capacity, uint16_t channel_id,
+                               const NackRange *ranges, uint16_t count) {
+        const uint32_t len = sizeof(Cmd) + sizeof(NackHeader) + sizeof(NackRange) * count;
+        if (len > capacity) {
+            return 0;
+        }
+        Cmd *c = (Cmd *)buf;
+        c->no = kCmdNack;
         c->len = len;
+        NackHeader *h = (NackHeader *)c->data;
+        h->channel_id = channel_id;
+        h->range_count = count;
+        memcpy(h->ranges, ranges, sizeof(NackRange) * count);
+        return len;
+    }
+
+    /**
+     * \return the NACK payload, nullptr if the frame is not a well formed kCmdNack.
+     */
+    static const NackHeader* nackHeader(const Cmd *cmd) {
+        if (cmdNo(cmd) != kCmdNack || cmd->len < sizeof(Cmd) + sizeof(NackHeader)) {
+            return nullptr;
+        }
+        const NackHeader *h = (const NackHeader *)cmd->data;
+        if (cmd->len < sizeof(Cmd) + sizeof(NackHeader) + sizeof(NackRange) * h->range_count) {
+            return nullptr;
+        }
+        return h;
+    }
+
+    /**
+     * \return the FEC payload, nullptr if the frame is not a well formed kCmdFec.
+     */
+    static const FecHeader* fecHeader(const Cmd *cmd) {
+        if (cmdNo(cmd) != kCmdFec || cmd->len < sizeof(Cmd) + sizeof(FecHeader)) {
+            return nullptr;
+        }
+        const FecHeader *h = (const FecHeader *)cmd->data;
+        if (cmd->len < sizeof(Cmd) + sizeof(FecHeader) + h->symbol_len || h->index >= h->m) {
+            return nullptr;
+        }
+        return h;
+    }
+
+    /**
+     * \brief write a kCmdPing or kCmdPong frame into buf.
+     * \return frame length, 0 if buf is too small.
+     */
+    static uint32_t makeupClockProbe(uint8_t *buf, uint32_t capacity, uint16_t no, const ClockProbe& probe) {
+        const uint32_t len = sizeof(Cmd) + sizeof(ClockProbe);
+        if (len > capacity) {
+            return 0;
+        }
+        Cmd *c = (Cmd *)buf;
         c->no = no;
+        c->len = len;
+        memcpy(c->data, &probe, sizeof(probe));
+        return len;
+    }
+
+    /**
+     * \return the probe payload, nullptr if the frame is not a well formed kCmdPing/kCmdPong.
+     */
+    static const ClockProbe* clockProbe(const Cmd *cmd, uint16_t no) {
+        if (cmdNo(cmd) != no || cmd->len < sizeof(Cmd) + sizeof(ClockProbe)) {
+            return nullptr;
+        }
+        return (const ClockProbe *)cmd->data;
+    }
 
-        memcpy(c->data, str.c_str(), str.size());
+    static uint16_t cmdNo(const Cmd *cmd) {
+        return cmd->no & kCmdNoMask;
+    }
+
+    static uint32_t header_size(const Cmd *cmd) {
+        return (cmd->no & kCmdFlagSeq) ? sizeof(Cmd) + sizeof(SeqHeader) : sizeof(Cmd);
+    }
+
+    /**
+     * \return the sequence header, nullptr if the frame carries none.
+     */
+    static const SeqHeader* seqHeader(const Cmd *cmd) {
+        return (cmd->no & kCmdFlagSeq) ? (const SeqHeader *)cmd->data : nullptr;
+    }
 
-        return std::move(data);
+    /**
+     * \return the serialized payload after all headers, cmd must have passed parseCmd.
+     */
+    static std::string_view payload(const Cmd *cmd) {
+        const uint32_t header = header_size(cmd);
+        return std::string_view((const char *)cmd + header, cmd->len - header);
     }
 };
 }
@@ -25,6 +25,15 @@ namespace structs{
             std::cout << "ReceiverChannel::initialize get key" << key_data_type << "failed." << std::endl;
             return false;
         }
+
+        // optional keys
+        (void)JsonUnity::get(json_info, key_nack, nack_);
+        (void)JsonUnity::get(json_info, key_backup_local_ip, backup_ip_);
+        (void)JsonUnity::get(json_info, key_clock_sync_interval_ms, clock_sync_interval_ms_);
+        (void)JsonUnity::get(json_info, key_workers, workers_);
+        (void)JsonUnity::get(json_info, key_rx_hold_batches, rx_hold_batches_);
+        (void)JsonUnity::get(json_info, key_rx_batch_min, rx_batch_min_);
+        (void)JsonUnity::get(json_info, key_rx_batch_max, rx_batch_max_);
         return true;
     }
 }
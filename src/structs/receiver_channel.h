@@ -30,6 +30,13 @@ public:
     std::string str_ip_{};    // 目标端口
     std::vector<std::string> data_types_{}; // 数据类型
     uint32_t    port_{0};     // 端口
+    bool        nack_{false}; // 检测到缺失时是否请求重传
+    std::string backup_ip_{}; // B路径本地地址, 为空则只收A路径
+    uint32_t    clock_sync_interval_ms_{0}; // 向发送端对时的间隔, 0为不对时
+    uint32_t    workers_{1};  // 解码存储线程数, 0为在接收线程内处理
+    uint32_t    rx_hold_batches_{4}; // 工作线程可同时持有的零拷贝接收批次, 0为总是拷贝
+    uint32_t    rx_batch_min_{16};  // 每次接收的最小批大小
+    uint32_t    rx_batch_max_{256}; // 每次接收的最大批大小, 与最小值相等时为固定批大小
 };
 }
 }
@@ -20,11 +20,42 @@ namespace structs{
             return false;
         }
 
-        res = JsonUnity::get(json_info,key_target_port, channel_id_);
+        res = JsonUnity::get(json_info,key_channel_id, channel_id_);
         if(!res) {
-            std::cout << "SenderChannel::initialize get key" << key_target_port << "failed." << std::endl;
+            std::cout << "SenderChannel::initialize get key" << key_channel_id << "failed." << std::endl;
+            return false;
+        }
+
+        // optional keys, keep the defaults when absent
+        (void)JsonUnity::get(json_info, key_data_type_single, data_type_);
+        std::string str_priority;
+        if (JsonUnity::get(json_info, key_priority, str_priority)) {
+            if (str_priority == "bulk") {
+                priority_ = PriorityClass::kBulk;
+            } else if (str_priority != "latency") {
+                std::cout << "SenderChannel::initialize invalid " << key_priority << ": " << str_priority << std::endl;
+                return false;
+            }
+        }
+        (void)JsonUnity::get(json_info, key_rate_bytes, rate_bytes_per_sec_);
+        (void)JsonUnity::get(json_info, key_rate_packets, rate_packets_per_sec_);
+        (void)JsonUnity::get(json_info, key_burst_bytes, burst_bytes_);
+        (void)JsonUnity::get(json_info, key_burst_packets, burst_packets_);
+        (void)JsonUnity::get(json_info, key_coalesce_bytes, coalesce_bytes_);
+        (void)JsonUnity::get(json_info, key_max_queue_frames, max_queue_frames_);
+        if (max_queue_frames_ == 0U) {
+            std::cout << "SenderChannel::initialize " << key_max_queue_frames << " must not be 0" << std::endl;
             return false;
         }
+        (void)JsonUnity::get(json_info, key_sequence, sequence_);
+        (void)JsonUnity::get(json_info, key_retransmit_slots, retransmit_slots_);
+        (void)JsonUnity::get(json_info, key_fec_k, fec_k_);
+        (void)JsonUnity::get(json_info, key_fec_m, fec_m_);
+        (void)JsonUnity::get(json_info, key_backup_target_ip, backup_ip_);
+        (void)JsonUnity::get(json_info, key_backup_target_port, backup_port_);
+        if (backup_port_ == 0U) {
+            backup_port_ = port_;
+        }
         return true;
     }
 }
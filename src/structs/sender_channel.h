@@ -19,6 +19,16 @@
 
 namespace forward{
 namespace structs{
+/**
+ * \brief priority class of a sender channel. Latency channels are always dequeued first,
+ * bulk channels are shaped and coalesced.
+ */
+enum class PriorityClass : uint8_t {
+    kLatency = 0,
+    kBulk,
+    kCount,
+};
+
 class SenderChannel : public BaseInfo{
 public:
     SenderChannel() = default;
@@ -31,6 +41,20 @@ public:
     std::string data_type_{}; // 数据类型
     uint32_t    port_{0};     // 端口
     uint32_t    channel_id_{0};
+
+    PriorityClass priority_{PriorityClass::kLatency};  // 优先级
+    uint32_t    rate_bytes_per_sec_{0};     // 字节速率限制, 0为不限速
+    uint32_t    rate_packets_per_sec_{0};   // 包速率限制, 0为不限速
+    uint32_t    burst_bytes_{0};            // 字节令牌桶深度, 0为1秒的令牌
+    uint32_t    burst_packets_{0};          // 包令牌桶深度, 0为1秒的令牌
+    uint32_t    coalesce_bytes_{1400};      // bulk通道合并发送的最大报文长度
+    uint32_t    max_queue_frames_{4096};    // 调度队列最多缓存的帧数, 满时拒绝入队
+    bool        sequence_{false};           // 帧头是否携带通道序号
+    uint32_t    retransmit_slots_{0};       // 重传缓存帧数, 0为不支持重传, 需要sequence_
+    uint32_t    fec_k_{0};                  // FEC每块数据帧数, 0为不启用, 需要sequence_
+    uint32_t    fec_m_{1};                  // FEC每块校验帧数, 1为XOR校验
+    std::string backup_ip_{};               // B路径目标地址, 为空则不双发
+    uint32_t    backup_port_{0};            // B路径目标端口, 0为与A路径相同
 };
 }
 }
@@ -15,6 +15,9 @@ using namespace forward::tool;
         uint64_t data_id;  // 子编号
 
         uint64_t recv_ns;
+        int64_t owd_ns;    // 按对时结果修正后的单向时延
+        int64_t nic_ns;    // 网卡收包时间, 0为驱动未提供
+        int64_t rx_ns;     // 用户态取到报文的时间
     };
     YLT_REFL(StructA, ns, num1, num2, total_id, data_id);
 
@@ -26,6 +29,9 @@ using namespace forward::tool;
         uint64_t data_id;  // 子编号
 
         uint64_t recv_ns;
+        int64_t owd_ns;    // 按对时结果修正后的单向时延
+        int64_t nic_ns;    // 网卡收包时间, 0为驱动未提供
+        int64_t rx_ns;     // 用户态取到报文的时间
     };
     YLT_REFL(StructB, ns, num1, num2, data[64], total_id, data_id);
 }
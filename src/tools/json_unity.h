@@ -47,6 +47,14 @@ public:
         return false;
     }
 
+    static bool get(const nlohmann::json& json, const std::string& key, bool& out) {
+        if(json.contains(key) && json[key].is_boolean()) {
+            out = json[key];
+            return true;
+        }
+        return false;
+    }
+
     static bool get(const nlohmann::json& json, const std::string& key, std::vector<std::string>& vec_out) {
         if(json.contains(key) && json[key].is_array()) {
             for(auto& iter : json[key]) {
@@ -0,0 +1,250 @@
+/** @addtogroup common
+ * \ingroup forward
+ *  @{
+ */
+/**
+* @file pb_decode.h
+* @brief bounds checked protobuf decode that reports errors instead of throwing
+* @details Decodes the same wire format and YLT_REFL structs as iguana::from_pb, but every read is
+*  checked against the end of the payload, which PackHelper::payload() bounds by Cmd.len, and a
+*  malformed payload returns a PbErrc instead of throwing. The field number is dispatched with
+*  ylt::reflection::template_switch, a jump table on field_no - 1, in place of the static member
+*  map and std::visit of iguana. Unknown fields are skipped as protobuf requires.
+*
+*  Only flat structs are supported: scalar, enum, float/double, iguana fixed and zigzag members
+*  and std::string/std::string_view. Nested messages, containers and oneof are rejected at compile
+*  time, use iguana::from_pb for those.
+* @author		wuting.xu
+* @date		    2026/10/19
+* @par Copyright(c): 	2024. All rights reserved.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "iguana/pb_util.hpp"
+#include "iguana/ylt/reflection/template_switch.hpp"
+
+namespace forward{
+namespace tool{
+    enum class PbErrc {
+        kOk = 0,
+        kTruncated,         // 字段超出payload末尾
+        kBadVarint,         // varint超过10字节
+        kWireType,          // 线型与成员类型不符
+        kBadWireType,       // 未知线型, 无法跳过
+        kBadFieldNumber,    // 字段号为0
+    };
+
+    class PbCategory : public std::error_category {
+    public:
+        const char *name() const noexcept override {
+            return "forward::pb";
+        }
+
+        std::string message(int err_val) const override {
+            switch (static_cast<PbErrc>(err_val)) {
+                case PbErrc::kOk:
+                    return "ok";
+                case PbErrc::kTruncated:
+                    return "field runs past the end of the payload";
+                case PbErrc::kBadVarint:
+                    return "varint longer than 10 bytes";
+                case PbErrc::kWireType:
+                    return "wire type does not match the member type";
+                case PbErrc::kBadWireType:
+                    return "unknown wire type";
+                case PbErrc::kBadFieldNumber:
+                    return "field number 0";
+                default:
+                    return "unrecognized error";
+            }
+        }
+    };
+
+    inline const PbCategory& pb_category() {
+        static PbCategory instance;
+        return instance;
+    }
+
+    inline std::error_code make_error_code(PbErrc e) {
+        return std::error_code(static_cast<int>(e), pb_category());
+    }
+
+class PbDecoder {
+public:
+    /**
+     * \brief decode pb into t, fields absent from pb keep their value.
+     * \return an empty error_code on success, else a PbErrc, t is then partly written.
+     */
+    template <typename T>
+    static std::error_code decode(T& t, std::string_view pb) noexcept {
+        static_assert(iguana::ylt_refletable_v<T>, "PbDecoder needs a YLT_REFL struct");
+        static_assert(members_count<T>() <= 256U, "template_switch dispatches 256 members at most");
+        static_assert(!has_oneof<T>(std::make_index_sequence<members_count<T>()>{}),
+                      "oneof members shift the field numbers, use iguana::from_pb");
+        const char *p = pb.data();
+        const char *end = p + pb.size();
+        while (p != end) {
+            uint64_t key;
+            PbErrc e = read_varint(p, end, key);
+            if (e != PbErrc::kOk) {
+                return make_error_code(e);
+            }
+            const uint32_t wire = static_cast<uint32_t>(key & 0x7U);
+            const uint64_t field_no = key >> 3U;
+            if (field_no == 0U) {
+                return make_error_code(PbErrc::kBadFieldNumber);
+            }
+            if (field_no <= members_count<T>()) {
+                // 字段号从1开始按成员顺序编号, 没有oneof时成员下标即field_no - 1
+                e = ylt::reflection::template_switch<FieldHelper>(static_cast<size_t>(field_no - 1U), t,
+                                                                  wire, p, end);
+            } else {
+                e = skip(wire, p, end);
+            }
+            if (e != PbErrc::kOk) {
+                return make_error_code(e);
+            }
+        }
+        return {};
+    }
+
+private:
+    template <typename T>
+    using Tuple = decltype(ylt::reflection::object_to_tuple(std::declval<T>()));
+
+    template <typename T>
+    static constexpr size_t members_count() {
+        return std::tuple_size_v<Tuple<T>>;
+    }
+
+    template <typename T, size_t... I>
+    static constexpr bool has_oneof(std::index_sequence<I...>) {
+        return (iguana::variant_v<ylt::reflection::remove_cvref_t<std::tuple_element_t<I, Tuple<T>>>> || ...);
+    }
+
+    static PbErrc read_varint(const char *&p, const char *end, uint64_t& val) {
+        val = 0;
+        for (uint32_t shift = 0; shift < 64U; shift += 7U) {
+            if (p == end) {
+                return PbErrc::kTruncated;
+            }
+            const auto b = static_cast<uint8_t>(*p++);
+            val |= static_cast<uint64_t>(b & 0x7fU) << shift;
+            if ((b & 0x80U) == 0U) {
+                return PbErrc::kOk;
+            }
+        }
+        return PbErrc::kBadVarint;
+    }
+
+    static PbErrc read_fixed(const char *&p, const char *end, void *out, size_t size) {
+        if (static_cast<size_t>(end - p) < size) {
+            return PbErrc::kTruncated;
+        }
+        memcpy(out, p, size);
+        p += size;
+        return PbErrc::kOk;
+    }
+
+    static PbErrc skip(uint32_t wire, const char *&p, const char *end) {
+        uint64_t v;
+        switch (static_cast<iguana::WireType>(wire)) {
+            case iguana::WireType::Varint:
+                return read_varint(p, end, v);
+            case iguana::WireType::Fixed64:
+                return (end - p < 8) ? PbErrc::kTruncated : (p += 8, PbErrc::kOk);
+            case iguana::WireType::Fixed32:
+                return (end - p < 4) ? PbErrc::kTruncated : (p += 4, PbErrc::kOk);
+            case iguana::WireType::LengthDelimeted: {
+                const PbErrc e = read_varint(p, end, v);
+                if (e != PbErrc::kOk) {
+                    return e;
+                }
+                if (v > static_cast<uint64_t>(end - p)) {
+                    return PbErrc::kTruncated;
+                }
+                p += v;
+                return PbErrc::kOk;
+            }
+            default:
+                return PbErrc::kBadWireType;
+        }
+    }
+
+    template <typename M>
+    static PbErrc read_value(M& m, const char *&p, const char *end) {
+        uint64_t v;
+        if constexpr (std::is_same_v<M, bool>) {
+            const PbErrc e = read_varint(p, end, v);
+            m = (v != 0U);
+            return e;
+        } else if constexpr (std::is_integral_v<M>) {
+            const PbErrc e = read_varint(p, end, v);
+            m = static_cast<M>(v);
+            return e;
+        } else if constexpr (std::is_enum_v<M>) {
+            const PbErrc e = read_varint(p, end, v);
+            m = static_cast<M>(static_cast<std::underlying_type_t<M>>(v));
+            return e;
+        } else if constexpr (iguana::detail::is_signed_varint_v<M>) {
+            const PbErrc e = read_varint(p, end, v);
+            if constexpr (sizeof(typename M::value_type) == 8) {
+                m.val = iguana::detail::decode_zigzag(v);
+            } else {
+                m.val = static_cast<typename M::value_type>(iguana::detail::decode_zigzag(static_cast<uint32_t>(v)));
+            }
+            return e;
+        } else if constexpr (iguana::detail::is_fixed_v<M>) {
+            return read_fixed(p, end, &m.val, sizeof(m.val));
+        } else if constexpr (std::is_same_v<M, float> || std::is_same_v<M, double>) {
+            return read_fixed(p, end, &m, sizeof(m));
+        } else if constexpr (std::is_same_v<M, std::string> || std::is_same_v<M, std::string_view>) {
+            const PbErrc e = read_varint(p, end, v);
+            if (e != PbErrc::kOk) {
+                return e;
+            }
+            if (v > static_cast<uint64_t>(end - p)) {
+                return PbErrc::kTruncated;
+            }
+            m.assign(p, static_cast<size_t>(v));    // string_view指向payload, 不可越过帧的生命周期
+            p += v;
+            return PbErrc::kOk;
+        } else {
+            static_assert(!sizeof(M), "PbDecoder supports flat structs only, use iguana::from_pb");
+            return PbErrc::kWireType;
+        }
+    }
+
+    struct FieldHelper {
+        template <size_t I, typename T>
+        static PbErrc run(T& t, uint32_t wire, const char *&p, const char *end) {
+            if constexpr (I >= members_count<T>()) {
+                return PbErrc::kBadFieldNumber;    // decode()已检查, 不会到达
+            } else {
+                using M = ylt::reflection::remove_cvref_t<std::tuple_element_t<I, Tuple<T>>>;
+                if (wire != static_cast<uint32_t>(iguana::detail::get_wire_type<M>())) {
+                    return PbErrc::kWireType;
+                }
+                // 与iguana相同, 按反射得到的偏移写成员
+                static const auto& offsets = ylt::reflection::internal::get_member_offset_arr(
+                        ylt::reflection::internal::wrapper<T>::value);
+                return read_value(*reinterpret_cast<M *>(reinterpret_cast<char *>(&t) + offsets[I]), p, end);
+            }
+        }
+    };
+};
+}
+}
+
+namespace std {
+template <>
+struct is_error_code_enum<forward::tool::PbErrc> : true_type {};
+}
+/** @}*/    // end of group forward